@@ -1,18 +1,29 @@
-import processing.serial.*;
+import processing.net.*;
 
-Serial myPort;  // Create object from Serial class
+/*
+ * Live viewer for Host/ingestd. The daemon does the serial reading and keeps
+ * the history, so this only asks for a downsampled series once per frame.
+ */
 
-char nextChar = '\0';
-int frequency;
+Client daemon;  // Connection to the ingest daemon
 
-int[] history;
+String device = "ttyUSB0";  // Device name as shown by the daemon's LIST request
+int spanMs = 20000;         // Length of history to show
+int points = 100;           // Number of points across the window
 
-void setup() 
+int[] minimum;
+int[] mean;
+int[] maximum;
+int[] samples;  // Samples in each point, none where the sensor sent nothing
+
+void setup()
 {
-  history = new int[100];
-  java.util.Arrays.fill(history, 16000);
+  minimum = new int[points];
+  mean = new int[points];
+  maximum = new int[points];
+  samples = new int[points];
   size(800, 400);
-  myPort = new Serial(this, "COM18", 115200);
+  daemon = new Client(this, "127.0.0.1", 5331);
   stroke(255);
 }
 
@@ -22,46 +33,75 @@ void draw()
 
   background(0);
 
-  shiftArray();
+  if (!getSeries())
+  {
+    return;
+  }
+
+  float lastY = map(mean[0], 0, 20000, 400, 0);
 
-  history[99] = getFrequency();
-  
-  float lastY = map(history[0], 0, 20000, 400, 0);
-  
-  for (i=1; i < 100; ++i)
+  for (i=1; i < points; ++i)
   {
-    float newY = map(history[i], 0, 20000, 400, 0);
-    
-    line(i*8, lastY, (i+1)*8, newY);
+    float x = i * width / points;
+    float newY = map(mean[i], 0, 20000, 400, 0);
+
+    // An empty point is a gap, not a reading of 0, which would look like a flush
+    if (samples[i] == 0)
+    {
+      continue;
+    }
+
+    stroke(80);
+    line(x, map(minimum[i], 0, 20000, 400, 0), x, map(maximum[i], 0, 20000, 400, 0));
+
+    if (samples[i-1] > 0)
+    {
+      stroke(255);
+      line((i-1) * width / points, lastY, x, newY);
+    }
     lastY = newY;
   }
 }
 
-int getFrequency()
+boolean getSeries()
 {
-  int frequency = 0;
-  do
+  daemon.write("SERIES " + device + " " + spanMs + " " + points + "\n");
+
+  String header = readLine();
+  if ((header == null) || !header.startsWith("OK"))
   {
-    nextChar = (char)myPort.read();
-    if ((nextChar >= '0') && (nextChar <= '9'))
-    {
-      frequency *= 10;
-      frequency += (nextChar - '0');         // read it and store it in val
-    }
-    while (myPort.available () == 0) {
-    }
-  } 
-  while ( nextChar != '\n' );
+    return false;
+  }
 
-  return frequency;
-}
+  int count = min(int(header.substring(3)), points);
 
-void shiftArray()
-{ 
-  int i;
-  for (i=0; i < 99; ++i)
+  for (int i=0; i < count; ++i)
+  {
+    // Each line is "<ageMs> <min> <mean> <max> <count>"
+    String[] fields = split(readLine(), ' ');
+    minimum[i] = int(fields[1]);
+    mean[i] = int(fields[2]);
+    maximum[i] = int(fields[3]);
+    samples[i] = int(fields[4]);
+  }
+
+  for (int i=count; i < points; ++i)
   {
-    history[i] = history[i+1];
+    samples[i] = 0;
   }
+
+  return true;
 }
 
+String readLine()
+{
+  String line = null;
+  int timeout = millis() + 1000;
+
+  while ((line == null) && (millis() < timeout))
+  {
+    line = daemon.readStringUntil('\n');
+  }
+
+  return (line == null) ? null : trim(line);
+}
@@ -0,0 +1,169 @@
+#ifndef _DETECT_PIPELINE_H_
+#define _DETECT_PIPELINE_H_
+
+/*
+ * Flush detection as a chain of stages chosen at compile time:
+ *
+ *	Source -> PreFilter -> Detector -> Counter -> Reporter
+ *
+ * Each stage is a policy class, so a new filter or reporter is a new class
+ * rather than an edit to the chain, and the chain is checked by the compiler.
+ * Every call is resolved statically and inlined: there are no virtual
+ * functions, function pointers or allocation, and stages with no state are
+ * empty bases that take no RAM. Built from detect_core.h, so the default
+ * stages detect exactly as the C firmware does.
+ *
+ * Policies:
+ *	Source:		uint16_t take(void);
+ *		the pulses counted over the last sample
+ *	PreFilter:	uint16_t apply(uint16_t count);
+ *	Detector:	bool update(uint16_t count);
+ *		true while a flush is in progress. MeanDetector also has
+ *		IsFlushing, IsDeviating and GetIdleAverage, for reporters that use them
+ *	Counter:	bool update(uint16_t ms, bool flushing);	bool triggered(void) const;
+ *				uint32_t durationMs(void) const;			void reset(void);
+ *		update() returns true once flushing has stopped for long enough
+ *	Reporter:	template <class Detector> void sample(uint16_t ms, const Detector & detector);
+ *				void flush(uint32_t durationMs);	void idle(void);
+ *		sample() is called for every sample once the detector has it, flush()
+ *		for each completed flush, and idle() for every sample taken while the
+ *		counter is stopped
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "detect_core.h"
+
+template <class Source, class PreFilter, class Detector, class Counter, class Reporter>
+class DetectPipeline : private Source, private PreFilter, private Detector, private Counter, private Reporter
+{
+public:
+	/* Takes and processes one sample of ms milliseconds. Returns true while flushing. */
+	bool Tick(uint16_t ms)
+	{
+		uint16_t count = PreFilter::apply(Source::take());
+
+		bool flushing = Detector::update(count);
+
+		Reporter::sample(ms, detector());
+
+		if (Counter::update(ms, flushing))
+		{
+			Reporter::idle();
+
+			if (Counter::triggered())
+			{
+				Reporter::flush(Counter::durationMs());
+			}
+
+			Counter::reset();
+		}
+
+		return flushing;
+	}
+
+	Source & source(void) { return *this; }
+	PreFilter & preFilter(void) { return *this; }
+	Detector & detector(void) { return *this; }
+	Counter & counter(void) { return *this; }
+	Reporter & reporter(void) { return *this; }
+};
+
+/*
+ * Thresholds
+ */
+
+template <uint16_t Value>
+struct FixedThreshold
+{
+	static uint16_t get(void) { return Value; }
+};
+
+/*
+ * Pre-filters
+ */
+
+struct NoPreFilter
+{
+	uint16_t apply(uint16_t count) { return count; }
+};
+
+/* Median of the last Length samples (3, 5 or 7), to reject short spikes */
+template <uint8_t Length>
+class MedianPreFilter
+{
+public:
+	static_assert((Length == 3U) || (Length == 5U) || (Length == 7U), "Median length must be 3, 5 or 7");
+
+	MedianPreFilter() { Detect_MedianInit(&m_median, Length); }
+
+	uint16_t apply(uint16_t count) { return Detect_MedianAdd(&m_median, count); }
+
+private:
+	DETECT_MEDIAN m_median;
+};
+
+/* First, then Second */
+template <class First, class Second>
+class PreFilterChain : private First, private Second
+{
+public:
+	uint16_t apply(uint16_t count) { return Second::apply(First::apply(count)); }
+};
+
+/*
+ * Detectors
+ */
+
+/* The idle and recent average filter, as Detect_FilterNewValue */
+template <class Threshold, uint8_t IdleSamples = DETECT_IDLE_SAMPLES>
+class MeanDetector
+{
+public:
+	static_assert((IdleSamples > 0U) && (IdleSamples <= DETECT_IDLE_SAMPLES), "Idle window out of range");
+
+	MeanDetector() { Detect_FilterInit(&m_filter, IdleSamples); }
+
+	bool update(uint16_t count) { return Detect_FilterNewValue(&m_filter, count, Threshold::get()); }
+
+	bool IsFlushing(void) const { return m_filter.flushing; }
+	bool IsDeviating(void) const { return Detect_FilterIsDeviating(&m_filter, Threshold::get()); }
+	uint16_t GetIdleAverage(void) const { return m_filter.idleAverage; }
+	uint16_t GetRecentAverage(void) const { return m_filter.recentAverage; }
+
+private:
+	DETECT_FILTER m_filter;
+};
+
+/*
+ * Counters
+ */
+
+class FlushCounter
+{
+public:
+	FlushCounter() { Detect_FlushReset(&m_flush); }
+
+	bool update(uint16_t ms, bool flushing) { return Detect_FlushUpdate(&m_flush, ms, flushing); }
+	bool triggered(void) const { return Detect_FlushTriggered(&m_flush); }
+	uint32_t durationMs(void) const { return Detect_FlushDurationMs(&m_flush); }
+	void reset(void) { Detect_FlushReset(&m_flush); }
+
+private:
+	DETECT_FLUSH m_flush;
+};
+
+/*
+ * Reporters
+ */
+
+struct NullReporter
+{
+	template <class Detector>
+	void sample(uint16_t ms, const Detector & detector) { (void)ms; (void)detector; }
+	void flush(uint32_t durationMs) { (void)durationMs; }
+	void idle(void) {}
+};
+
+#endif
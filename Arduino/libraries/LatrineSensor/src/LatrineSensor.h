@@ -0,0 +1,164 @@
+#ifndef _LATRINE_SENSOR_LIB_H_
+#define _LATRINE_SENSOR_LIB_H_
+
+/*
+ * Arduino version of the latrine sensor flush detection, built on the same
+ * detect_core.h as the AVR firmware so both detect flushes identically.
+ *
+ * LatrineSensorT is templated over two policies:
+ *	PulseSource:	void begin(uint8_t intNum);	uint16_t take(void);
+ *		take() returns the pulses counted since the last call and clears the count
+ *	Timebase:		uint32_t now(void);
+ *		milliseconds, wrapping at 2^32
+ *
+ * Update() is non-blocking and does not allocate. Call it from loop() as often
+ * as possible; it takes a sample once every DETECT_SAMPLE_MS.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#include "detect_core.h"
+
+template <class PulseSource, class Timebase>
+class LatrineSensorT
+{
+public:
+	typedef void (*FlushStartHandler)(void);
+	typedef void (*FlushEndHandler)(uint16_t durationInSeconds);
+
+	LatrineSensorT(uint8_t intNum, FlushStartHandler onFlushStart, FlushEndHandler onFlushEnd, bool debug,
+		uint16_t threshold = DETECT_DEFAULT_THRESHOLD) :
+		m_intNum(intNum), m_onFlushStart(onFlushStart), m_onFlushEnd(onFlushEnd), m_debug(debug),
+		m_threshold(threshold), m_started(false), m_flushReported(false), m_lastSampleMs(0U)
+	{
+		Detect_FilterInit(&m_filter, DETECT_IDLE_SAMPLES);
+		Detect_FlushReset(&m_flush);
+	}
+
+	/*
+	 * Returns the pulse frequency in Hz when a new sample was taken, or 0 if
+	 * no sample is due yet. onFlushStart is called once a flush has lasted
+	 * DETECT_TRIGGER_MS, and onFlushEnd once it has been over for
+	 * DETECT_STOPPED_DELAY_MS.
+	 */
+	uint16_t Update(void)
+	{
+		uint32_t now = m_time.now();
+
+		if (!m_started)
+		{
+			// Deferred until the first loop() so the Arduino core is initialised
+			m_pulses.begin(m_intNum);
+			m_lastSampleMs = now;
+			m_started = true;
+			return 0U;
+		}
+
+		if ((uint32_t)(now - m_lastSampleMs) < DETECT_SAMPLE_MS) { return 0U; }
+
+		// Keep a fixed sample period unless more than a whole period behind
+		m_lastSampleMs += DETECT_SAMPLE_MS;
+		if ((uint32_t)(now - m_lastSampleMs) >= DETECT_SAMPLE_MS) { m_lastSampleMs = now; }
+
+		uint16_t count = m_pulses.take();
+		newSample(count);
+		return count;
+	}
+
+	void SetThreshold(uint16_t threshold) { m_threshold = threshold; }
+
+	bool IsFlushing(void) const { return m_filter.flushing; }
+	uint16_t GetIdleAverage(void) const { return m_filter.idleAverage; }
+	uint16_t GetRecentAverage(void) const { return m_filter.recentAverage; }
+
+private:
+	void newSample(uint16_t count)
+	{
+		bool flushing = Detect_FilterNewValue(&m_filter, count, m_threshold);
+		bool stopped = Detect_FlushUpdate(&m_flush, DETECT_SAMPLE_MS, flushing);
+
+		if (!m_flushReported && Detect_FlushTriggered(&m_flush))
+		{
+			m_flushReported = true;
+			if (m_onFlushStart) { m_onFlushStart(); }
+		}
+
+		if (stopped)
+		{
+			if (m_flushReported && m_onFlushEnd)
+			{
+				m_onFlushEnd((uint16_t)((Detect_FlushDurationMs(&m_flush) + 500U) / 1000U));
+			}
+			m_flushReported = false;
+			Detect_FlushReset(&m_flush);
+		}
+
+#ifdef ARDUINO
+		if (m_debug)
+		{
+			Serial.print(count);
+			Serial.print(',');
+			Serial.print(m_filter.idleAverage);
+			Serial.print(',');
+			Serial.print(m_filter.recentAverage);
+			Serial.print(',');
+			Serial.println(flushing ? 1 : 0);
+		}
+#endif
+	}
+
+	PulseSource m_pulses;
+	Timebase m_time;
+
+	uint8_t m_intNum;
+	FlushStartHandler m_onFlushStart;
+	FlushEndHandler m_onFlushEnd;
+	bool m_debug;
+	uint16_t m_threshold;
+
+	bool m_started;
+	bool m_flushReported;
+	uint32_t m_lastSampleMs;
+
+	DETECT_FILTER m_filter;
+	DETECT_FLUSH m_flush;
+};
+
+#ifdef ARDUINO
+
+/* Counts rising edges on an external interrupt pin */
+class InterruptPulseSource
+{
+public:
+	void begin(uint8_t intNum) { attachInterrupt(intNum, onPulse, RISING); }
+
+	uint16_t take(void)
+	{
+		noInterrupts();
+		uint16_t count = counter();
+		counter() = 0U;
+		interrupts();
+		return count;
+	}
+
+private:
+	static volatile uint16_t & counter(void) { static volatile uint16_t s_count; return s_count; }
+	static void onPulse(void) { counter()++; }
+};
+
+class MillisTimebase
+{
+public:
+	uint32_t now(void) { return millis(); }
+};
+
+typedef LatrineSensorT<InterruptPulseSource, MillisTimebase> LatrineSensor;
+
+#endif
+
+#endif
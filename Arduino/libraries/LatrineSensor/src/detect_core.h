@@ -0,0 +1,262 @@
+#ifndef _DETECT_CORE_H_
+#define _DETECT_CORE_H_
+
+/*
+ * Flush detection core, shared by the AVR firmware (filter.c, flush_counter.c)
+ * and the Arduino LatrineSensor library. Header only, C99 and C++ compatible,
+ * with all state held in caller-owned structs and no allocation.
+ *
+ * Samples are pulse counts from the outflow sensor over one DETECT_SAMPLE_MS
+ * period. A flush is in progress while the average of the recent samples is
+ * more than the threshold below the idle average.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define DETECT_SAMPLE_MS				(1000U)
+#define DETECT_DEFAULT_THRESHOLD		(500U)
+
+#define DETECT_IDLE_SAMPLES				(10U)		// Default and maximum idle window
+#define DETECT_RECENT_SAMPLES			(3U)
+
+#define DETECT_TRIGGER_MS				(1000U)		// Minimum flush time to count as a flush
+#define DETECT_STOPPED_DELAY_MS			(10000U)	// Idle time before a flush is complete
+
+#define DETECT_MEDIAN_MAX_SAMPLES		(7U)
+
+struct detect_median
+{
+	uint16_t samples[DETECT_MEDIAN_MAX_SAMPLES];
+	uint8_t length;
+	uint8_t index;
+	bool primed;
+};
+typedef struct detect_median DETECT_MEDIAN;
+
+struct detect_average
+{
+	uint16_t * samples;
+	uint32_t sum;
+	uint8_t length;
+	uint8_t count;
+	uint8_t index;
+};
+typedef struct detect_average DETECT_AVERAGE;
+
+struct detect_filter
+{
+	DETECT_AVERAGE idle;
+	DETECT_AVERAGE recent;
+	uint16_t idleSamples[DETECT_IDLE_SAMPLES];
+	uint16_t recentSamples[DETECT_RECENT_SAMPLES];
+	uint16_t idleAverage;
+	uint16_t recentAverage;
+	bool flushing;
+};
+typedef struct detect_filter DETECT_FILTER;
+
+struct detect_flush
+{
+	uint32_t totalMs;
+	uint16_t stoppedTimeoutMs;
+};
+typedef struct detect_flush DETECT_FLUSH;
+
+/*
+ * Moving averages over a fixed number of samples. Until the buffer fills,
+ * the average is over the samples seen so far.
+ */
+
+static inline void Detect_AverageInit(DETECT_AVERAGE * pAvg, uint16_t * samples, uint8_t length)
+{
+	pAvg->samples = samples;
+	pAvg->length = length;
+	pAvg->sum = 0U;
+	pAvg->count = 0U;
+	pAvg->index = 0U;
+}
+
+static inline uint16_t Detect_AverageAdd(DETECT_AVERAGE * pAvg, uint16_t value)
+{
+	if (pAvg->count < pAvg->length)
+	{
+		pAvg->count++;
+	}
+	else
+	{
+		pAvg->sum -= pAvg->samples[pAvg->index];
+	}
+
+	pAvg->samples[pAvg->index] = value;
+	pAvg->sum += value;
+
+	if (++pAvg->index == pAvg->length) { pAvg->index = 0U; }
+
+	return (uint16_t)(pAvg->sum / pAvg->count);
+}
+
+static inline void Detect_AverageFill(DETECT_AVERAGE * pAvg, uint16_t value)
+{
+	for (uint8_t i = 0; i < pAvg->length; ++i)
+	{
+		pAvg->samples[i] = value;
+	}
+	pAvg->sum = (uint32_t)value * pAvg->length;
+	pAvg->count = pAvg->length;
+	pAvg->index = 0U;
+}
+
+/*
+ * Sliding median over 3, 5 or 7 samples, to reject short spikes before the
+ * flush filter. The median of the window is found with a fixed sorting
+ * network on a copy of it, so each sample costs the same (3, 7 or 13
+ * compare-exchanges) whatever the data. The window starts full of the first
+ * sample. Any other length passes samples straight through.
+ */
+
+static inline void Detect_MedianSort2(uint16_t * a, uint16_t * b)
+{
+	uint16_t lo = (*a < *b) ? *a : *b;
+	uint16_t hi = (*a < *b) ? *b : *a;
+	*a = lo;
+	*b = hi;
+}
+
+static inline void Detect_MedianInit(DETECT_MEDIAN * pMedian, uint8_t length)
+{
+	if ((length != 3U) && (length != 5U) && (length != 7U)) { length = 1U; }
+
+	pMedian->length = length;
+	pMedian->index = 0U;
+	pMedian->primed = false;
+}
+
+static inline uint16_t Detect_MedianAdd(DETECT_MEDIAN * pMedian, uint16_t value)
+{
+	uint16_t s[DETECT_MEDIAN_MAX_SAMPLES];
+	uint8_t i;
+
+	if (!pMedian->primed)
+	{
+		for (i = 0; i < DETECT_MEDIAN_MAX_SAMPLES; ++i) { pMedian->samples[i] = value; }
+		pMedian->primed = true;
+	}
+
+	pMedian->samples[pMedian->index] = value;
+	if (++pMedian->index >= pMedian->length) { pMedian->index = 0U; }
+
+	// Order in the window does not matter to the median
+	for (i = 0; i < DETECT_MEDIAN_MAX_SAMPLES; ++i) { s[i] = pMedian->samples[i]; }
+
+	switch (pMedian->length)
+	{
+	case 3U:
+		Detect_MedianSort2(&s[0], &s[1]); Detect_MedianSort2(&s[1], &s[2]); Detect_MedianSort2(&s[0], &s[1]);
+		return s[1];
+
+	case 5U:
+		Detect_MedianSort2(&s[0], &s[1]); Detect_MedianSort2(&s[3], &s[4]); Detect_MedianSort2(&s[0], &s[3]);
+		Detect_MedianSort2(&s[1], &s[4]); Detect_MedianSort2(&s[1], &s[2]); Detect_MedianSort2(&s[2], &s[3]);
+		Detect_MedianSort2(&s[1], &s[2]);
+		return s[2];
+
+	case 7U:
+		Detect_MedianSort2(&s[0], &s[5]); Detect_MedianSort2(&s[0], &s[3]); Detect_MedianSort2(&s[1], &s[6]);
+		Detect_MedianSort2(&s[2], &s[4]); Detect_MedianSort2(&s[0], &s[1]); Detect_MedianSort2(&s[3], &s[5]);
+		Detect_MedianSort2(&s[2], &s[6]); Detect_MedianSort2(&s[2], &s[3]); Detect_MedianSort2(&s[3], &s[6]);
+		Detect_MedianSort2(&s[4], &s[5]); Detect_MedianSort2(&s[1], &s[4]); Detect_MedianSort2(&s[1], &s[3]);
+		Detect_MedianSort2(&s[3], &s[4]);
+		return s[3];
+
+	default:
+		return value;
+	}
+}
+
+/*
+ * Flush filter
+ */
+
+static inline void Detect_FilterInit(DETECT_FILTER * pFilter, uint8_t idleSamples)
+{
+	if ((idleSamples == 0U) || (idleSamples > DETECT_IDLE_SAMPLES)) { idleSamples = DETECT_IDLE_SAMPLES; }
+
+	Detect_AverageInit(&pFilter->idle, pFilter->idleSamples, idleSamples);
+	Detect_AverageInit(&pFilter->recent, pFilter->recentSamples, DETECT_RECENT_SAMPLES);
+	pFilter->idleAverage = 0U;
+	pFilter->recentAverage = 0U;
+	pFilter->flushing = false;
+}
+
+static inline bool Detect_FilterNewValue(DETECT_FILTER * pFilter, uint16_t newValue, uint16_t threshold)
+{
+	pFilter->recentAverage = Detect_AverageAdd(&pFilter->recent, newValue);
+
+	// Flush has started when average reading has dropped below threshold
+	bool flushing = (int32_t)pFilter->recentAverage < ((int32_t)pFilter->idleAverage - (int32_t)threshold);
+
+	if (pFilter->flushing && !flushing)
+	{
+		// Stopped flushing, reset the idle average to the recent readings
+		Detect_AverageFill(&pFilter->idle, pFilter->recentAverage);
+	}
+
+	pFilter->flushing = flushing;
+
+	if (!flushing)
+	{
+		// Not flushing, so make this reading part of the idle average
+		pFilter->idleAverage = Detect_AverageAdd(&pFilter->idle, newValue);
+	}
+
+	return flushing;
+}
+
+/*
+ * True while flushing, or when the recent average has dropped by half the
+ * threshold, which is enough to stop gated sampling before a flush is seen.
+ */
+static inline bool Detect_FilterIsDeviating(const DETECT_FILTER * pFilter, uint16_t threshold)
+{
+	return pFilter->flushing || (((uint32_t)pFilter->recentAverage + (threshold / 2U)) < pFilter->idleAverage);
+}
+
+/*
+ * Flush duration counter
+ */
+
+static inline void Detect_FlushReset(DETECT_FLUSH * pFlush)
+{
+	pFlush->totalMs = 0U;
+	pFlush->stoppedTimeoutMs = 0U;
+}
+
+/* Returns true once there has been no flushing for DETECT_STOPPED_DELAY_MS */
+static inline bool Detect_FlushUpdate(DETECT_FLUSH * pFlush, uint16_t timeMs, bool detect)
+{
+	if (detect)
+	{
+		pFlush->stoppedTimeoutMs = DETECT_STOPPED_DELAY_MS;
+		pFlush->totalMs += timeMs;
+	}
+	else
+	{
+		pFlush->stoppedTimeoutMs = (pFlush->stoppedTimeoutMs > timeMs) ? (uint16_t)(pFlush->stoppedTimeoutMs - timeMs) : 0U;
+	}
+
+	return (pFlush->stoppedTimeoutMs == 0U);
+}
+
+static inline bool Detect_FlushTriggered(const DETECT_FLUSH * pFlush)
+{
+	return (pFlush->totalMs > DETECT_TRIGGER_MS);
+}
+
+static inline uint32_t Detect_FlushDurationMs(const DETECT_FLUSH * pFlush)
+{
+	return pFlush->totalMs;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _HOST_AVR_EEPROM_H_
+#define _HOST_AVR_EEPROM_H_
+
+/*
+ * Host stand-in for avr/eeprom.h, so firmware modules that keep settings in
+ * EEPROM can be built into host simulations. EEPROM variables become plain
+ * RAM variables, initialised to their defaults.
+ */
+
+#define EEMEM
+
+static inline uint16_t eeprom_read_word(const uint16_t * p) { return *p; }
+static inline void eeprom_update_word(uint16_t * p, uint16_t value) { *p = value; }
+
+static inline uint32_t eeprom_read_dword(const uint32_t * p) { return *p; }
+static inline void eeprom_update_dword(uint32_t * p, uint32_t value) { *p = value; }
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "capture.h"
+#include "capture_parse.h"
+
+/*
+ * Private Function Prototypes
+ */
+
+static bool frameComplete(CAPTURE_PARSER * parser, CAPTURE_FRAME * frame);
+static uint16_t readU16(const uint8_t * p);
+
+/*
+ * Public Function Defintions
+ */
+
+void CAPTURE_ParserInit(CAPTURE_PARSER * parser)
+{
+	memset(parser, 0, sizeof(*parser));
+}
+
+/*
+ * Feeds raw bytes from the serial port into the parser. Returns the number
+ * of complete, valid frames passed to the handler.
+ */
+size_t CAPTURE_ParserFeed(CAPTURE_PARSER * parser, const uint8_t * data, size_t length, CAPTURE_FRAME_HANDLER handler, void * arg)
+{
+	size_t count = 0;
+	
+	for (size_t i = 0; i < length; ++i)
+	{
+		uint8_t byte = data[i];
+		
+		switch (parser->index)
+		{
+		case 0:
+			if (byte == CAPTURE_SYNC0)
+			{
+				parser->buffer[parser->index++] = byte;
+			}
+			break;
+		case 1:
+			if (byte == CAPTURE_SYNC1)
+			{
+				parser->buffer[parser->index++] = byte;
+			}
+			else
+			{
+				parser->index = (byte == CAPTURE_SYNC0) ? 1 : 0;
+				parser->resyncs++;
+			}
+			break;
+		default:
+			parser->buffer[parser->index++] = byte;
+			
+			if (parser->index == CAPTURE_FRAME_LENGTH)
+			{
+				CAPTURE_FRAME frame;
+				
+				parser->index = 0;
+				
+				if (frameComplete(parser, &frame))
+				{
+					uint8_t lost = parser->haveLastSeq ? (uint8_t)(frame.seq - parser->lastSeq - 1) : 0;
+					
+					parser->haveLastSeq = true;
+					parser->lastSeq = frame.seq;
+					parser->lostFrames += lost;
+					parser->frames++;
+					count++;
+					
+					if (handler)
+					{
+						handler(&frame, lost, arg);
+					}
+				}
+			}
+			break;
+		}
+	}
+	
+	return count;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static bool frameComplete(CAPTURE_PARSER * parser, CAPTURE_FRAME * frame)
+{
+	uint8_t crc = 0;
+	
+	for (uint8_t i = CAPTURE_OFFSET_SEQ; i < CAPTURE_OFFSET_CRC; ++i)
+	{
+		crc = CAPTURE_UpdateCRC(crc, parser->buffer[i]);
+	}
+	
+	if (crc != parser->buffer[CAPTURE_OFFSET_CRC])
+	{
+		parser->crcErrors++;
+		return false;
+	}
+	
+	frame->seq = parser->buffer[CAPTURE_OFFSET_SEQ];
+	frame->pulses = readU16(&parser->buffer[CAPTURE_OFFSET_PULSES]);
+	frame->outflowReading = readU16(&parser->buffer[CAPTURE_OFFSET_OUTFLOW]);
+	frame->ambientReading = readU16(&parser->buffer[CAPTURE_OFFSET_AMBIENT]);
+	
+	return true;
+}
+
+static uint16_t readU16(const uint8_t * p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
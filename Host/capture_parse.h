@@ -0,0 +1,45 @@
+#ifndef _CAPTURE_PARSE_H_
+#define _CAPTURE_PARSE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+struct capture_frame
+{
+	uint8_t seq;
+	uint16_t pulses;
+	uint16_t outflowReading;
+	uint16_t ambientReading;
+};
+typedef struct capture_frame CAPTURE_FRAME;
+
+struct capture_parser
+{
+	uint8_t buffer[CAPTURE_FRAME_LENGTH];
+	uint8_t index;
+	
+	bool haveLastSeq;
+	uint8_t lastSeq;
+	
+	uint32_t frames;
+	uint32_t lostFrames;
+	uint32_t crcErrors;
+	uint32_t resyncs;
+};
+typedef struct capture_parser CAPTURE_PARSER;
+
+/*
+ * Called for every valid frame, with the number of frames missing between
+ * it and the previous valid frame (from the sequence numbers)
+ */
+typedef void (*CAPTURE_FRAME_HANDLER)(const CAPTURE_FRAME * frame, uint8_t lost, void * arg);
+
+/*
+ * Public Function Prototypes
+ */
+
+void CAPTURE_ParserInit(CAPTURE_PARSER * parser);
+size_t CAPTURE_ParserFeed(CAPTURE_PARSER * parser, const uint8_t * data, size_t length, CAPTURE_FRAME_HANDLER handler, void * arg);
+
+#endif
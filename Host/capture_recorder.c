@@ -0,0 +1,156 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "capture.h"
+#include "capture_parse.h"
+#include "capture_trace.h"
+#include "serial_port.h"
+
+/*
+ * Records the raw capture stream from a sensor started with the capture setup
+ * pin pulled low. Usage: capture_recorder <serial port> <trace file>
+ */
+
+/*
+ * Private Function Prototypes
+ */
+
+static void onSignal(int sig);
+static void onFrame(const CAPTURE_FRAME * frame, uint8_t lost, void * arg);
+static void writeHeader(FILE * fp);
+static void putLE(uint8_t * dst, uint64_t value, uint8_t bytes);
+
+/* 
+ * Private Variables
+ */
+
+static volatile sig_atomic_t s_stop = 0;
+static uint64_t s_receiveTimeNs;
+
+static bool s_started = false;
+static uint64_t s_firstFrameNs;
+static uint64_t s_framesSinceFirst;
+
+int main(int argc, char * argv[])
+{
+	CAPTURE_PARSER parser;
+	uint8_t buffer[4096];
+	
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: %s <serial port> <trace file>\n", argv[0]);
+		return 1;
+	}
+	
+	int fd = SERIAL_Open(argv[1], CAPTURE_BAUD, false);
+	if (fd < 0) { return 1; }
+	
+	FILE * fp = fopen(argv[2], "wb");
+	if (!fp)
+	{
+		perror(argv[2]);
+		return 1;
+	}
+	
+	// No SA_RESTART, so a signal interrupts the blocking read
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	
+	writeHeader(fp);
+	CAPTURE_ParserInit(&parser);
+	
+	while (!s_stop)
+	{
+		ssize_t n = read(fd, buffer, sizeof(buffer));
+		
+		if (n <= 0) { break; }
+		
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		s_receiveTimeNs = ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+		
+		CAPTURE_ParserFeed(&parser, buffer, (size_t)n, onFrame, fp);
+	}
+	
+	fclose(fp);
+	close(fd);
+	
+	fprintf(stderr, "%lu frames, %lu lost, %lu CRC errors, %lu resyncs\n",
+		(unsigned long)parser.frames, (unsigned long)parser.lostFrames,
+		(unsigned long)parser.crcErrors, (unsigned long)parser.resyncs);
+	
+	return 0;
+}
+
+static void onSignal(int sig)
+{
+	(void)sig;
+	s_stop = 1;
+}
+
+/*
+ * Frames are timed from the sensor's 10ms cadence, anchored at the receive
+ * time of the first, since a read() returns many frames at once.
+ */
+static void onFrame(const CAPTURE_FRAME * frame, uint8_t lost, void * arg)
+{
+	uint8_t record[CAPTURE_TRACE_RECORD_LENGTH];
+	
+	if (!s_started)
+	{
+		s_firstFrameNs = s_receiveTimeNs;
+		s_started = true;
+	}
+	else
+	{
+		s_framesSinceFirst += 1U + lost;
+	}
+	
+	uint64_t frameNs = s_firstFrameNs + (s_framesSinceFirst * CAPTURE_TICK_MS * 1000000ULL);
+	
+	putLE(&record[0], frameNs, 8);
+	putLE(&record[8], frame->pulses, 2);
+	putLE(&record[10], frame->outflowReading, 2);
+	putLE(&record[12], frame->ambientReading, 2);
+	record[14] = frame->seq;
+	record[15] = lost;
+	
+	fwrite(record, sizeof(record), 1, (FILE *)arg);
+}
+
+static void writeHeader(FILE * fp)
+{
+	uint8_t header[CAPTURE_TRACE_HEADER_LENGTH];
+	
+	memset(header, 0, sizeof(header));
+	memcpy(header, CAPTURE_TRACE_MAGIC, sizeof(CAPTURE_TRACE_MAGIC));
+	putLE(&header[8], CAPTURE_TRACE_VERSION, 2);
+	putLE(&header[10], CAPTURE_TICK_MS, 2);
+	putLE(&header[12], CAPTURE_BAUD, 4);
+	
+	fwrite(header, sizeof(header), 1, fp);
+}
+
+static void putLE(uint8_t * dst, uint64_t value, uint8_t bytes)
+{
+	for (uint8_t i = 0; i < bytes; ++i)
+	{
+		dst[i] = (uint8_t)(value >> (8 * i));
+	}
+}
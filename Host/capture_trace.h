@@ -0,0 +1,34 @@
+#ifndef _CAPTURE_TRACE_H_
+#define _CAPTURE_TRACE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Binary trace file format (all values little-endian):
+ *
+ * Header, 16 bytes:
+ *   0-7:   magic "LSTRACE\0"
+ *   8-9:   format version (2)
+ *   10-11: capture window in milliseconds
+ *   12-15: serial baud rate
+ *
+ * Records, 16 bytes each:
+ *   0-7:   start of the frame's window, nanoseconds since the Unix epoch: the
+ *          host receive time of the first frame, plus one capture window for
+ *          every frame since, lost frames included. One read() returns many
+ *          frames, so receive times alone would lose the sensor's cadence.
+ *   8-9:   raw pulse count for the window
+ *   10-11: raw outflow ADC reading
+ *   12-13: raw ambient ADC reading
+ *   14:    frame sequence number
+ *   15:    frames lost immediately before this one (from sequence numbers)
+ */
+
+#define CAPTURE_TRACE_MAGIC			"LSTRACE"
+#define CAPTURE_TRACE_VERSION		(2)
+#define CAPTURE_TRACE_HEADER_LENGTH	(16)
+#define CAPTURE_TRACE_RECORD_LENGTH	(16)
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "llap_parse.h"
+#include "gateway.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define ID_SLOTS		(128 * 128)
+#define NO_DEVICE		(0xFFFF)
+
+#define ACK_MAX_COUNT	(999)
+
+struct gateway_device
+{
+	char id[2];
+	uint16_t pendingAcks;
+	bool wakePending;
+	uint8_t nConfig;
+	bool dirty;
+	char config[GATEWAY_MAX_CONFIG][GATEWAY_CONFIG_LENGTH];
+	uint64_t lastSeenMs;
+	bool timeSynced;
+	uint64_t lastSyncMs;
+};
+typedef struct gateway_device GATEWAY_DEVICE;
+
+struct gateway
+{
+	GATEWAY_SEND_FN send;
+	void * sendArg;
+	
+	// Two character LLAP IDs index straight into the slot table
+	uint16_t slots[ID_SLOTS];
+	GATEWAY_DEVICE devices[GATEWAY_MAX_DEVICES];
+	uint16_t nDevices;
+	
+	// Devices with something to send, so flushing never scans the whole table
+	uint16_t dirty[GATEWAY_MAX_DEVICES];
+	uint16_t nDirty;
+	
+	int eventFd;
+	bool syncBatches;
+	char batch[GATEWAY_BATCH_BYTES];
+	size_t batchLength;
+	uint32_t batchEvents;
+	uint64_t batchStartMs;
+	
+	GATEWAY_STATS stats;
+};
+
+/*
+ * Private Function Prototypes
+ */
+
+static GATEWAY_DEVICE * getDevice(GATEWAY * gateway, const char * id);
+static void markDirty(GATEWAY * gateway, GATEWAY_DEVICE * device);
+static void recordEvent(GATEWAY * gateway, const char * frame, uint64_t nowMs);
+static void sendFrame(GATEWAY * gateway, const char * id, const char * body);
+
+/*
+ * Public Function Defintions
+ */
+
+/*
+ * eventFd receives flush events as text lines "<ms since epoch>,<id>,<body>",
+ * written in batches. Pass -1 to discard events.
+ */
+GATEWAY * GATEWAY_Create(int eventFd, bool syncBatches, GATEWAY_SEND_FN send, void * sendArg)
+{
+	GATEWAY * gateway = calloc(1, sizeof(GATEWAY));
+	
+	if (gateway)
+	{
+		memset(gateway->slots, 0xFF, sizeof(gateway->slots));
+		gateway->eventFd = eventFd;
+		gateway->syncBatches = syncBatches;
+		gateway->send = send;
+		gateway->sendArg = sendArg;
+	}
+	
+	return gateway;
+}
+
+void GATEWAY_Destroy(GATEWAY * gateway)
+{
+	GATEWAY_PersistNow(gateway);
+	free(gateway);
+}
+
+/*
+ * Handles one incoming LLAP frame. Nothing is sent from here: replies are
+ * collected per device and sent by GATEWAY_Flush.
+ */
+void GATEWAY_HandleFrame(GATEWAY * gateway, const char * frame, uint64_t nowMs)
+{
+	GATEWAY_DEVICE * device = getDevice(gateway, &frame[1]);
+	
+	gateway->stats.framesIn++;
+	
+	if (!device) { return; }
+	
+	device->lastSeenMs = nowMs;
+	
+	if ((frame[3] == 'F') && ((frame[4] == 'E') || (frame[4] == 'B')))
+	{
+		recordEvent(gateway, frame, nowMs);
+		
+		if (device->pendingAcks < ACK_MAX_COUNT)
+		{
+			device->pendingAcks++;
+		}
+		markDirty(gateway, device);
+	}
+	else if (frame[3] == 'E')
+	{
+		// The sensor's clock at the start of a batch, logged so the batch can be dated
+		recordEvent(gateway, frame, nowMs);
+	}
+	else if (frame[3] == 'B')
+	{
+		// Idle baseline history, sent on request and not acknowledged. Logged as
+		// is, since the frames only make sense decoded together.
+		recordEvent(gateway, frame, nowMs);
+	}
+	else if (strncmp(&frame[3], "WAKE", 4) == 0)
+	{
+		// The sensor waits for a reply before sending its report
+		device->wakePending = true;
+		markDirty(gateway, device);
+	}
+	else if (device->nConfig)
+	{
+		// Any other message means the device is listening
+		markDirty(gateway, device);
+	}
+	
+	if ((gateway->batchEvents >= GATEWAY_BATCH_EVENTS) ||
+		(gateway->batchLength > (GATEWAY_BATCH_BYTES - 64)))
+	{
+		GATEWAY_PersistNow(gateway);
+	}
+}
+
+/*
+ * Queues a configuration push, e.g. body "TH450", for the next time the
+ * device is heard from. A newer push with the same two character command
+ * replaces an older one that has not been sent yet.
+ */
+bool GATEWAY_QueueConfig(GATEWAY * gateway, const char * id, const char * body)
+{
+	GATEWAY_DEVICE * device = getDevice(gateway, id);
+	
+	if (!device || (strlen(body) < 2)) { return false; }
+	
+	for (uint8_t i = 0; i < device->nConfig; ++i)
+	{
+		if (strncmp(device->config[i], body, 2) == 0)
+		{
+			strncpy(device->config[i], body, GATEWAY_CONFIG_LENGTH);
+			gateway->stats.configCoalesced++;
+			return true;
+		}
+	}
+	
+	if (device->nConfig == GATEWAY_MAX_CONFIG) { return false; }
+	
+	strncpy(device->config[device->nConfig++], body, GATEWAY_CONFIG_LENGTH);
+	return true;
+}
+
+/*
+ * Sends one coalesced acknowledgement to every device heard from since the
+ * last flush ("ACKnnn" for nnn reports, or a plain "ACK" to answer WAKE), a
+ * time sync after WAKE if one is due, and any pending configuration, then persists the event batch if it is due.
+ */
+void GATEWAY_Flush(GATEWAY * gateway, uint64_t nowMs)
+{
+	for (uint16_t i = 0; i < gateway->nDirty; ++i)
+	{
+		GATEWAY_DEVICE * device = &gateway->devices[gateway->dirty[i]];
+		
+		if (device->pendingAcks)
+		{
+			char body[GATEWAY_CONFIG_LENGTH + 1];
+			snprintf(body, sizeof(body), "ACK%03u", device->pendingAcks);
+			sendFrame(gateway, device->id, body);
+			
+			gateway->stats.acks++;
+			gateway->stats.acksCoalesced += device->pendingAcks - 1U;
+			device->pendingAcks = 0;
+		}
+		else if (device->wakePending)
+		{
+			sendFrame(gateway, device->id, "ACK");
+			gateway->stats.acks++;
+			
+			if (!device->timeSynced || ((nowMs - device->lastSyncMs) >= GATEWAY_TIME_SYNC_MS))
+			{
+				// Seconds since 1970 as eight hex digits, rounded to the nearest second
+				char body[GATEWAY_CONFIG_LENGTH + 1];
+				snprintf(body, sizeof(body), "S%08X", (unsigned int)((nowMs + 500U) / 1000U));
+				sendFrame(gateway, device->id, body);
+				
+				gateway->stats.timeSyncs++;
+				device->timeSynced = true;
+				device->lastSyncMs = nowMs;
+			}
+		}
+		
+		device->wakePending = false;
+		
+		for (uint8_t c = 0; c < device->nConfig; ++c)
+		{
+			sendFrame(gateway, device->id, device->config[c]);
+			gateway->stats.configSent++;
+		}
+		
+		device->nConfig = 0;
+		device->dirty = false;
+	}
+	
+	gateway->nDirty = 0;
+	
+	if (gateway->batchEvents && ((nowMs - gateway->batchStartMs) >= GATEWAY_BATCH_MS))
+	{
+		GATEWAY_PersistNow(gateway);
+	}
+}
+
+void GATEWAY_PersistNow(GATEWAY * gateway)
+{
+	if (gateway->batchLength && (gateway->eventFd >= 0))
+	{
+		const char * p = gateway->batch;
+		size_t remaining = gateway->batchLength;
+		
+		while (remaining)
+		{
+			ssize_t n = write(gateway->eventFd, p, remaining);
+			if (n <= 0) { perror("event log"); break; }
+			p += n;
+			remaining -= (size_t)n;
+		}
+		
+		if (gateway->syncBatches)
+		{
+			(void)fdatasync(gateway->eventFd);
+		}
+		
+		gateway->stats.batchesWritten++;
+	}
+	
+	gateway->batchLength = 0;
+	gateway->batchEvents = 0;
+}
+
+const GATEWAY_STATS * GATEWAY_GetStats(const GATEWAY * gateway)
+{
+	return &gateway->stats;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static GATEWAY_DEVICE * getDevice(GATEWAY * gateway, const char * id)
+{
+	uint8_t a = (uint8_t)id[0];
+	uint8_t b = (uint8_t)id[1];
+	
+	if ((a > 0x7F) || (b > 0x7F)) { return NULL; }
+	
+	uint16_t * slot = &gateway->slots[(a << 7) | b];
+	
+	if (*slot == NO_DEVICE)
+	{
+		if (gateway->nDevices == GATEWAY_MAX_DEVICES) { return NULL; }
+		
+		*slot = gateway->nDevices++;
+		gateway->devices[*slot].id[0] = (char)a;
+		gateway->devices[*slot].id[1] = (char)b;
+		gateway->stats.devices = gateway->nDevices;
+	}
+	
+	return &gateway->devices[*slot];
+}
+
+static void markDirty(GATEWAY * gateway, GATEWAY_DEVICE * device)
+{
+	if (!device->dirty)
+	{
+		device->dirty = true;
+		gateway->dirty[gateway->nDirty++] = (uint16_t)(device - gateway->devices);
+	}
+}
+
+static void recordEvent(GATEWAY * gateway, const char * frame, uint64_t nowMs)
+{
+	if (gateway->batchEvents == 0)
+	{
+		gateway->batchStartMs = nowMs;
+	}
+	
+	int n = snprintf(&gateway->batch[gateway->batchLength], GATEWAY_BATCH_BYTES - gateway->batchLength,
+		"%llu,%c%c,%.9s\n", (unsigned long long)nowMs, frame[1], frame[2], &frame[3]);
+	
+	gateway->batchLength += (size_t)n;
+	gateway->batchEvents++;
+	gateway->stats.events++;
+}
+
+static void sendFrame(GATEWAY * gateway, const char * id, const char * body)
+{
+	char frame[LLAP_FRAME_LENGTH + 1];
+	
+	// Bodies are padded to full length with '-', as LLAP expects
+	snprintf(frame, sizeof(frame), "a%c%c%-9.9s", id[0], id[1], body);
+	for (uint8_t i = 3; i < LLAP_FRAME_LENGTH; ++i)
+	{
+		if (frame[i] == ' ') { frame[i] = '-'; }
+	}
+	
+	gateway->stats.framesOut++;
+	
+	if (gateway->send)
+	{
+		gateway->send(frame, gateway->sendArg);
+	}
+}
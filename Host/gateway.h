@@ -0,0 +1,52 @@
+#ifndef _GATEWAY_H_
+#define _GATEWAY_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define GATEWAY_MAX_DEVICES			(8192)
+#define GATEWAY_MAX_CONFIG			(4)		// Pending configuration pushes per device
+#define GATEWAY_CONFIG_LENGTH		(9)		// LLAP message body length
+#define GATEWAY_BATCH_BYTES			(64 * 1024)
+#define GATEWAY_BATCH_EVENTS		(1024)
+#define GATEWAY_BATCH_MS			(1000)
+#define GATEWAY_TIME_SYNC_MS		(6ULL * 3600ULL * 1000ULL)	// Per device, sent after WAKE
+
+/*
+ * Outgoing LLAP frames (LLAP_FRAME_LENGTH characters, not null terminated)
+ */
+typedef void (*GATEWAY_SEND_FN)(const char * frame, void * arg);
+
+typedef struct gateway GATEWAY;
+
+struct gateway_stats
+{
+	uint64_t framesIn;
+	uint64_t framesOut;
+	uint64_t events;
+	uint64_t acks;
+	uint64_t acksCoalesced;
+	uint64_t configSent;
+	uint64_t configCoalesced;
+	uint64_t timeSyncs;
+	uint64_t batchesWritten;
+	uint32_t devices;
+};
+typedef struct gateway_stats GATEWAY_STATS;
+
+/*
+ * Public Function Prototypes
+ */
+
+GATEWAY * GATEWAY_Create(int eventFd, bool syncBatches, GATEWAY_SEND_FN send, void * sendArg);
+void GATEWAY_Destroy(GATEWAY * gateway);
+
+void GATEWAY_HandleFrame(GATEWAY * gateway, const char * frame, uint64_t nowMs);
+bool GATEWAY_QueueConfig(GATEWAY * gateway, const char * id, const char * body);
+void GATEWAY_Flush(GATEWAY * gateway, uint64_t nowMs);
+void GATEWAY_PersistNow(GATEWAY * gateway);
+
+const GATEWAY_STATS * GATEWAY_GetStats(const GATEWAY * gateway);
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "llap_parse.h"
+#include "gateway.h"
+
+/*
+ * Load generator for the gateway. Replays WAKE/flush report sequences from
+ * many simulated devices through the LLAP scanner and gateway in read sized
+ * chunks, and reports sustained frames per second and the latency from a
+ * chunk arriving to its acknowledgements being sent.
+ *
+ * Usage: gateway_loadgen [-d devices] [-n frames] [-c chunk bytes] [-e event log] [-s]
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define LATENCY_BUCKETS		(4096)	// 1us buckets, the last one catches everything longer
+
+#define ID_ALPHABET_LENGTH	(sizeof(s_idAlphabet) - 1)
+#define MAX_IDS				(ID_ALPHABET_LENGTH * ID_ALPHABET_LENGTH)
+
+/*
+ * Private Function Prototypes
+ */
+
+static uint64_t monotonicNs(void);
+static void makeId(uint32_t device, char * id);
+static void onFrame(const char * frame, void * arg);
+static void countSent(const char * frame, void * arg);
+static uint32_t percentile(double p);
+
+/* 
+ * Private Variables
+ */
+
+// Printable ID characters, avoiding the LLAP start character
+static const char s_idAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789bcdefghijklmnopqrstuvwxyz#$%&()*+,./:;<=>?@[]^_{|}~";
+
+static uint64_t s_latencyHistogram[LATENCY_BUCKETS];
+static uint64_t s_latencyCount;
+static uint64_t s_sent;
+static uint64_t s_nowMs;
+
+int main(int argc, char * argv[])
+{
+	uint32_t nDevices = 4000;
+	uint64_t nFrames = 2000000;
+	size_t chunkBytes = 1200;
+	const char * eventPath = "/dev/null";
+	bool syncBatches = false;
+	int opt;
+	
+	while ((opt = getopt(argc, argv, "d:n:c:e:s")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd': nDevices = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'n': nFrames = strtoull(optarg, NULL, 10); break;
+		case 'c': chunkBytes = strtoul(optarg, NULL, 10); break;
+		case 'e': eventPath = optarg; break;
+		case 's': syncBatches = true; break;
+		default: break;
+		}
+	}
+	
+	if ((nDevices == 0) || (nDevices > MAX_IDS) || (nDevices > GATEWAY_MAX_DEVICES) || (chunkBytes < LLAP_FRAME_LENGTH))
+	{
+		fprintf(stderr, "Devices must be 1 to %u, chunks at least %u bytes\n", (unsigned int)MAX_IDS, LLAP_FRAME_LENGTH);
+		return 1;
+	}
+	
+	int eventFd = open(eventPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	GATEWAY * gateway = GATEWAY_Create(eventFd, syncBatches, countSent, NULL);
+	LLAP_SCANNER scanner;
+	LLAP_ScannerInit(&scanner);
+	
+	// Each device alternates between WAKE and a flush report
+	bool * awake = calloc(nDevices, sizeof(bool));
+	char * chunk = malloc(chunkBytes);
+	
+	srand(1);
+	
+	uint64_t frames = 0;
+	uint64_t busyNs = 0;
+	uint64_t startNs = monotonicNs();
+	
+	while (frames < nFrames)
+	{
+		size_t length = 0;
+		
+		while ((length + LLAP_FRAME_LENGTH <= chunkBytes) && (frames < nFrames))
+		{
+			uint32_t device = (uint32_t)rand() % nDevices;
+			char id[2];
+			makeId(device, id);
+			
+			if (awake[device])
+			{
+				unsigned int duration = (unsigned int)(rand() % 120);
+				snprintf(&chunk[length], LLAP_FRAME_LENGTH + 1, "a%c%cFE%02u%02u%03u", id[0], id[1], 20U + (duration % 10), 25U, duration);
+			}
+			else
+			{
+				snprintf(&chunk[length], LLAP_FRAME_LENGTH + 1, "a%c%cWAKE-----", id[0], id[1]);
+			}
+			
+			awake[device] = !awake[device];
+			length += LLAP_FRAME_LENGTH;
+			frames++;
+		}
+		
+		uint64_t arrivalNs = monotonicNs();
+		s_nowMs = arrivalNs / 1000000U;
+		
+		size_t n = LLAP_ScannerFeed(&scanner, (const uint8_t *)chunk, length, onFrame, gateway);
+		GATEWAY_Flush(gateway, s_nowMs);
+		
+		uint64_t doneNs = monotonicNs();
+		uint64_t latencyUs = (doneNs - arrivalNs) / 1000U;
+		
+		s_latencyHistogram[(latencyUs < LATENCY_BUCKETS) ? latencyUs : (LATENCY_BUCKETS - 1)] += n;
+		s_latencyCount += n;
+		busyNs += doneNs - arrivalNs;
+	}
+	
+	GATEWAY_PersistNow(gateway);
+	
+	double elapsed = (double)(monotonicNs() - startNs) / 1e9;
+	const GATEWAY_STATS * stats = GATEWAY_GetStats(gateway);
+	
+	printf("devices          %u\n", stats->devices);
+	printf("frames           %llu\n", (unsigned long long)stats->framesIn);
+	printf("frames/sec       %.0f (gateway busy time only: %.0f)\n", (double)stats->framesIn / elapsed, (double)stats->framesIn / ((double)busyNs / 1e9));
+	printf("events           %llu in %llu batches\n", (unsigned long long)stats->events, (unsigned long long)stats->batchesWritten);
+	printf("acks sent        %llu (%llu reports coalesced)\n", (unsigned long long)stats->acks, (unsigned long long)stats->acksCoalesced);
+	printf("frames out       %llu\n", (unsigned long long)s_sent);
+	printf("latency p50      %u us\n", percentile(0.50));
+	printf("latency p99      %u us\n", percentile(0.99));
+	printf("latency p99.9    %u us\n", percentile(0.999));
+	printf("latency max      %u us%s\n", percentile(1.0), (percentile(1.0) == LATENCY_BUCKETS - 1) ? "+" : "");
+	
+	GATEWAY_Destroy(gateway);
+	free(awake);
+	free(chunk);
+	close(eventFd);
+	
+	return 0;
+}
+
+static uint64_t monotonicNs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+static void makeId(uint32_t device, char * id)
+{
+	id[0] = s_idAlphabet[(device / ID_ALPHABET_LENGTH) % ID_ALPHABET_LENGTH];
+	id[1] = s_idAlphabet[device % ID_ALPHABET_LENGTH];
+}
+
+static void onFrame(const char * frame, void * arg)
+{
+	GATEWAY_HandleFrame((GATEWAY *)arg, frame, s_nowMs);
+}
+
+static void countSent(const char * frame, void * arg)
+{
+	(void)frame; (void)arg;
+	s_sent++;
+}
+
+static uint32_t percentile(double p)
+{
+	uint64_t target = (uint64_t)(p * (double)s_latencyCount);
+	uint64_t seen = 0;
+	
+	for (uint32_t i = 0; i < LATENCY_BUCKETS; ++i)
+	{
+		seen += s_latencyHistogram[i];
+		if ((seen >= target) && (seen > 0)) { return i; }
+	}
+	
+	return LATENCY_BUCKETS - 1;
+}
@@ -0,0 +1,131 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "llap_parse.h"
+#include "gateway.h"
+#include "host_test.h"
+
+/*
+ * Checks acknowledgement and configuration coalescing, and batched event
+ * persistence, in the gateway.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Private Function Prototypes
+ */
+
+static void onSend(const char * frame, void * arg);
+
+/* 
+ * Private Variables
+ */
+
+static int failures = 0;
+static char sent[8][LLAP_FRAME_LENGTH + 1];
+static int nSent;
+
+int main(int argc, char * argv[])
+{
+	(void)argc; (void)argv;
+	
+	int pipeFds[2];
+	char events[512] = {0};
+	
+	CHECK(pipe(pipeFds) == 0);
+	
+	GATEWAY * gateway = GATEWAY_Create(pipeFds[1], false, onSend, NULL);
+	
+	// Three reports from AA and one from BB in one read: one ack each
+	GATEWAY_HandleFrame(gateway, "aAAFE2015012", 1000);
+	GATEWAY_HandleFrame(gateway, "aAAFE2015013", 1001);
+	GATEWAY_HandleFrame(gateway, "aBBFE2116034", 1002);
+	GATEWAY_HandleFrame(gateway, "aAAFE2015014", 1003);
+	GATEWAY_Flush(gateway, 1010);
+	
+	CHECK(nSent == 2);
+	CHECK(strcmp(sent[0], "aAAACK003---") == 0);
+	CHECK(strcmp(sent[1], "aBBACK001---") == 0);
+	
+	// Events are held until the batch is due
+	CHECK(GATEWAY_GetStats(gateway)->batchesWritten == 0);
+	
+	// Newer threshold replaces the older one, sent when BB is next heard
+	nSent = 0;
+	CHECK(GATEWAY_QueueConfig(gateway, "BB", "TH450"));
+	CHECK(GATEWAY_QueueConfig(gateway, "BB", "TH500"));
+	GATEWAY_Flush(gateway, 1020);
+	CHECK(nSent == 0);
+	
+	// The first WAKE from a device is also answered with the time
+	GATEWAY_HandleFrame(gateway, "aBBWAKE-----", 2500);
+	GATEWAY_Flush(gateway, 2500);
+	CHECK(nSent == 3);
+	CHECK(strcmp(sent[0], "aBBACK------") == 0);
+	CHECK(strcmp(sent[1], "aBBS00000003") == 0);
+	CHECK(strcmp(sent[2], "aBBTH500----") == 0);
+	
+	CHECK(GATEWAY_GetStats(gateway)->batchesWritten == 1);
+	CHECK(read(pipeFds[0], events, sizeof(events) - 1) > 0);
+	CHECK(strcmp(events, "1000,AA,FE2015012\n1001,AA,FE2015013\n1002,BB,FE2116034\n1003,AA,FE2015014\n") == 0);
+	
+	// Batched flush reports are acknowledged like single ones
+	nSent = 0;
+	GATEWAY_HandleFrame(gateway, "aCCFB2005012", 3000);
+	GATEWAY_HandleFrame(gateway, "aCCFB2003014", 3001);
+	GATEWAY_Flush(gateway, 3010);
+	CHECK(nSent == 1);
+	CHECK(strcmp(sent[0], "aCCACK002---") == 0);
+	
+	// Time syncs are only repeated after GATEWAY_TIME_SYNC_MS
+	nSent = 0;
+	GATEWAY_HandleFrame(gateway, "aBBWAKE-----", 4000);
+	GATEWAY_Flush(gateway, 4000);
+	CHECK(nSent == 1);
+	GATEWAY_HandleFrame(gateway, "aBBWAKE-----", 2500 + GATEWAY_TIME_SYNC_MS);
+	GATEWAY_Flush(gateway, 2500 + GATEWAY_TIME_SYNC_MS);
+	CHECK(nSent == 3);
+	CHECK(strcmp(sent[2], "aBBS00005463") == 0);
+	
+	// Baseline history frames are logged, in the batch after the FB reports, but not acknowledged
+	nSent = 0;
+	memset(events, 0, sizeof(events));
+	GATEWAY_HandleFrame(gateway, "aCCBD013A982", 5000);
+	GATEWAY_HandleFrame(gateway, "aCCB0FFD0608", 5120);
+	GATEWAY_Flush(gateway, 5120);
+	CHECK(nSent == 0);
+	GATEWAY_PersistNow(gateway);
+	CHECK(read(pipeFds[0], events, sizeof(events) - 1) > 0);
+	CHECK(strcmp(events, "3000,CC,FB2005012\n3001,CC,FB2003014\n5000,CC,BD013A982\n5120,CC,B0FFD0608\n") == 0);
+	
+	GATEWAY_Destroy(gateway);
+	
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
+
+static void onSend(const char * frame, void * arg)
+{
+	(void)arg;
+	
+	if (nSent < 8)
+	{
+		memcpy(sent[nSent], frame, LLAP_FRAME_LENGTH);
+		sent[nSent][LLAP_FRAME_LENGTH] = '\0';
+		nSent++;
+	}
+}
@@ -0,0 +1,247 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "llap_parse.h"
+#include "serial_port.h"
+#include "gateway.h"
+
+/*
+ * LLAP gateway for many sensors sharing one radio link.
+ *
+ * Usage: gatewayd [-s] [-e event log] <serial port>
+ *
+ * Flush reports are appended to the event log in batches (-s to fdatasync
+ * each batch). Configuration pushes are read from stdin as "<id> <body>"
+ * lines, e.g. "AB TH450", and delivered the next time that device is heard.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define LLAP_BAUD			(4800)
+#define READ_BUFFER_SIZE	(4096)
+#define COMMAND_LENGTH		(64)
+
+struct command_scanner
+{
+	char line[COMMAND_LENGTH];
+	size_t length;
+};
+typedef struct command_scanner COMMAND_SCANNER;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void onSignal(int sig);
+static uint64_t realtimeMs(void);
+static void onFrame(const char * frame, void * arg);
+static void sendToRadio(const char * frame, void * arg);
+static bool readCommands(GATEWAY * gateway, COMMAND_SCANNER * scanner);
+static void feedCommands(GATEWAY * gateway, COMMAND_SCANNER * scanner, const uint8_t * data, size_t length);
+static void handleCommand(GATEWAY * gateway, const char * line);
+
+/* 
+ * Private Variables
+ */
+
+static volatile sig_atomic_t s_stop = 0;
+static uint64_t s_nowMs;
+
+int main(int argc, char * argv[])
+{
+	const char * eventPath = "events.log";
+	bool syncBatches = false;
+	int opt;
+	
+	while ((opt = getopt(argc, argv, "se:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's': syncBatches = true; break;
+		case 'e': eventPath = optarg; break;
+		default: break;
+		}
+	}
+	
+	if (optind >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-s] [-e event log] <serial port>\n", argv[0]);
+		return 1;
+	}
+	
+	int radioFd = SERIAL_Open(argv[optind], LLAP_BAUD, true);
+	int eventFd = open(eventPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	
+	if ((radioFd < 0) || (eventFd < 0))
+	{
+		perror("open");
+		return 1;
+	}
+	
+	GATEWAY * gateway = GATEWAY_Create(eventFd, syncBatches, sendToRadio, &radioFd);
+	LLAP_SCANNER scanner;
+	LLAP_ScannerInit(&scanner);
+	COMMAND_SCANNER commands = { {0}, 0 };
+	
+	int epollFd = epoll_create1(0);
+	struct epoll_event ev = { .events = EPOLLIN, .data.fd = radioFd };
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, radioFd, &ev);
+	
+	// Read like the radio, so no command is left waiting in a stdio buffer
+	fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+	ev.data.fd = STDIN_FILENO;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) < 0)
+	{
+		// A regular file can't be polled: take all its commands now
+		while (readCommands(gateway, &commands)) {}
+	}
+	
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	
+	while (!s_stop)
+	{
+		struct epoll_event events[2];
+		int n = epoll_wait(epollFd, events, 2, GATEWAY_BATCH_MS);
+		
+		s_nowMs = realtimeMs();
+		
+		for (int i = 0; i < n; ++i)
+		{
+			if (events[i].data.fd == radioFd)
+			{
+				uint8_t buffer[READ_BUFFER_SIZE];
+				ssize_t length;
+				
+				while ((length = read(radioFd, buffer, sizeof(buffer))) > 0)
+				{
+					LLAP_ScannerFeed(&scanner, buffer, (size_t)length, onFrame, gateway);
+				}
+			}
+			else if (!readCommands(gateway, &commands))
+			{
+				// End of input: a hung up stdin would otherwise stay ready for ever
+				epoll_ctl(epollFd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+			}
+		}
+		
+		// One acknowledgement per device for everything read this time round
+		GATEWAY_Flush(gateway, s_nowMs);
+	}
+	
+	const GATEWAY_STATS * stats = GATEWAY_GetStats(gateway);
+	fprintf(stderr, "%llu frames in, %llu out, %llu events, %llu acks (%llu coalesced), %u devices\n",
+		(unsigned long long)stats->framesIn, (unsigned long long)stats->framesOut,
+		(unsigned long long)stats->events, (unsigned long long)stats->acks,
+		(unsigned long long)stats->acksCoalesced, stats->devices);
+	
+	GATEWAY_Destroy(gateway);
+	close(eventFd);
+	close(radioFd);
+	
+	return 0;
+}
+
+static void onSignal(int sig)
+{
+	(void)sig;
+	s_stop = 1;
+}
+
+static uint64_t realtimeMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return ((uint64_t)now.tv_sec * 1000U) + ((uint64_t)now.tv_nsec / 1000000U);
+}
+
+static void onFrame(const char * frame, void * arg)
+{
+	GATEWAY_HandleFrame((GATEWAY *)arg, frame, s_nowMs);
+}
+
+static void sendToRadio(const char * frame, void * arg)
+{
+	if (write(*(int *)arg, frame, LLAP_FRAME_LENGTH) != LLAP_FRAME_LENGTH)
+	{
+		perror("radio");
+	}
+}
+
+/*
+ * Reads everything waiting on stdin. Returns false at the end of input,
+ * after handling any last unterminated line.
+ */
+static bool readCommands(GATEWAY * gateway, COMMAND_SCANNER * scanner)
+{
+	uint8_t buffer[READ_BUFFER_SIZE];
+	ssize_t length;
+	
+	while ((length = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+	{
+		feedCommands(gateway, scanner, buffer, (size_t)length);
+	}
+	
+	if ((length < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+	{
+		return true;
+	}
+	
+	if (scanner->length > 0)
+	{
+		feedCommands(gateway, scanner, (const uint8_t *)"\n", 1);
+	}
+	
+	return false;
+}
+
+static void feedCommands(GATEWAY * gateway, COMMAND_SCANNER * scanner, const uint8_t * data, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (data[i] == '\n')
+		{
+			scanner->line[scanner->length] = '\0';
+			handleCommand(gateway, scanner->line);
+			scanner->length = 0;
+		}
+		else if (scanner->length < (COMMAND_LENGTH - 1))
+		{
+			scanner->line[scanner->length++] = (char)data[i];
+		}
+	}
+}
+
+static void handleCommand(GATEWAY * gateway, const char * line)
+{
+	char id[3];
+	char body[GATEWAY_CONFIG_LENGTH + 1];
+	
+	if (line[0] == '\0')
+	{
+		return;
+	}
+	
+	if ((sscanf(line, "%2s %9s", id, body) != 2) || !GATEWAY_QueueConfig(gateway, id, body))
+	{
+		fprintf(stderr, "Bad command: %s\n", line);
+	}
+}
@@ -0,0 +1,180 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Compares the sensor's report handshakes under different master behaviour:
+ *
+ * fixed:  WAKE, wait COMMS_TICK_MS, send the report whether or not the master
+ *         is listening (the original behaviour).
+ * ack:    WAKE, send the report as soon as the master replies, resending WAKE
+ *         with a doubled wait up to WAKE_RETRIES times before giving up.
+ *
+ * Latency is from the start of WAKE to the end of the report, over delivered
+ * reports only. Radio on time is over every attempt, delivered or not: the
+ * radio stays on from the start of WAKE until the report is sent or the
+ * sensor gives up, since it must listen for the reply. Timings mirror
+ * latrinesensor.c.
+ *
+ * Usage: handshake_sim [reports per scenario]
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define COMMS_TICK_MS		(120)
+#define WAKE_RETRIES		(3)
+
+#define LLAP_BAUD			(4800.0)
+#define FRAME_MS			((12.0 * 10.0 * 1000.0) / LLAP_BAUD) // 12 characters, 8N1
+
+struct scenario
+{
+	const char * name;
+	double readyMinMs;	// Master reply latency after it hears WAKE
+	double readyMaxMs;
+	double pLost;		// Chance each WAKE or reply is lost
+	double pAbsent;		// Chance the master is not listening at all for this report
+};
+typedef struct scenario SCENARIO;
+
+struct stats
+{
+	double totalLatency;
+	double totalRadio;
+	uint32_t delivered;
+	double * latencies;
+	uint32_t n;
+};
+typedef struct stats STATS;
+
+/*
+ * Private Function Prototypes
+ */
+
+static double uniform(double a, double b);
+static bool chance(double p);
+static double fixedWait(const SCENARIO * s, bool * delivered);
+static double ackDriven(const SCENARIO * s, bool * delivered);
+static int compareDouble(const void * a, const void * b);
+static void report(const char * scheme, const SCENARIO * s, STATS * stats);
+
+static const SCENARIO scenarios[] = {
+	{ "fast master",	2.0,	10.0,	0.00,	0.00 },
+	{ "typical",		5.0,	60.0,	0.02,	0.00 },
+	{ "slow master",	80.0,	200.0,	0.02,	0.00 },
+	{ "lossy link",		5.0,	60.0,	0.20,	0.00 },
+	{ "master away",	5.0,	60.0,	0.02,	0.10 },
+};
+
+int main(int argc, char * argv[])
+{
+	uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+	
+	srand(1);
+	
+	printf("%-12s %-6s %10s %10s %10s %10s %10s\n", "scenario", "scheme", "delivered", "mean ms", "p95 ms", "max ms", "radio ms");
+	
+	for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
+	{
+		for (uint8_t scheme = 0; scheme < 2; ++scheme)
+		{
+			STATS stats = { 0, 0, 0, calloc(n, sizeof(double)), n };
+			
+			for (uint32_t r = 0; r < n; ++r)
+			{
+				bool delivered;
+				double ms = scheme ? ackDriven(&scenarios[i], &delivered) : fixedWait(&scenarios[i], &delivered);
+				
+				stats.totalRadio += ms;
+				
+				if (delivered)
+				{
+					stats.latencies[stats.delivered++] = ms;
+					stats.totalLatency += ms;
+				}
+			}
+			
+			report(scheme ? "ack" : "fixed", &scenarios[i], &stats);
+			free(stats.latencies);
+		}
+	}
+	
+	return 0;
+}
+
+static double uniform(double a, double b)
+{
+	return a + ((b - a) * ((double)rand() / (double)RAND_MAX));
+}
+
+static bool chance(double p)
+{
+	return ((double)rand() / (double)RAND_MAX) < p;
+}
+
+static double fixedWait(const SCENARIO * s, bool * delivered)
+{
+	// The report is only heard if the master was listening and ready in time
+	bool heard = !chance(s->pAbsent) && !chance(s->pLost) && !chance(s->pLost);
+	double readyMs = FRAME_MS + uniform(s->readyMinMs, s->readyMaxMs);
+	
+	*delivered = heard && (readyMs <= (FRAME_MS + COMMS_TICK_MS));
+	
+	return FRAME_MS + COMMS_TICK_MS + FRAME_MS;
+}
+
+static double ackDriven(const SCENARIO * s, bool * delivered)
+{
+	bool absent = chance(s->pAbsent);
+	double t = 0;
+	
+	for (uint8_t attempt = 0; attempt <= WAKE_RETRIES; ++attempt)
+	{
+		double waitMs = (double)(COMMS_TICK_MS << attempt);
+		
+		t += FRAME_MS; // WAKE
+		
+		if (!absent && !chance(s->pLost))
+		{
+			double replyMs = uniform(s->readyMinMs, s->readyMaxMs) + FRAME_MS;
+			
+			if (!chance(s->pLost) && (replyMs <= waitMs))
+			{
+				*delivered = true;
+				return t + replyMs + FRAME_MS;
+			}
+		}
+		
+		t += waitMs;
+	}
+	
+	*delivered = false;
+	return t;
+}
+
+static int compareDouble(const void * a, const void * b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static void report(const char * scheme, const SCENARIO * s, STATS * stats)
+{
+	uint32_t d = stats->delivered;
+	
+	qsort(stats->latencies, d, sizeof(double), compareDouble);
+	
+	printf("%-12s %-6s %9.1f%% %10.1f %10.1f %10.1f %10.1f\n", s->name, scheme,
+		100.0 * d / stats->n,
+		d ? stats->totalLatency / d : 0.0,
+		d ? stats->latencies[(size_t)(0.95 * (d - 1))] : 0.0,
+		d ? stats->latencies[d - 1] : 0.0,
+		stats->totalRadio / stats->n);
+}
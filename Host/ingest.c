@@ -0,0 +1,602 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "capture.h"
+#include "capture_parse.h"
+#include "llap_parse.h"
+#include "serial_port.h"
+#include "series.h"
+#include "ingest.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define READ_BUFFER_SIZE	(8192)
+#define REQUEST_LENGTH		(128)
+#define MAX_EVENTS			(32)
+
+enum source_type
+{
+	SOURCE_PORT,
+	SOURCE_LISTENER,
+	SOURCE_CLIENT
+};
+typedef enum source_type SOURCE_TYPE;
+
+struct device
+{
+	char name[INGEST_NAME_LENGTH];
+	SERIES series;
+};
+typedef struct device DEVICE;
+
+struct port
+{
+	SOURCE_TYPE type;
+	int fd;
+	char name[INGEST_NAME_LENGTH];
+	INGEST_FORMAT eFormat;
+	INGEST * ingest;
+	
+	int device; // Single device for capture and text ports
+	
+	LLAP_SCANNER llap;
+	CAPTURE_PARSER capture;
+	int32_t textValue;
+	bool textHaveDigits;
+};
+typedef struct port PORT;
+
+struct client
+{
+	SOURCE_TYPE type;
+	int fd;
+	char request[REQUEST_LENGTH];
+	size_t requestLength;
+	
+	// Response not yet taken by the socket, sent as it becomes writable
+	char * output;
+	size_t outputLength;
+	size_t outputSent;
+};
+typedef struct client CLIENT;
+
+struct ingest
+{
+	int epollFd;
+	uint32_t historyLength;
+	uint32_t nowMs;
+	
+	DEVICE devices[INGEST_MAX_DEVICES];
+	size_t nDevices;
+	
+	PORT ports[INGEST_MAX_PORTS];
+	size_t nPorts;
+	
+	SOURCE_TYPE listenerType;
+	int listenFd;
+	
+	CLIENT clients[INGEST_MAX_CLIENTS];
+};
+
+/*
+ * Private Function Prototypes
+ */
+
+static uint32_t monotonicMs(void);
+static int getDevice(INGEST * ingest, const char * name);
+static void readPort(INGEST * ingest, PORT * port, uint32_t events);
+static void closePort(INGEST * ingest, PORT * port);
+static void onLLAPFrame(const char * frame, void * arg);
+static void onCaptureFrame(const CAPTURE_FRAME * frame, uint8_t lost, void * arg);
+static void parseText(INGEST * ingest, PORT * port, const uint8_t * data, size_t length);
+static void acceptClient(INGEST * ingest);
+static void readClient(INGEST * ingest, CLIENT * client);
+static bool writeClient(INGEST * ingest, CLIENT * client);
+static bool queueOutput(CLIENT * client, const char * data, size_t length);
+static void closeClient(INGEST * ingest, CLIENT * client);
+static bool handleRequest(INGEST * ingest, CLIENT * client, char * request);
+
+/*
+ * Public Function Defintions
+ */
+
+INGEST * INGEST_Create(uint32_t historyLength)
+{
+	INGEST * ingest = calloc(1, sizeof(INGEST));
+	
+	if (!ingest) { return NULL; }
+	
+	ingest->epollFd = epoll_create1(0);
+	ingest->historyLength = historyLength;
+	ingest->listenFd = -1;
+	ingest->listenerType = SOURCE_LISTENER;
+	
+	for (size_t i = 0; i < INGEST_MAX_CLIENTS; ++i)
+	{
+		ingest->clients[i].type = SOURCE_CLIENT;
+		ingest->clients[i].fd = -1;
+	}
+	
+	if (ingest->epollFd < 0)
+	{
+		free(ingest);
+		return NULL;
+	}
+	
+	return ingest;
+}
+
+void INGEST_Destroy(INGEST * ingest)
+{
+	for (size_t i = 0; i < ingest->nPorts; ++i)
+	{
+		if (ingest->ports[i].fd >= 0) { close(ingest->ports[i].fd); }
+	}
+	for (size_t i = 0; i < INGEST_MAX_CLIENTS; ++i)
+	{
+		if (ingest->clients[i].fd >= 0) { close(ingest->clients[i].fd); }
+		free(ingest->clients[i].output);
+	}
+	for (size_t i = 0; i < ingest->nDevices; ++i) { SERIES_Free(&ingest->devices[i].series); }
+	if (ingest->listenFd >= 0) { close(ingest->listenFd); }
+	
+	close(ingest->epollFd);
+	free(ingest);
+}
+
+int INGEST_AddPort(INGEST * ingest, const char * name, const char * path, INGEST_FORMAT eFormat, uint32_t baud)
+{
+	if (ingest->nPorts == INGEST_MAX_PORTS) { return -1; }
+	
+	int fd = SERIAL_Open(path, baud, true);
+	if (fd < 0) { return -1; }
+	
+	PORT * port = &ingest->ports[ingest->nPorts];
+	memset(port, 0, sizeof(*port));
+	port->type = SOURCE_PORT;
+	port->fd = fd;
+	port->eFormat = eFormat;
+	port->ingest = ingest;
+	port->device = -1;
+	snprintf(port->name, sizeof(port->name), "%s", name);
+	LLAP_ScannerInit(&port->llap);
+	CAPTURE_ParserInit(&port->capture);
+	
+	if (eFormat != INGEST_FORMAT_LLAP)
+	{
+		port->device = getDevice(ingest, name);
+		if (port->device < 0) { close(fd); return -1; }
+	}
+	
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = port };
+	if (epoll_ctl(ingest->epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	
+	ingest->nPorts++;
+	return 0;
+}
+
+int INGEST_Listen(INGEST * ingest, uint16_t tcpPort)
+{
+	struct sockaddr_in addr;
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	
+	if (fd < 0) { return -1; }
+	
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(tcpPort);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	
+	if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(fd, 4) < 0))
+	{
+		close(fd);
+		return -1;
+	}
+	
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &ingest->listenerType };
+	epoll_ctl(ingest->epollFd, EPOLL_CTL_ADD, fd, &ev);
+	ingest->listenFd = fd;
+	
+	return 0;
+}
+
+/*
+ * Waits up to timeoutMs for input and handles everything that is ready.
+ * Returns the number of ready sources, or -1 on error.
+ */
+int INGEST_Poll(INGEST * ingest, int timeoutMs)
+{
+	struct epoll_event events[MAX_EVENTS];
+	
+	int n = epoll_wait(ingest->epollFd, events, MAX_EVENTS, timeoutMs);
+	
+	if (n < 0) { return (errno == EINTR) ? 0 : -1; }
+	
+	ingest->nowMs = monotonicMs();
+	
+	for (int i = 0; i < n; ++i)
+	{
+		// Every source struct starts with its type
+		SOURCE_TYPE * type = events[i].data.ptr;
+		
+		switch (*type)
+		{
+		case SOURCE_PORT:
+			readPort(ingest, (PORT *)type, events[i].events);
+			break;
+		case SOURCE_LISTENER:
+			acceptClient(ingest);
+			break;
+		case SOURCE_CLIENT:
+			if (events[i].events & EPOLLOUT)
+			{
+				(void)writeClient(ingest, (CLIENT *)type);
+			}
+			else
+			{
+				readClient(ingest, (CLIENT *)type);
+			}
+			break;
+		}
+	}
+	
+	return n;
+}
+
+size_t INGEST_DeviceCount(const INGEST * ingest)
+{
+	return ingest->nDevices;
+}
+
+const char * INGEST_DeviceName(const INGEST * ingest, size_t device)
+{
+	return (device < ingest->nDevices) ? ingest->devices[device].name : NULL;
+}
+
+int INGEST_FindDevice(const INGEST * ingest, const char * name)
+{
+	for (size_t i = 0; i < ingest->nDevices; ++i)
+	{
+		if (strcmp(ingest->devices[i].name, name) == 0) { return (int)i; }
+	}
+	return -1;
+}
+
+uint32_t INGEST_DeviceSamples(const INGEST * ingest, size_t device)
+{
+	return (device < ingest->nDevices) ? ingest->devices[device].series.written : 0;
+}
+
+size_t INGEST_Downsample(const INGEST * ingest, size_t device, uint32_t spanMs, SERIES_POINT * points, size_t nPoints)
+{
+	if ((device >= ingest->nDevices) || (nPoints == 0) || (nPoints > INGEST_MAX_POINTS)) { return 0; }
+	
+	return SERIES_Downsample(&ingest->devices[device].series, monotonicMs(), spanMs, points, nPoints);
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static uint32_t monotonicMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)((now.tv_sec * 1000) + (now.tv_nsec / 1000000));
+}
+
+static int getDevice(INGEST * ingest, const char * name)
+{
+	int device = INGEST_FindDevice(ingest, name);
+	
+	if ((device < 0) && (ingest->nDevices < INGEST_MAX_DEVICES))
+	{
+		DEVICE * d = &ingest->devices[ingest->nDevices];
+		snprintf(d->name, sizeof(d->name), "%s", name);
+		
+		if (SERIES_Init(&d->series, ingest->historyLength))
+		{
+			device = (int)ingest->nDevices++;
+		}
+	}
+	
+	return device;
+}
+
+static void readPort(INGEST * ingest, PORT * port, uint32_t events)
+{
+	uint8_t buffer[READ_BUFFER_SIZE];
+	ssize_t n;
+	
+	while ((n = read(port->fd, buffer, sizeof(buffer))) > 0)
+	{
+		switch (port->eFormat)
+		{
+		case INGEST_FORMAT_LLAP:
+			LLAP_ScannerFeed(&port->llap, buffer, (size_t)n, onLLAPFrame, port);
+			break;
+		case INGEST_FORMAT_CAPTURE:
+			CAPTURE_ParserFeed(&port->capture, buffer, (size_t)n, onCaptureFrame, port);
+			break;
+		case INGEST_FORMAT_TEXT:
+			parseText(ingest, port, buffer, (size_t)n);
+			break;
+		}
+	}
+	
+	// Once drained, a hung up port (pty closed, USB adapter unplugged) stays
+	// readable with nothing to read, so it has to come out of the epoll set
+	bool hungUp = (n == 0) || ((n < 0) && (errno != EAGAIN) && (errno != EINTR));
+	
+	if (hungUp || ((n < 0) && (events & (EPOLLHUP | EPOLLERR))))
+	{
+		closePort(ingest, port);
+	}
+}
+
+static void closePort(INGEST * ingest, PORT * port)
+{
+	fprintf(stderr, "Port %s closed\n", port->name);
+	
+	epoll_ctl(ingest->epollFd, EPOLL_CTL_DEL, port->fd, NULL);
+	close(port->fd);
+	port->fd = -1;
+}
+
+/*
+ * LLAP frames are "aXXDDDDDDDDD": ID XX and nine data characters. Flush
+ * reports ("FE" followed by two temperatures and a duration, or "FB" from a
+ * batch, with the age in place of the ambient temperature) add the flush
+ * duration in seconds to the history of the device with that ID.
+ */
+static void onLLAPFrame(const char * frame, void * arg)
+{
+	PORT * port = arg;
+	INGEST * ingest = port->ingest;
+	char name[INGEST_NAME_LENGTH];
+	
+	snprintf(name, sizeof(name), "%.59s/%c%c", port->name, frame[1], frame[2]);
+	int device = getDevice(ingest, name);
+	
+	if ((device >= 0) && (frame[3] == 'F') && ((frame[4] == 'E') || (frame[4] == 'B')))
+	{
+		const char * duration = &frame[9];
+		
+		if ((duration[0] >= '0') && (duration[0] <= '9'))
+		{
+			int32_t secs = ((duration[0] - '0') * 100) + ((duration[1] - '0') * 10) + (duration[2] - '0');
+			SERIES_Push(&ingest->devices[device].series, ingest->nowMs, secs);
+		}
+	}
+}
+
+static void onCaptureFrame(const CAPTURE_FRAME * frame, uint8_t lost, void * arg)
+{
+	(void)lost;
+	PORT * port = arg;
+	INGEST * ingest = port->ingest;
+	
+	SERIES_Push(&ingest->devices[port->device].series, ingest->nowMs, frame->pulses);
+}
+
+static void parseText(INGEST * ingest, PORT * port, const uint8_t * data, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		uint8_t c = data[i];
+		
+		if ((c >= '0') && (c <= '9'))
+		{
+			port->textValue = (port->textValue * 10) + (c - '0');
+			port->textHaveDigits = true;
+		}
+		else if (c == '\n')
+		{
+			if (port->textHaveDigits)
+			{
+				SERIES_Push(&ingest->devices[port->device].series, ingest->nowMs, port->textValue);
+			}
+			port->textValue = 0;
+			port->textHaveDigits = false;
+		}
+	}
+}
+
+static void acceptClient(INGEST * ingest)
+{
+	int fd;
+	
+	while ((fd = accept4(ingest->listenFd, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+	{
+		CLIENT * client = NULL;
+		
+		for (size_t i = 0; i < INGEST_MAX_CLIENTS; ++i)
+		{
+			if (ingest->clients[i].fd < 0) { client = &ingest->clients[i]; break; }
+		}
+		
+		if (!client)
+		{
+			close(fd);
+			continue;
+		}
+		
+		client->fd = fd;
+		client->requestLength = 0;
+		client->outputLength = 0;
+		client->outputSent = 0;
+		
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = client };
+		epoll_ctl(ingest->epollFd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+static void readClient(INGEST * ingest, CLIENT * client)
+{
+	char buffer[512];
+	ssize_t n = read(client->fd, buffer, sizeof(buffer));
+	
+	if ((n <= 0) && !((n < 0) && (errno == EAGAIN)))
+	{
+		closeClient(ingest, client);
+		return;
+	}
+	
+	for (ssize_t i = 0; i < n; ++i)
+	{
+		if (buffer[i] == '\n')
+		{
+			client->request[client->requestLength] = '\0';
+			client->requestLength = 0;
+			
+			if (!handleRequest(ingest, client, client->request)) { return; }
+		}
+		else if (client->requestLength < (REQUEST_LENGTH - 1))
+		{
+			client->request[client->requestLength++] = buffer[i];
+		}
+	}
+}
+
+/*
+ * Sends as much of the queued response as the socket takes. While any is
+ * left, the client is only polled for writing, so further requests wait in
+ * the socket until the viewer has read the response. Returns false if the
+ * client was closed.
+ */
+static bool writeClient(INGEST * ingest, CLIENT * client)
+{
+	while (client->outputSent < client->outputLength)
+	{
+		ssize_t n = write(client->fd, &client->output[client->outputSent], client->outputLength - client->outputSent);
+		
+		if (n < 0)
+		{
+			if (errno == EINTR) { continue; }
+			if (errno == EAGAIN) { break; }
+			
+			closeClient(ingest, client);
+			return false;
+		}
+		
+		client->outputSent += (size_t)n;
+	}
+	
+	bool pending = (client->outputSent < client->outputLength);
+	
+	if (!pending)
+	{
+		client->outputLength = 0;
+		client->outputSent = 0;
+	}
+	
+	struct epoll_event ev = { .events = pending ? EPOLLOUT : EPOLLIN, .data.ptr = client };
+	epoll_ctl(ingest->epollFd, EPOLL_CTL_MOD, client->fd, &ev);
+	
+	return true;
+}
+
+/* Adds to the client's unsent response, growing the buffer as needed */
+static bool queueOutput(CLIENT * client, const char * data, size_t length)
+{
+	char * output = realloc(client->output, client->outputLength + length);
+	
+	if (!output) { return false; }
+	
+	memcpy(&output[client->outputLength], data, length);
+	client->output = output;
+	client->outputLength += length;
+	
+	return true;
+}
+
+static void closeClient(INGEST * ingest, CLIENT * client)
+{
+	epoll_ctl(ingest->epollFd, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	client->fd = -1;
+	
+	free(client->output);
+	client->output = NULL;
+	client->outputLength = 0;
+	client->outputSent = 0;
+}
+
+/*
+ * Viewer requests, one per line:
+ *   LIST                            -> "OK <n>" then one device name per line
+ *   SERIES <device> <spanMs> <n>    -> "OK <n>" then "<ageMs> <min> <mean> <max> <count>" per line
+ *
+ * Returns false if the client was closed.
+ */
+static bool handleRequest(INGEST * ingest, CLIENT * client, char * request)
+{
+	static SERIES_POINT points[INGEST_MAX_POINTS];
+	static char response[INGEST_MAX_POINTS * 64];
+	size_t length = 0;
+	char device[INGEST_NAME_LENGTH];
+	unsigned long spanMs;
+	unsigned long nPoints;
+	
+	if (strncmp(request, "LIST", 4) == 0)
+	{
+		length += snprintf(&response[length], sizeof(response) - length, "OK %zu\n", ingest->nDevices);
+		for (size_t i = 0; i < ingest->nDevices; ++i)
+		{
+			length += snprintf(&response[length], sizeof(response) - length, "%s\n", ingest->devices[i].name);
+		}
+	}
+	else if ((sscanf(request, "SERIES %63s %lu %lu", device, &spanMs, &nPoints) == 3) &&
+		(INGEST_FindDevice(ingest, device) >= 0) && (nPoints > 0) && (nPoints <= INGEST_MAX_POINTS))
+	{
+		uint32_t nowMs = monotonicMs();
+		size_t n = INGEST_Downsample(ingest, (size_t)INGEST_FindDevice(ingest, device), (uint32_t)spanMs, points, nPoints);
+		
+		length += snprintf(&response[length], sizeof(response) - length, "OK %zu\n", n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			length += snprintf(&response[length], sizeof(response) - length, "%lu %ld %ld %ld %lu\n",
+				(unsigned long)(nowMs - points[i].timeMs), (long)points[i].min, (long)points[i].mean,
+				(long)points[i].max, (unsigned long)points[i].count);
+		}
+	}
+	else
+	{
+		length += snprintf(&response[length], sizeof(response) - length, "ERR\n");
+	}
+	
+	if (!queueOutput(client, response, length))
+	{
+		closeClient(ingest, client);
+		return false;
+	}
+	
+	return writeClient(ingest, client);
+}
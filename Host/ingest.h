@@ -0,0 +1,42 @@
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define INGEST_MAX_DEVICES		(256)
+#define INGEST_MAX_PORTS		(64)
+#define INGEST_MAX_CLIENTS		(16)
+#define INGEST_MAX_POINTS		(2000)
+#define INGEST_NAME_LENGTH		(64)
+
+enum ingest_format
+{
+	INGEST_FORMAT_LLAP,		// LLAP frames, one device per LLAP ID on the port
+	INGEST_FORMAT_CAPTURE,	// Binary capture frames
+	INGEST_FORMAT_TEXT		// One decimal value per line (Arduino sketch)
+};
+typedef enum ingest_format INGEST_FORMAT;
+
+typedef struct ingest INGEST;
+
+/*
+ * Public Function Prototypes
+ */
+
+INGEST * INGEST_Create(uint32_t historyLength);
+void INGEST_Destroy(INGEST * ingest);
+
+int INGEST_AddPort(INGEST * ingest, const char * name, const char * path, INGEST_FORMAT eFormat, uint32_t baud);
+int INGEST_Listen(INGEST * ingest, uint16_t tcpPort);
+
+int INGEST_Poll(INGEST * ingest, int timeoutMs);
+
+size_t INGEST_DeviceCount(const INGEST * ingest);
+const char * INGEST_DeviceName(const INGEST * ingest, size_t device);
+int INGEST_FindDevice(const INGEST * ingest, const char * name);
+uint32_t INGEST_DeviceSamples(const INGEST * ingest, size_t device);
+size_t INGEST_Downsample(const INGEST * ingest, size_t device, uint32_t spanMs, SERIES_POINT * points, size_t nPoints);
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "capture.h"
+#include "series.h"
+#include "ingest.h"
+#include "host_test.h"
+
+/*
+ * Drives the ingest core with ptys standing in for sensor serial ports.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define TEST_TCP_PORT (5399)
+#define LARGE_REQUESTS (256)	// About 6MB of responses, more than the socket buffers hold
+
+/*
+ * Private Function Prototypes
+ */
+
+static int openPty(char * slavePath, size_t length);
+static void writeCaptureFrame(int fd, uint8_t seq, uint16_t pulses);
+static void pollFor(INGEST * ingest, int ms);
+static int readLines(INGEST * ingest, int sock);
+
+/* 
+ * Private Variables
+ */
+
+static int failures = 0;
+
+int main(int argc, char * argv[])
+{
+	(void)argc; (void)argv;
+	
+	char llapPath[64], capturePath[64], textPath[64];
+	int llapFd = openPty(llapPath, sizeof(llapPath));
+	int captureFd = openPty(capturePath, sizeof(capturePath));
+	int textFd = openPty(textPath, sizeof(textPath));
+	SERIES_POINT points[4];
+	
+	INGEST * ingest = INGEST_Create(1024);
+	CHECK(ingest != NULL);
+	CHECK(INGEST_AddPort(ingest, "radio", llapPath, INGEST_FORMAT_LLAP, 4800) == 0);
+	CHECK(INGEST_AddPort(ingest, "cap", capturePath, INGEST_FORMAT_CAPTURE, CAPTURE_BAUD) == 0);
+	CHECK(INGEST_AddPort(ingest, "text", textPath, INGEST_FORMAT_TEXT, 115200) == 0);
+	CHECK(INGEST_Listen(ingest, TEST_TCP_PORT) == 0);
+	
+	// Two LLAP devices on one port, with a frame split across writes and noise
+	const char * llap1 = "xxaAAFE2015012aBBFE21";
+	const char * llap2 = "16034aAAWAKE-----";
+	CHECK(write(llapFd, llap1, strlen(llap1)) > 0);
+	pollFor(ingest, 50);
+	CHECK(write(llapFd, llap2, strlen(llap2)) > 0);
+	
+	for (uint8_t seq = 0; seq < 10; ++seq)
+	{
+		writeCaptureFrame(captureFd, seq, (uint16_t)(1000 + seq));
+	}
+	
+	const char * text = "15000\r\n14000\r\n13000\r\n";
+	CHECK(write(textFd, text, strlen(text)) > 0);
+	
+	pollFor(ingest, 100);
+	
+	int radioA = INGEST_FindDevice(ingest, "radio/AA");
+	int radioB = INGEST_FindDevice(ingest, "radio/BB");
+	int cap = INGEST_FindDevice(ingest, "cap");
+	int txt = INGEST_FindDevice(ingest, "text");
+	
+	CHECK(radioA >= 0);
+	CHECK(radioB >= 0);
+	CHECK(cap >= 0);
+	CHECK(txt >= 0);
+	
+	if (failures == 0)
+	{
+		CHECK(INGEST_DeviceSamples(ingest, radioA) == 1);
+		CHECK(INGEST_DeviceSamples(ingest, radioB) == 1);
+		CHECK(INGEST_DeviceSamples(ingest, cap) == 10);
+		CHECK(INGEST_DeviceSamples(ingest, txt) == 3);
+		
+		INGEST_Downsample(ingest, radioB, 10000, points, 1);
+		CHECK(points[0].count == 1);
+		CHECK(points[0].max == 34);
+		
+		INGEST_Downsample(ingest, cap, 10000, points, 1);
+		CHECK(points[0].min == 1000);
+		CHECK(points[0].max == 1009);
+		
+		INGEST_Downsample(ingest, txt, 10000, points, 1);
+		CHECK(points[0].mean == 14000);
+	}
+	
+	// Viewer protocol over TCP
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(TEST_TCP_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+	pollFor(ingest, 50);
+	
+	const char * request = "SERIES text 10000 2\n";
+	CHECK(write(sock, request, strlen(request)) > 0);
+	pollFor(ingest, 50);
+	
+	char response[256] = {0};
+	CHECK(read(sock, response, sizeof(response) - 1) > 0);
+	CHECK(strncmp(response, "OK 2\n", 5) == 0);
+	
+	close(sock);
+	pollFor(ingest, 50);
+	
+	// A response larger than the socket buffers is sent in pieces as the viewer reads
+	sock = socket(AF_INET, SOCK_STREAM, 0);
+	int small = 4096;
+	setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+	CHECK(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+	pollFor(ingest, 50);
+	
+	request = "SERIES text 10000 2000\n";
+	for (int i = 0; i < LARGE_REQUESTS; ++i)
+	{
+		CHECK(write(sock, request, strlen(request)) > 0);
+	}
+	CHECK(write(sock, "LIST\n", 5) > 0);
+	// Long enough for every request to be handled before the viewer reads any
+	pollFor(ingest, 1000);
+	
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	// Every response whole: the series, then the four devices
+	CHECK(readLines(ingest, sock) == ((LARGE_REQUESTS * (1 + 2000)) + 1 + 4));
+	
+	close(sock);
+	pollFor(ingest, 50);
+	
+	// An unplugged port is dropped, rather than reported ready for ever
+	close(textFd);
+	pollFor(ingest, 50);
+	CHECK(INGEST_Poll(ingest, 10) == 0);
+	
+	INGEST_Destroy(ingest);
+	
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
+
+static int openPty(char * slavePath, size_t length)
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	
+	grantpt(fd);
+	unlockpt(fd);
+	snprintf(slavePath, length, "%s", ptsname(fd));
+	
+	return fd;
+}
+
+static void writeCaptureFrame(int fd, uint8_t seq, uint16_t pulses)
+{
+	uint8_t frame[CAPTURE_FRAME_LENGTH] = { CAPTURE_SYNC0, CAPTURE_SYNC1, seq, (uint8_t)pulses, (uint8_t)(pulses >> 8), 0, 2, 0, 3, 0 };
+	uint8_t crc = 0;
+	
+	for (uint8_t i = CAPTURE_OFFSET_SEQ; i < CAPTURE_OFFSET_CRC; ++i)
+	{
+		crc = CAPTURE_UpdateCRC(crc, frame[i]);
+	}
+	frame[CAPTURE_OFFSET_CRC] = crc;
+	
+	CHECK(write(fd, frame, sizeof(frame)) == sizeof(frame));
+}
+
+static void pollFor(INGEST * ingest, int ms)
+{
+	for (int i = 0; i < ms / 10; ++i)
+	{
+		INGEST_Poll(ingest, 10);
+	}
+}
+
+/* Reads until the ingest side closes or stops sending, returning the lines read */
+static int readLines(INGEST * ingest, int sock)
+{
+	char buffer[4096];
+	int lines = 0;
+	int idlePolls = 0;
+	
+	while (idlePolls < 20)
+	{
+		ssize_t n = read(sock, buffer, sizeof(buffer));
+		
+		if (n == 0) { break; }
+		
+		if (n < 0)
+		{
+			idlePolls++;
+			INGEST_Poll(ingest, 10);
+			continue;
+		}
+		
+		idlePolls = 0;
+		for (ssize_t i = 0; i < n; ++i)
+		{
+			if (buffer[i] == '\n') { lines++; }
+		}
+	}
+	
+	return lines;
+}
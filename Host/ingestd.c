@@ -0,0 +1,128 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "capture.h"
+#include "series.h"
+#include "ingest.h"
+
+/*
+ * Serial ingest daemon. Reads any number of sensor ports and serves live
+ * downsampled history to viewers on a local TCP port.
+ *
+ * Usage: ingestd [-p tcp port] [-n history samples] <format>:<path> ...
+ * where format is llap (4800 baud), capture (capture mode) or text (115200
+ * baud, one value per line as printed by the Arduino sketch).
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define DEFAULT_TCP_PORT		(5331)
+#define DEFAULT_HISTORY			(1UL << 16)
+
+#define LLAP_BAUD				(4800)
+#define TEXT_BAUD				(115200)
+
+/*
+ * Private Function Prototypes
+ */
+
+static void onSignal(int sig);
+static bool addPort(INGEST * ingest, const char * arg);
+
+/* 
+ * Private Variables
+ */
+
+static volatile sig_atomic_t s_stop = 0;
+
+int main(int argc, char * argv[])
+{
+	unsigned long tcpPort = DEFAULT_TCP_PORT;
+	unsigned long history = DEFAULT_HISTORY;
+	int i = 1;
+	
+	for (; (i < argc) && (argv[i][0] == '-'); i += 2)
+	{
+		if (i + 1 >= argc) { break; }
+		if (strcmp(argv[i], "-p") == 0) { tcpPort = strtoul(argv[i + 1], NULL, 10); }
+		else if (strcmp(argv[i], "-n") == 0) { history = strtoul(argv[i + 1], NULL, 10); }
+	}
+	
+	if (i >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-p tcp port] [-n history samples] <llap|capture|text>:<path> ...\n", argv[0]);
+		return 1;
+	}
+	
+	INGEST * ingest = INGEST_Create((uint32_t)history);
+	if (!ingest) { return 1; }
+	
+	for (; i < argc; ++i)
+	{
+		if (!addPort(ingest, argv[i]))
+		{
+			fprintf(stderr, "Could not open %s\n", argv[i]);
+			return 1;
+		}
+	}
+	
+	if (INGEST_Listen(ingest, (uint16_t)tcpPort) < 0)
+	{
+		perror("listen");
+		return 1;
+	}
+	
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	
+	while (!s_stop && (INGEST_Poll(ingest, 1000) >= 0)) {}
+	
+	INGEST_Destroy(ingest);
+	return 0;
+}
+
+static void onSignal(int sig)
+{
+	(void)sig;
+	s_stop = 1;
+}
+
+static bool addPort(INGEST * ingest, const char * arg)
+{
+	const char * path = strchr(arg, ':');
+	
+	if (!path) { return false; }
+	path++;
+	
+	// Devices are named after the last path component
+	const char * name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	
+	if (strncmp(arg, "llap:", 5) == 0)
+	{
+		return INGEST_AddPort(ingest, name, path, INGEST_FORMAT_LLAP, LLAP_BAUD) == 0;
+	}
+	else if (strncmp(arg, "capture:", 8) == 0)
+	{
+		return INGEST_AddPort(ingest, name, path, INGEST_FORMAT_CAPTURE, CAPTURE_BAUD) == 0;
+	}
+	else if (strncmp(arg, "text:", 5) == 0)
+	{
+		return INGEST_AddPort(ingest, name, path, INGEST_FORMAT_TEXT, TEXT_BAUD) == 0;
+	}
+	
+	return false;
+}
@@ -0,0 +1,121 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "llap_parse.h"
+
+/*
+ * Private Function Prototypes
+ */
+
+static bool isBodyChar(uint8_t c);
+static size_t validPrefix(const uint8_t * data, size_t length);
+
+/*
+ * Public Function Defintions
+ */
+
+void LLAP_ScannerInit(LLAP_SCANNER * scanner)
+{
+	memset(scanner, 0, sizeof(*scanner));
+}
+
+/*
+ * Scans raw bytes for LLAP frames: the start character followed by eleven
+ * printable characters. Returns the number of frames passed to the handler.
+ */
+size_t LLAP_ScannerFeed(LLAP_SCANNER * scanner, const uint8_t * data, size_t length, LLAP_FRAME_HANDLER handler, void * arg)
+{
+	size_t count = 0;
+	size_t i = 0;
+	
+	// Finish off a frame that was split across the previous read
+	while ((scanner->carryLength > 0) && (i < length))
+	{
+		if (!isBodyChar(data[i]))
+		{
+			scanner->discarded += scanner->carryLength;
+			scanner->carryLength = 0;
+			break;
+		}
+		
+		scanner->carry[scanner->carryLength++] = (char)data[i++];
+		
+		if (scanner->carryLength == LLAP_FRAME_LENGTH)
+		{
+			scanner->carryLength = 0;
+			scanner->frames++;
+			count++;
+			if (handler) { handler(scanner->carry, arg); }
+		}
+	}
+	
+	while (i < length)
+	{
+		const uint8_t * start = memchr(&data[i], LLAP_START_CHAR, length - i);
+		
+		if (!start)
+		{
+			scanner->discarded += length - i;
+			break;
+		}
+		
+		scanner->discarded += (size_t)(start - &data[i]);
+		i = (size_t)(start - data);
+		
+		size_t available = length - i;
+		size_t valid = validPrefix(start, (available < LLAP_FRAME_LENGTH) ? available : LLAP_FRAME_LENGTH);
+		
+		if (valid == LLAP_FRAME_LENGTH)
+		{
+			scanner->frames++;
+			count++;
+			if (handler) { handler((const char *)start, arg); }
+			i += LLAP_FRAME_LENGTH;
+		}
+		else if (valid == available)
+		{
+			// Runs off the end of this read, keep it for next time
+			memcpy(scanner->carry, start, valid);
+			scanner->carryLength = (uint8_t)valid;
+			i = length;
+		}
+		else
+		{
+			// Not a frame, restart the search after this start character
+			scanner->discarded += valid;
+			i += valid;
+		}
+	}
+	
+	return count;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static bool isBodyChar(uint8_t c)
+{
+	return (c >= 0x20) && (c <= 0x7E) && (c != LLAP_START_CHAR);
+}
+
+static size_t validPrefix(const uint8_t * data, size_t length)
+{
+	size_t n = 1;
+	
+	while ((n < length) && isBodyChar(data[n]))
+	{
+		n++;
+	}
+	
+	return n;
+}
@@ -0,0 +1,34 @@
+#ifndef _LLAP_PARSE_H_
+#define _LLAP_PARSE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define LLAP_FRAME_LENGTH	(12)
+#define LLAP_START_CHAR		('a')
+
+/*
+ * Called for every complete frame. The frame points at LLAP_FRAME_LENGTH
+ * characters (not null terminated), normally straight into the caller's
+ * read buffer; only frames split across reads are copied.
+ */
+typedef void (*LLAP_FRAME_HANDLER)(const char * frame, void * arg);
+
+struct llap_scanner
+{
+	char carry[LLAP_FRAME_LENGTH];
+	uint8_t carryLength;
+	uint32_t frames;
+	uint32_t discarded;
+};
+typedef struct llap_scanner LLAP_SCANNER;
+
+/*
+ * Public Function Prototypes
+ */
+
+void LLAP_ScannerInit(LLAP_SCANNER * scanner);
+size_t LLAP_ScannerFeed(LLAP_SCANNER * scanner, const uint8_t * data, size_t length, LLAP_FRAME_HANDLER handler, void * arg);
+
+#endif
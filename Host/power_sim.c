@@ -0,0 +1,208 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "threshold.h"
+#include "filter.h"
+#include "flush_counter.h"
+#include "sampling.h"
+#include "host_test.h"
+
+/*
+ * Models the average supply current with the detect circuit gated. The
+ * firmware's filter, flush counter and sampling logic are run once a second
+ * over simulated days of flushes, exactly as testAndResetCount drives them,
+ * and the time the detect circuit is powered is counted. The current is then
+ *
+ *	I = I(mcu) + I(circuit) x circuit duty
+ *
+ * Currents are inputs: measure them on the board and pass them in. Gating
+ * costs flush time, since a flush is only seen at the next gated sample, so
+ * the flush count and the mean error in measured duration are also reported.
+ *
+ * Usage: power_sim [-d days] [-n flushes per day] [-m mcu mA] [-c circuit mA]
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SECONDS_PER_DAY		(86400L)
+#define DAY_START_S			(6L * 3600L)	// Flushes between 06:00 and 22:00
+#define DAY_LENGTH_S		(16L * 3600L)
+
+#define MIN_FLOW_S			(8L)
+#define MAX_FLOW_S			(40L)
+
+#define MAX_FLUSHES_PER_DAY	(2000)
+
+struct stats
+{
+	long circuitOnSecs;
+	long detected;
+	long durationErrorSecs;	// Measured minus true
+};
+typedef struct stats STATS;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void makeDay(long * starts, long * lengths, long n);
+static int compareLong(const void * a, const void * b);
+static void simulate(uint8_t gatedPeriod, long days, long perDay, STATS * stats);
+
+/*
+ * Private Variables
+ */
+
+static const uint8_t s_periods[] = { 1, 2, 4, 8 };
+
+int main(int argc, char * argv[])
+{
+	long days = 7;
+	long perDay = 30;
+	double mcuMa = 3.0;
+	double circuitMa = 1.5;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:n:m:c:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd': days = strtol(optarg, NULL, 10); break;
+		case 'n': perDay = strtol(optarg, NULL, 10); break;
+		case 'm': mcuMa = strtod(optarg, NULL); break;
+		case 'c': circuitMa = strtod(optarg, NULL); break;
+		default: break;
+		}
+	}
+
+	if ((days < 1) || (perDay < 1) || (perDay > MAX_FLUSHES_PER_DAY))
+	{
+		fprintf(stderr, "Need at least one day, and 1 to %d flushes a day\n", MAX_FLUSHES_PER_DAY);
+		return 1;
+	}
+
+	Threshold_Init();
+
+	printf("%ld days, %ld flushes a day, mcu %.2fmA, detect circuit %.2fmA\n", days, perDay, mcuMa, circuitMa);
+	printf("%-12s %10s %10s %12s %12s %12s\n", "sampling", "duty %", "detected", "duration err", "circuit mA", "total mA");
+
+	for (size_t i = 0; i < sizeof(s_periods); ++i)
+	{
+		STATS stats;
+		char name[16];
+
+		simulate(s_periods[i], days, perDay, &stats);
+
+		double duty = (double)stats.circuitOnSecs / (double)(days * SECONDS_PER_DAY);
+
+		snprintf(name, sizeof(name), (s_periods[i] == 1) ? "continuous" : "gated 1/%u", s_periods[i]);
+		printf("%-12s %10.1f %6ld/%-3ld %11.2fs %12.3f %12.3f\n", name, 100.0 * duty,
+			stats.detected, days * perDay,
+			stats.detected ? (double)stats.durationErrorSecs / stats.detected : 0.0,
+			circuitMa * duty, mcuMa + (circuitMa * duty));
+	}
+
+	return 0;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void makeDay(long * starts, long * lengths, long n)
+{
+	// Random times, then spread out so no flush starts before the last has completed
+	for (long i = 0; i < n; ++i) { starts[i] = DAY_START_S + (rand() % DAY_LENGTH_S); }
+	qsort(starts, (size_t)n, sizeof(long), compareLong);
+
+	for (long i = 0; i < n; ++i)
+	{
+		lengths[i] = MIN_FLOW_S + (rand() % (MAX_FLOW_S - MIN_FLOW_S + 1));
+
+		long earliest = (i > 0) ? (starts[i - 1] + lengths[i - 1] + 30) : 0;
+		if (starts[i] < earliest) { starts[i] = earliest; }
+	}
+}
+
+static int compareLong(const void * a, const void * b)
+{
+	long x = *(const long *)a;
+	long y = *(const long *)b;
+	return (x > y) - (x < y);
+}
+
+static void simulate(uint8_t gatedPeriod, long days, long perDay, STATS * stats)
+{
+	static long starts[MAX_FLUSHES_PER_DAY];
+	static long lengths[MAX_FLUSHES_PER_DAY];
+
+	srand(1);
+
+	Filter_Init();
+	Flush_Reset();
+	Sampling_Init(gatedPeriod);
+
+	stats->circuitOnSecs = 0;
+	stats->detected = 0;
+	stats->durationErrorSecs = 0;
+
+	long next = 0;
+	long trueLength = 0;
+
+	for (long t = 0; t < (days * SECONDS_PER_DAY); ++t)
+	{
+		long secondOfDay = t % SECONDS_PER_DAY;
+
+		if (secondOfDay == 0)
+		{
+			makeDay(starts, lengths, perDay);
+			next = 0;
+		}
+
+		bool flowing = (next < perDay) && (secondOfDay >= starts[next]) && (secondOfDay < (starts[next] + lengths[next]));
+
+		if ((next < perDay) && (secondOfDay == (starts[next] + lengths[next])))
+		{
+			trueLength = lengths[next++];
+		}
+
+		// The circuit state was set at the last tick and held for this second
+		bool circuitOn = Sampling_IsCircuitOn();
+		if (circuitOn) { stats->circuitOnSecs++; }
+
+		uint16_t pulses = 0;
+		if (circuitOn)
+		{
+			pulses = Sim_Count(flowing);
+		}
+
+		if (Sampling_Tick())
+		{
+			bool isFlushing = Filter_NewValue(pulses);
+
+			Sampling_Result(Filter_IsDeviating(), 1000);
+
+			if (Flush_UpdateCount(1000, isFlushing))
+			{
+				if (Flush_SensorHasTriggered())
+				{
+					stats->detected++;
+					stats->durationErrorSecs += (long)(Flush_GetOutflowSenseDurationMs() / 1000U) - trueLength;
+				}
+				Flush_Reset();
+			}
+		}
+	}
+}
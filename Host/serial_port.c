@@ -0,0 +1,91 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "serial_port.h"
+
+/*
+ * Private Function Prototypes
+ */
+
+static speed_t speedFromBaud(uint32_t baud);
+
+/*
+ * Public Function Defintions
+ */
+
+/*
+ * Opens a serial port (or pty) in raw 8N1 mode. Returns the file descriptor,
+ * or -1 on failure. Setting the speed is skipped for ptys, which ignore it.
+ */
+int SERIAL_Open(const char * path, uint32_t baud, bool nonBlocking)
+{
+	struct termios tio;
+	int fd = open(path, O_RDWR | O_NOCTTY | (nonBlocking ? O_NONBLOCK : 0));
+	
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+	
+	if (tcgetattr(fd, &tio) == 0)
+	{
+		speed_t speed = speedFromBaud(baud);
+		
+		cfmakeraw(&tio);
+		tio.c_cflag |= (CLOCAL | CREAD);
+		tio.c_cc[VMIN] = 1;
+		tio.c_cc[VTIME] = 0;
+		
+		if (speed != B0)
+		{
+			cfsetispeed(&tio, speed);
+			cfsetospeed(&tio, speed);
+		}
+		else
+		{
+			fprintf(stderr, "%s: unsupported baud rate %lu\n", path, (unsigned long)baud);
+		}
+		
+		(void)tcsetattr(fd, TCSANOW, &tio);
+	}
+	
+	return fd;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static speed_t speedFromBaud(uint32_t baud)
+{
+	switch (baud)
+	{
+	case 4800: return B4800;
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+#ifdef B500000
+	case 500000: return B500000;
+#endif
+#ifdef B1000000
+	case 1000000: return B1000000;
+#endif
+	default: return B0;
+	}
+}
@@ -0,0 +1,10 @@
+#ifndef _SERIAL_PORT_H_
+#define _SERIAL_PORT_H_
+
+/*
+ * Public Function Prototypes
+ */
+
+int SERIAL_Open(const char * path, uint32_t baud, bool nonBlocking);
+
+#endif
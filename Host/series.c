@@ -0,0 +1,105 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "series.h"
+
+/*
+ * Public Function Defintions
+ */
+
+bool SERIES_Init(SERIES * series, uint32_t capacity)
+{
+	uint32_t size = 1;
+	
+	while (size < capacity) { size <<= 1; }
+	
+	series->samples = calloc(size, sizeof(SERIES_SAMPLE));
+	series->mask = size - 1;
+	series->written = 0;
+	
+	return series->samples != NULL;
+}
+
+void SERIES_Free(SERIES * series)
+{
+	free(series->samples);
+	series->samples = NULL;
+}
+
+void SERIES_Push(SERIES * series, uint32_t timeMs, int32_t value)
+{
+	SERIES_SAMPLE * sample = &series->samples[series->written & series->mask];
+	sample->timeMs = timeMs;
+	sample->value = value;
+	series->written++;
+}
+
+uint32_t SERIES_Length(const SERIES * series)
+{
+	return (series->written > series->mask) ? (series->mask + 1) : series->written;
+}
+
+/*
+ * Reduces the last spanMs of history to nPoints min/mean/max buckets. Only
+ * the samples inside the span are visited, newest first.
+ */
+size_t SERIES_Downsample(const SERIES * series, uint32_t nowMs, uint32_t spanMs, SERIES_POINT * points, size_t nPoints)
+{
+	int64_t sums[nPoints];
+	uint32_t startMs = nowMs - spanMs;
+	uint32_t bucketMs = spanMs / nPoints;
+	
+	if (bucketMs == 0) { bucketMs = 1; }
+	
+	for (size_t i = 0; i < nPoints; ++i)
+	{
+		points[i].timeMs = startMs + (uint32_t)(i * bucketMs);
+		points[i].min = INT32_MAX;
+		points[i].max = INT32_MIN;
+		points[i].mean = 0;
+		points[i].count = 0;
+		sums[i] = 0;
+	}
+	
+	uint32_t length = SERIES_Length(series);
+	
+	for (uint32_t n = 1; n <= length; ++n)
+	{
+		const SERIES_SAMPLE * sample = &series->samples[(series->written - n) & series->mask];
+		uint32_t age = nowMs - sample->timeMs;
+		
+		if (age > spanMs) { break; }
+		
+		size_t bucket = (size_t)((sample->timeMs - startMs) / bucketMs);
+		if (bucket >= nPoints) { bucket = nPoints - 1; }
+		
+		SERIES_POINT * point = &points[bucket];
+		if (sample->value < point->min) { point->min = sample->value; }
+		if (sample->value > point->max) { point->max = sample->value; }
+		sums[bucket] += sample->value;
+		point->count++;
+	}
+	
+	for (size_t i = 0; i < nPoints; ++i)
+	{
+		if (points[i].count)
+		{
+			points[i].mean = (int32_t)(sums[i] / points[i].count);
+		}
+		else
+		{
+			points[i].min = points[i].max = 0;
+		}
+	}
+	
+	return nPoints;
+}
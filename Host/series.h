@@ -0,0 +1,49 @@
+#ifndef _SERIES_H_
+#define _SERIES_H_
+
+/*
+ * Defines and typedefs
+ */
+
+struct series_sample
+{
+	uint32_t timeMs;
+	int32_t value;
+};
+typedef struct series_sample SERIES_SAMPLE;
+
+struct series_point
+{
+	uint32_t timeMs; // Start of the bucket
+	int32_t min;
+	int32_t max;
+	int32_t mean;
+	uint32_t count;
+};
+typedef struct series_point SERIES_POINT;
+
+/*
+ * Fixed size history ring. The capacity is a power of two so the ring index
+ * is a mask, and pushing never allocates or moves older samples.
+ */
+struct series
+{
+	SERIES_SAMPLE * samples;
+	uint32_t mask;
+	uint32_t written;
+};
+typedef struct series SERIES;
+
+/*
+ * Public Function Prototypes
+ */
+
+bool SERIES_Init(SERIES * series, uint32_t capacity);
+void SERIES_Free(SERIES * series);
+
+void SERIES_Push(SERIES * series, uint32_t timeMs, int32_t value);
+uint32_t SERIES_Length(const SERIES * series);
+
+size_t SERIES_Downsample(const SERIES * series, uint32_t nowMs, uint32_t spanMs, SERIES_POINT * points, size_t nPoints);
+
+#endif
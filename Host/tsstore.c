@@ -0,0 +1,543 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tsstore.h"
+
+/*
+ * Append-only columnar store for flush events, one file per pit.
+ *
+ * Each file is a sequence of blocks of up to TSSTORE_BLOCK_EVENTS events.
+ * A block is a fixed header (little-endian) followed by its columns:
+ *
+ *   0-3:   magic "LSB1"
+ *   4-5:   event count
+ *   6-7:   events with a known duration
+ *   8-15:  minimum timestamp (ms since epoch)
+ *   16-23: maximum timestamp
+ *   24-27: sum of known durations (seconds)
+ *   28-29: minimum known duration
+ *   30-31: maximum known duration
+ *   32-35: payload length in bytes
+ *
+ * Columns: timestamps (first absolute, then zigzag deltas, all as LEB128
+ * varints), durations (varints), outflow temperatures (one signed byte each),
+ * ambient temperatures (one signed byte each).
+ *
+ * Queries mmap the file and walk the block headers: blocks outside the range
+ * are skipped and blocks wholly inside it are answered from the header, so
+ * only the blocks at either end of a range are decoded.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define BLOCK_MAGIC			"LSB1"
+#define HEADER_LENGTH		(36)
+#define MAX_PAYLOAD			(TSSTORE_BLOCK_EVENTS * (10 + 3 + 2))
+#define PIT_NAME_LENGTH		(16)
+#define PATH_LENGTH			(512)
+
+struct pit_writer
+{
+	char pit[PIT_NAME_LENGTH];
+	int fd;
+	TSSTORE_EVENT events[TSSTORE_BLOCK_EVENTS];
+	uint16_t nEvents;
+};
+typedef struct pit_writer PIT_WRITER;
+
+struct tsstore
+{
+	char directory[PATH_LENGTH];
+	PIT_WRITER * writers[TSSTORE_MAX_PITS];
+	uint16_t nWriters;
+};
+
+struct block_header
+{
+	uint16_t count;
+	uint16_t durationCount;
+	uint64_t minTimeMs;
+	uint64_t maxTimeMs;
+	uint32_t totalDurationSecs;
+	uint16_t minDurationSecs;
+	uint16_t maxDurationSecs;
+	uint32_t payloadLength;
+};
+typedef struct block_header BLOCK_HEADER;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void makePath(char * path, const char * directory, const char * pit);
+static PIT_WRITER * getWriter(TSSTORE * store, const char * pit);
+static bool writeBlock(PIT_WRITER * writer);
+static void decodeBlock(const BLOCK_HEADER * header, const uint8_t * payload, uint64_t fromMs, uint64_t toMs,
+	TSSTORE_SUMMARY * summary, TSSTORE_EVENT_FN eventFn, void * arg);
+static void addDuration(TSSTORE_SUMMARY * summary, uint16_t secs);
+
+static size_t putVarint(uint8_t * p, uint64_t value);
+static const uint8_t * getVarint(const uint8_t * p, uint64_t * value);
+static uint64_t zigzag(int64_t value);
+static int64_t unzigzag(uint64_t value);
+static void putLE(uint8_t * p, uint64_t value, uint8_t bytes);
+static uint64_t getLE(const uint8_t * p, uint8_t bytes);
+
+/*
+ * Public Function Defintions
+ */
+
+TSSTORE * TSSTORE_Open(const char * directory)
+{
+	TSSTORE * store = calloc(1, sizeof(TSSTORE));
+	
+	if (store)
+	{
+		(void)mkdir(directory, 0755);
+		snprintf(store->directory, sizeof(store->directory), "%s", directory);
+	}
+	
+	return store;
+}
+
+/*
+ * Buffers an event, writing the pit's block once it is full. Returns false
+ * if a block could not be written; its events stay buffered and the write
+ * is tried again by the next append or flush.
+ */
+bool TSSTORE_Append(TSSTORE * store, const char * pit, const TSSTORE_EVENT * event)
+{
+	PIT_WRITER * writer = getWriter(store, pit);
+	
+	if (!writer) { return false; }
+	
+	// A full buffer is left by a block that failed to write: it goes first
+	if ((writer->nEvents == TSSTORE_BLOCK_EVENTS) && !writeBlock(writer)) { return false; }
+	
+	writer->events[writer->nEvents++] = *event;
+	
+	return (writer->nEvents < TSSTORE_BLOCK_EVENTS) || writeBlock(writer);
+}
+
+bool TSSTORE_Flush(TSSTORE * store)
+{
+	bool ok = true;
+	
+	for (uint16_t i = 0; i < store->nWriters; ++i)
+	{
+		ok &= writeBlock(store->writers[i]);
+	}
+	
+	return ok;
+}
+
+bool TSSTORE_Close(TSSTORE * store)
+{
+	bool ok = TSSTORE_Flush(store);
+	
+	for (uint16_t i = 0; i < store->nWriters; ++i)
+	{
+		close(store->writers[i]->fd);
+		free(store->writers[i]);
+	}
+	
+	free(store);
+	return ok;
+}
+
+/*
+ * Summarises the events for one pit with fromMs <= time < toMs, optionally
+ * calling eventFn for each one (which forces every matching block to be
+ * decoded).
+ */
+bool TSSTORE_Query(const char * directory, const char * pit, uint64_t fromMs, uint64_t toMs,
+	TSSTORE_SUMMARY * summary, TSSTORE_EVENT_FN eventFn, void * arg)
+{
+	char path[PATH_LENGTH];
+	struct stat st;
+	
+	memset(summary, 0, sizeof(*summary));
+	summary->minDurationSecs = UINT16_MAX;
+	
+	makePath(path, directory, pit);
+	
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) { return false; }
+	
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return false;
+	}
+	
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return true;
+	}
+	
+	const uint8_t * map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	
+	if (map == MAP_FAILED) { return false; }
+	
+	size_t offset = 0;
+	size_t size = (size_t)st.st_size;
+	
+	while (offset + HEADER_LENGTH <= size)
+	{
+		const uint8_t * p = &map[offset];
+		BLOCK_HEADER header;
+		
+		if (memcmp(p, BLOCK_MAGIC, 4) != 0) { break; }
+		
+		header.count = (uint16_t)getLE(&p[4], 2);
+		header.durationCount = (uint16_t)getLE(&p[6], 2);
+		header.minTimeMs = getLE(&p[8], 8);
+		header.maxTimeMs = getLE(&p[16], 8);
+		header.totalDurationSecs = (uint32_t)getLE(&p[24], 4);
+		header.minDurationSecs = (uint16_t)getLE(&p[28], 2);
+		header.maxDurationSecs = (uint16_t)getLE(&p[30], 2);
+		header.payloadLength = (uint32_t)getLE(&p[32], 4);
+		
+		// A block cut short by a crash is ignored
+		if (offset + HEADER_LENGTH + header.payloadLength > size) { break; }
+		
+		if ((header.maxTimeMs < fromMs) || (header.minTimeMs >= toMs))
+		{
+			summary->blocksSkipped++;
+		}
+		else if (!eventFn && (header.minTimeMs >= fromMs) && (header.maxTimeMs < toMs))
+		{
+			summary->blocksSummed++;
+			summary->count += header.count;
+			summary->durationCount += header.durationCount;
+			summary->totalDurationSecs += header.totalDurationSecs;
+			
+			if (header.durationCount)
+			{
+				if (header.minDurationSecs < summary->minDurationSecs) { summary->minDurationSecs = header.minDurationSecs; }
+				if (header.maxDurationSecs > summary->maxDurationSecs) { summary->maxDurationSecs = header.maxDurationSecs; }
+			}
+		}
+		else
+		{
+			summary->blocksDecoded++;
+			decodeBlock(&header, &p[HEADER_LENGTH], fromMs, toMs, summary, eventFn, arg);
+		}
+		
+		offset += HEADER_LENGTH + header.payloadLength;
+	}
+	
+	munmap((void *)map, size);
+	
+	if (summary->durationCount == 0) { summary->minDurationSecs = 0; }
+	
+	return true;
+}
+
+/*
+ * Parses a flush report body as sent by the sensor: "FEOOAADDD", with
+ * outflow and ambient temperatures in whole degrees ("<0" below zero, "??"
+ * out of range) and the duration in seconds ("???" out of range). A batched
+ * report, "FBOOaaDDD", has no ambient temperature but the flush's age at
+ * reportMs in minutes (hex), and is timestamped when the flush ended.
+ */
+bool TSSTORE_ParseLLAPBody(const char * body, uint64_t reportMs, TSSTORE_EVENT * event)
+{
+	if ((strlen(body) < 9) || (body[0] != 'F') || ((body[1] != 'E') && (body[1] != 'B'))) { return false; }
+	
+	bool batched = (body[1] == 'B');
+	event->timeMs = reportMs;
+	
+	if (batched)
+	{
+		char age[3] = { body[4], body[5], '\0' };
+		char * end;
+		unsigned long minutes = strtoul(age, &end, 16);
+		
+		if (*end != '\0') { return false; }
+		
+		event->timeMs -= (uint64_t)minutes * 60000U;
+		event->ambientDegC = TSSTORE_UNKNOWN_TEMP;
+	}
+	
+	for (uint8_t i = 0; i < (batched ? 1 : 2); ++i)
+	{
+		const char * t = &body[2 + (2 * i)];
+		int8_t degC = TSSTORE_UNKNOWN_TEMP;
+		
+		if ((t[0] >= '0') && (t[0] <= '9') && (t[1] >= '0') && (t[1] <= '9'))
+		{
+			degC = (int8_t)(((t[0] - '0') * 10) + (t[1] - '0'));
+		}
+		else if (t[0] == '<')
+		{
+			degC = -1;
+		}
+		
+		if (i == 0) { event->outflowDegC = degC; } else { event->ambientDegC = degC; }
+	}
+	
+	const char * d = &body[6];
+	
+	if ((d[0] >= '0') && (d[0] <= '9'))
+	{
+		event->durationSecs = (uint16_t)(((d[0] - '0') * 100) + ((d[1] - '0') * 10) + (d[2] - '0'));
+	}
+	else
+	{
+		event->durationSecs = TSSTORE_UNKNOWN_SECS;
+	}
+	
+	return true;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void makePath(char * path, const char * directory, const char * pit)
+{
+	char hex[(2 * PIT_NAME_LENGTH) + 1];
+	size_t i;
+	
+	// Pit IDs can be any printable characters, so the file name is hex
+	for (i = 0; (i < PIT_NAME_LENGTH) && pit[i]; ++i)
+	{
+		sprintf(&hex[2 * i], "%02X", (uint8_t)pit[i]);
+	}
+	hex[2 * i] = '\0';
+	
+	snprintf(path, PATH_LENGTH, "%s/pit_%s.lsc", directory, hex);
+}
+
+static PIT_WRITER * getWriter(TSSTORE * store, const char * pit)
+{
+	char path[PATH_LENGTH];
+	
+	for (uint16_t i = 0; i < store->nWriters; ++i)
+	{
+		if (strncmp(store->writers[i]->pit, pit, PIT_NAME_LENGTH) == 0) { return store->writers[i]; }
+	}
+	
+	if (store->nWriters == TSSTORE_MAX_PITS) { return NULL; }
+	
+	PIT_WRITER * writer = calloc(1, sizeof(PIT_WRITER));
+	if (!writer) { return NULL; }
+	
+	strncpy(writer->pit, pit, PIT_NAME_LENGTH - 1);
+	makePath(path, store->directory, pit);
+	writer->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	
+	if (writer->fd < 0)
+	{
+		perror(path);
+		free(writer);
+		return NULL;
+	}
+	
+	store->writers[store->nWriters++] = writer;
+	return writer;
+}
+
+static bool writeBlock(PIT_WRITER * writer)
+{
+	static uint8_t block[HEADER_LENGTH + MAX_PAYLOAD];
+	uint8_t * p = &block[HEADER_LENGTH];
+	BLOCK_HEADER header;
+	
+	if (writer->nEvents == 0) { return true; }
+	
+	memset(&header, 0, sizeof(header));
+	header.count = writer->nEvents;
+	header.minTimeMs = UINT64_MAX;
+	header.minDurationSecs = UINT16_MAX;
+	
+	uint64_t lastTimeMs = 0;
+	
+	for (uint16_t i = 0; i < writer->nEvents; ++i)
+	{
+		const TSSTORE_EVENT * e = &writer->events[i];
+		
+		p += putVarint(p, (i == 0) ? e->timeMs : zigzag((int64_t)(e->timeMs - lastTimeMs)));
+		lastTimeMs = e->timeMs;
+		
+		if (e->timeMs < header.minTimeMs) { header.minTimeMs = e->timeMs; }
+		if (e->timeMs > header.maxTimeMs) { header.maxTimeMs = e->timeMs; }
+	}
+	
+	for (uint16_t i = 0; i < writer->nEvents; ++i)
+	{
+		uint16_t secs = writer->events[i].durationSecs;
+		
+		p += putVarint(p, secs);
+		
+		if (secs != TSSTORE_UNKNOWN_SECS)
+		{
+			header.durationCount++;
+			header.totalDurationSecs += secs;
+			if (secs < header.minDurationSecs) { header.minDurationSecs = secs; }
+			if (secs > header.maxDurationSecs) { header.maxDurationSecs = secs; }
+		}
+	}
+	
+	for (uint16_t i = 0; i < writer->nEvents; ++i) { *p++ = (uint8_t)writer->events[i].outflowDegC; }
+	for (uint16_t i = 0; i < writer->nEvents; ++i) { *p++ = (uint8_t)writer->events[i].ambientDegC; }
+	
+	header.payloadLength = (uint32_t)(p - &block[HEADER_LENGTH]);
+	
+	memcpy(block, BLOCK_MAGIC, 4);
+	putLE(&block[4], header.count, 2);
+	putLE(&block[6], header.durationCount, 2);
+	putLE(&block[8], header.minTimeMs, 8);
+	putLE(&block[16], header.maxTimeMs, 8);
+	putLE(&block[24], header.totalDurationSecs, 4);
+	putLE(&block[28], header.minDurationSecs, 2);
+	putLE(&block[30], header.maxDurationSecs, 2);
+	putLE(&block[32], header.payloadLength, 4);
+	
+	size_t length = HEADER_LENGTH + header.payloadLength;
+	size_t written = 0;
+	off_t start = lseek(writer->fd, 0, SEEK_END);
+	
+	while (written < length)
+	{
+		ssize_t n = write(writer->fd, &block[written], length - written);
+		
+		if (n < 0)
+		{
+			if (errno == EINTR) { continue; }
+			
+			// Cut off the torn block, which would hide every block after it,
+			// and keep the events to try again
+			perror(writer->pit);
+			if (start >= 0) { (void)ftruncate(writer->fd, start); }
+			return false;
+		}
+		
+		written += (size_t)n;
+	}
+	
+	writer->nEvents = 0;
+	return true;
+}
+
+static void decodeBlock(const BLOCK_HEADER * header, const uint8_t * payload, uint64_t fromMs, uint64_t toMs,
+	TSSTORE_SUMMARY * summary, TSSTORE_EVENT_FN eventFn, void * arg)
+{
+	static uint64_t times[TSSTORE_BLOCK_EVENTS];
+	const uint8_t * p = payload;
+	uint64_t value;
+	
+	for (uint16_t i = 0; i < header->count; ++i)
+	{
+		p = getVarint(p, &value);
+		times[i] = (i == 0) ? value : (uint64_t)((int64_t)times[i - 1] + unzigzag(value));
+	}
+	
+	const uint8_t * durations = p;
+	
+	// Temperature columns follow the variable length duration column
+	for (uint16_t i = 0; i < header->count; ++i) { p = getVarint(p, &value); }
+	
+	const int8_t * outflow = (const int8_t *)p;
+	const int8_t * ambient = (const int8_t *)(p + header->count);
+	
+	p = durations;
+	
+	for (uint16_t i = 0; i < header->count; ++i)
+	{
+		p = getVarint(p, &value);
+		
+		if ((times[i] < fromMs) || (times[i] >= toMs)) { continue; }
+		
+		summary->count++;
+		addDuration(summary, (uint16_t)value);
+		
+		if (eventFn)
+		{
+			TSSTORE_EVENT event = { times[i], (uint16_t)value, outflow[i], ambient[i] };
+			eventFn(&event, arg);
+		}
+	}
+}
+
+static void addDuration(TSSTORE_SUMMARY * summary, uint16_t secs)
+{
+	if (secs == TSSTORE_UNKNOWN_SECS) { return; }
+	
+	summary->durationCount++;
+	summary->totalDurationSecs += secs;
+	if (secs < summary->minDurationSecs) { summary->minDurationSecs = secs; }
+	if (secs > summary->maxDurationSecs) { summary->maxDurationSecs = secs; }
+}
+
+static size_t putVarint(uint8_t * p, uint64_t value)
+{
+	size_t n = 0;
+	
+	while (value >= 0x80)
+	{
+		p[n++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	p[n++] = (uint8_t)value;
+	
+	return n;
+}
+
+static const uint8_t * getVarint(const uint8_t * p, uint64_t * value)
+{
+	uint64_t result = 0;
+	uint8_t shift = 0;
+	
+	while (*p & 0x80)
+	{
+		result |= (uint64_t)(*p++ & 0x7F) << shift;
+		shift += 7;
+	}
+	result |= (uint64_t)(*p++) << shift;
+	
+	*value = result;
+	return p;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void putLE(uint8_t * p, uint64_t value, uint8_t bytes)
+{
+	for (uint8_t i = 0; i < bytes; ++i) { p[i] = (uint8_t)(value >> (8 * i)); }
+}
+
+static uint64_t getLE(const uint8_t * p, uint8_t bytes)
+{
+	uint64_t value = 0;
+	for (uint8_t i = 0; i < bytes; ++i) { value |= (uint64_t)p[i] << (8 * i); }
+	return value;
+}
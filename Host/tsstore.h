@@ -0,0 +1,54 @@
+#ifndef _TSSTORE_H_
+#define _TSSTORE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define TSSTORE_BLOCK_EVENTS	(4096)
+#define TSSTORE_MAX_PITS		(256)
+#define TSSTORE_UNKNOWN_TEMP	(INT8_MIN)
+#define TSSTORE_UNKNOWN_SECS	(UINT16_MAX)
+
+struct tsstore_event
+{
+	uint64_t timeMs;
+	uint16_t durationSecs;
+	int8_t outflowDegC;
+	int8_t ambientDegC;
+};
+typedef struct tsstore_event TSSTORE_EVENT;
+
+struct tsstore_summary
+{
+	uint64_t count;
+	uint64_t durationCount;	// Events with a known duration
+	uint64_t totalDurationSecs;
+	uint16_t minDurationSecs;
+	uint16_t maxDurationSecs;
+	
+	uint32_t blocksSkipped;	// Outside the range, only the header was read
+	uint32_t blocksSummed;	// Wholly inside the range, answered from the header
+	uint32_t blocksDecoded;	// Partly inside the range, columns decoded
+};
+typedef struct tsstore_summary TSSTORE_SUMMARY;
+
+typedef void (*TSSTORE_EVENT_FN)(const TSSTORE_EVENT * event, void * arg);
+
+typedef struct tsstore TSSTORE;
+
+/*
+ * Public Function Prototypes
+ */
+
+TSSTORE * TSSTORE_Open(const char * directory);
+bool TSSTORE_Append(TSSTORE * store, const char * pit, const TSSTORE_EVENT * event);
+bool TSSTORE_Flush(TSSTORE * store);
+bool TSSTORE_Close(TSSTORE * store);
+
+bool TSSTORE_Query(const char * directory, const char * pit, uint64_t fromMs, uint64_t toMs,
+	TSSTORE_SUMMARY * summary, TSSTORE_EVENT_FN eventFn, void * arg);
+
+bool TSSTORE_ParseLLAPBody(const char * body, uint64_t reportMs, TSSTORE_EVENT * event);
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tsstore.h"
+#include "host_test.h"
+
+/*
+ * Writes ten years of simulated flushes for a few pits, then checks range
+ * queries against a brute force count and reports query times.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define N_PITS			(3)
+#define YEARS			(10)
+#define DAY_MS			(86400000ULL)
+#define START_MS		(1388534400000ULL) // 2014-01-01
+#define N_QUERIES		(200)
+
+/*
+ * Private Function Prototypes
+ */
+
+static double elapsedMs(const struct timespec * start);
+static void countEvent(const TSSTORE_EVENT * event, void * arg);
+static void testFailedWrite(void);
+
+/* 
+ * Private Variables
+ */
+
+static int failures = 0;
+
+static TSSTORE_EVENT * s_events[N_PITS];
+static size_t s_nEvents[N_PITS];
+
+int main(int argc, char * argv[])
+{
+	(void)argc; (void)argv;
+	
+	char directory[] = "/tmp/tsstore_testXXXXXX";
+	const char * pits[N_PITS] = { "AA", "B-", "z$" };
+	struct timespec start;
+	
+	CHECK(mkdtemp(directory) != NULL);
+	srand(1);
+	
+	TSSTORE * store = TSSTORE_Open(directory);
+	
+	for (uint8_t pit = 0; pit < N_PITS; ++pit)
+	{
+		s_events[pit] = malloc(YEARS * 366 * 200 * sizeof(TSSTORE_EVENT));
+	}
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	// Events arrive interleaved across pits, roughly 40 to 160 flushes a day each
+	for (uint64_t day = 0; day < (YEARS * 365); ++day)
+	{
+		for (uint8_t pit = 0; pit < N_PITS; ++pit)
+		{
+			uint32_t flushes = 40 + (uint32_t)(rand() % 120);
+			uint64_t t = START_MS + (day * DAY_MS);
+			
+			for (uint32_t f = 0; f < flushes; ++f)
+			{
+				TSSTORE_EVENT event;
+				
+				t += (uint64_t)(rand() % (int)(DAY_MS / 200));
+				event.timeMs = t;
+				event.durationSecs = (rand() % 50) ? (uint16_t)(2 + (rand() % 90)) : TSSTORE_UNKNOWN_SECS;
+				event.outflowDegC = (int8_t)(15 + (rand() % 15));
+				event.ambientDegC = (int8_t)(10 + (rand() % 25));
+				
+				s_events[pit][s_nEvents[pit]++] = event;
+				CHECK(TSSTORE_Append(store, pits[pit], &event));
+			}
+		}
+	}
+	
+	CHECK(TSSTORE_Close(store));
+	
+	size_t total = s_nEvents[0] + s_nEvents[1] + s_nEvents[2];
+	printf("Wrote %zu events in %.0f ms\n", total, elapsedMs(&start));
+	
+	struct stat st;
+	char path[256];
+	snprintf(path, sizeof(path), "%s/pit_4141.lsc", directory);
+	CHECK(stat(path, &st) == 0);
+	printf("Pit AA: %zu events, %.2f bytes per event\n", s_nEvents[0], (double)st.st_size / (double)s_nEvents[0]);
+	
+	double worstMs = 0;
+	double totalMs = 0;
+	
+	for (int q = 0; q < N_QUERIES; ++q)
+	{
+		uint8_t pit = (uint8_t)(q % N_PITS);
+		uint64_t a = START_MS + ((uint64_t)rand() * 1000ULL) % (YEARS * 365 * DAY_MS);
+		uint64_t b = START_MS + ((uint64_t)rand() * 1000ULL) % (YEARS * 365 * DAY_MS);
+		uint64_t from = (a < b) ? a : b;
+		uint64_t to = (a < b) ? b : a;
+		
+		if (q == 0) { from = 0; to = UINT64_MAX; }
+		
+		uint64_t expectedCount = 0;
+		uint64_t expectedSecs = 0;
+		
+		for (size_t i = 0; i < s_nEvents[pit]; ++i)
+		{
+			const TSSTORE_EVENT * e = &s_events[pit][i];
+			if ((e->timeMs >= from) && (e->timeMs < to))
+			{
+				expectedCount++;
+				expectedSecs += (e->durationSecs != TSSTORE_UNKNOWN_SECS) ? e->durationSecs : 0;
+			}
+		}
+		
+		TSSTORE_SUMMARY summary;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		CHECK(TSSTORE_Query(directory, pits[pit], from, to, &summary, NULL, NULL));
+		double ms = elapsedMs(&start);
+		
+		totalMs += ms;
+		if (ms > worstMs) { worstMs = ms; }
+		
+		CHECK(summary.count == expectedCount);
+		CHECK(summary.totalDurationSecs == expectedSecs);
+	}
+	
+	printf("%d range queries over %d years: mean %.3f ms, worst %.3f ms\n", N_QUERIES, YEARS, totalMs / N_QUERIES, worstMs);
+	
+	// Visiting every event must decode the same number of events
+	uint64_t visited = 0;
+	TSSTORE_SUMMARY summary;
+	CHECK(TSSTORE_Query(directory, "B-", 0, UINT64_MAX, &summary, countEvent, &visited));
+	CHECK(visited == s_nEvents[1]);
+	
+	for (uint8_t pit = 0; pit < N_PITS; ++pit)
+	{
+		snprintf(path, sizeof(path), "%s/pit_%02X%02X.lsc", directory, (uint8_t)pits[pit][0], (uint8_t)pits[pit][1]);
+		unlink(path);
+		free(s_events[pit]);
+	}
+	rmdir(directory);
+	
+	// Single reports are stamped when received, batched ones when the flush ended
+	TSSTORE_EVENT event;
+	CHECK(TSSTORE_ParseLLAPBody("FE2015012", 600000, &event));
+	CHECK((event.timeMs == 600000) && (event.outflowDegC == 20) && (event.ambientDegC == 15) && (event.durationSecs == 12));
+	CHECK(TSSTORE_ParseLLAPBody("FB200A034", 1200000, &event));
+	CHECK((event.timeMs == 600000) && (event.outflowDegC == 20) && (event.ambientDegC == TSSTORE_UNKNOWN_TEMP) && (event.durationSecs == 34));
+	CHECK(!TSSTORE_ParseLLAPBody("FB20xx034", 1200000, &event));
+	
+	testFailedWrite();
+	
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
+
+static double elapsedMs(const struct timespec * start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((double)(now.tv_sec - start->tv_sec) * 1e3) + ((double)(now.tv_nsec - start->tv_nsec) / 1e6);
+}
+
+static void countEvent(const TSSTORE_EVENT * event, void * arg)
+{
+	(void)event;
+	(*(uint64_t *)arg)++;
+}
+
+/*
+ * A block write cut short (here by a file size limit) must leave no torn
+ * block behind, and keep its events for the next flush.
+ */
+static void testFailedWrite(void)
+{
+	char directory[] = "/tmp/tsstore_testXXXXXX";
+	char path[128];
+	struct rlimit limit;
+	struct rlimit small = { 100, RLIM_INFINITY };
+	struct stat st;
+	TSSTORE_SUMMARY summary;
+	
+	CHECK(mkdtemp(directory) != NULL);
+	snprintf(path, sizeof(path), "%s/pit_4141.lsc", directory);
+	
+	TSSTORE * store = TSSTORE_Open(directory);
+	
+	for (uint16_t i = 0; i < 20; ++i)
+	{
+		TSSTORE_EVENT event = { START_MS + (i * 60000ULL), 30, 20, 15 };
+		CHECK(TSSTORE_Append(store, "AA", &event));
+	}
+	
+	// Beyond the limit write() stops short, then fails with EFBIG
+	signal(SIGXFSZ, SIG_IGN);
+	getrlimit(RLIMIT_FSIZE, &limit);
+	small.rlim_max = limit.rlim_max;
+	setrlimit(RLIMIT_FSIZE, &small);
+	
+	CHECK(!TSSTORE_Flush(store));
+	CHECK((stat(path, &st) == 0) && (st.st_size == 0));
+	
+	setrlimit(RLIMIT_FSIZE, &limit);
+	
+	CHECK(TSSTORE_Close(store));
+	CHECK(TSSTORE_Query(directory, "AA", 0, UINT64_MAX, &summary, NULL, NULL));
+	CHECK((summary.count == 20) && (summary.totalDurationSecs == 600));
+	
+	unlink(path);
+	rmdir(directory);
+}
@@ -0,0 +1,178 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tsstore.h"
+
+/*
+ * Flush event store tool.
+ *
+ * tsstore import <store directory> < event log
+ *     Appends events from a gateway event log ("<ms>,<id>,<body>" lines).
+ *     Batched reports are dated from the sensor's own clock when the batch
+ *     starts with its time ("E" and eight hex digits of seconds).
+ * tsstore query <store directory> <pit id> <from> <to>
+ *     Summarises one pit's events between two dates (YYYY-MM-DD, UTC) or
+ *     millisecond timestamps.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define STAMP_WINDOW_MS		(10000ULL)	// A batch is sent within seconds of its time stamp
+
+struct stamp
+{
+	uint64_t logMs;
+	uint64_t sensorMs;
+};
+typedef struct stamp STAMP;
+
+/*
+ * Private Function Prototypes
+ */
+
+static int import(const char * directory);
+static int query(const char * directory, const char * pit, const char * from, const char * to);
+static uint64_t parseTime(const char * s);
+static STAMP * getStamp(const char * pit);
+
+/*
+ * Private Variables
+ */
+
+// Two character LLAP IDs index straight into the table
+static STAMP s_stamps[128 * 128];
+
+int main(int argc, char * argv[])
+{
+	if ((argc == 3) && (strcmp(argv[1], "import") == 0))
+	{
+		return import(argv[2]);
+	}
+	else if ((argc == 6) && (strcmp(argv[1], "query") == 0))
+	{
+		return query(argv[2], argv[3], argv[4], argv[5]);
+	}
+	
+	fprintf(stderr, "Usage: %s import <store> < events.log\n       %s query <store> <pit> <from> <to>\n", argv[0], argv[0]);
+	return 1;
+}
+
+static int import(const char * directory)
+{
+	TSSTORE * store = TSSTORE_Open(directory);
+	char line[128];
+	unsigned long imported = 0;
+	unsigned long skipped = 0;
+	
+	if (!store) { return 1; }
+	
+	while (fgets(line, sizeof(line), stdin))
+	{
+		unsigned long long ms;
+		char pit[3];
+		char body[16];
+		TSSTORE_EVENT event;
+		
+		if (sscanf(line, "%llu,%2[^,],%15s", &ms, pit, body) != 3)
+		{
+			skipped++;
+			continue;
+		}
+		
+		STAMP * stamp = getStamp(pit);
+		unsigned int sensorSecs;
+		char end;
+		
+		if (stamp && (sscanf(body, "E%8X%c", &sensorSecs, &end) == 1))
+		{
+			stamp->logMs = ms;
+			stamp->sensorMs = (uint64_t)sensorSecs * 1000U;
+			continue;
+		}
+		
+		uint64_t reportMs = ms;
+		
+		if (stamp && stamp->logMs && (body[1] == 'B') && ((ms - stamp->logMs) <= STAMP_WINDOW_MS))
+		{
+			reportMs = stamp->sensorMs + (ms - stamp->logMs);
+		}
+		
+		if (TSSTORE_ParseLLAPBody(body, reportMs, &event))
+		{
+			imported += TSSTORE_Append(store, pit, &event) ? 1 : 0;
+		}
+		else
+		{
+			skipped++;
+		}
+	}
+	
+	bool ok = TSSTORE_Close(store);
+	fprintf(stderr, "%lu events imported, %lu lines skipped\n", imported, skipped);
+	
+	return ok ? 0 : 1;
+}
+
+static int query(const char * directory, const char * pit, const char * from, const char * to)
+{
+	TSSTORE_SUMMARY summary;
+	struct timespec start, end;
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	bool ok = TSSTORE_Query(directory, pit, parseTime(from), parseTime(to), &summary, NULL, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	if (!ok)
+	{
+		fprintf(stderr, "No data for pit %s\n", pit);
+		return 1;
+	}
+	
+	printf("flushes          %llu\n", (unsigned long long)summary.count);
+	printf("total duration   %llu s\n", (unsigned long long)summary.totalDurationSecs);
+	printf("mean duration    %.1f s\n", summary.durationCount ? (double)summary.totalDurationSecs / (double)summary.durationCount : 0.0);
+	printf("min/max duration %u/%u s\n", summary.minDurationSecs, summary.maxDurationSecs);
+	printf("blocks           %u skipped, %u from index, %u decoded\n", summary.blocksSkipped, summary.blocksSummed, summary.blocksDecoded);
+	printf("query time       %.3f ms\n", ((double)(end.tv_sec - start.tv_sec) * 1e3) + ((double)(end.tv_nsec - start.tv_nsec) / 1e6));
+	
+	return 0;
+}
+
+static uint64_t parseTime(const char * s)
+{
+	struct tm tm;
+	
+	memset(&tm, 0, sizeof(tm));
+	
+	if (sscanf(s, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) == 3)
+	{
+		tm.tm_year -= 1900;
+		tm.tm_mon -= 1;
+		return (uint64_t)timegm(&tm) * 1000U;
+	}
+	
+	return strtoull(s, NULL, 10);
+}
+
+static STAMP * getStamp(const char * pit)
+{
+	uint8_t a = (uint8_t)pit[0];
+	uint8_t b = (uint8_t)pit[1];
+	
+	if ((a > 0x7F) || (b > 0x7F)) { return NULL; }
+	
+	return &s_stamps[(a << 7) | b];
+}
@@ -0,0 +1,357 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tempsense.h"
+#include "txsched.h"
+
+/*
+ * Compares flush report scheduling over simulated usage traces:
+ *
+ * immediate: every flush wakes the master on its own (the original
+ *            behaviour, and the scheduler with a budget of 0).
+ * fixed:     the first flush opens a batch that is sent after the whole
+ *            latency budget, or when the batch is full.
+ * adaptive:  the firmware scheduler in txsched.c, run second by second.
+ *
+ * Flushes arrive as a Poisson process whose hourly rate follows a site
+ * profile, with a morning queue at each site. A flush is complete
+ * FLUSH_STOPPED_S after its outflow ends, and outflow that starts again
+ * before then extends the same flush, as in latrinesensor.c. A trace file of
+ * "<start seconds> <flow seconds>" lines can be replayed instead.
+ *
+ * Delay is from a flush completing to its report being sent. Radio time
+ * counts WAKE, the master's reply and one COMMS_TICK_MS per record sent.
+ *
+ * Usage: txsched_sim [-d days] [-b budget seconds] [-t trace file]
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SECONDS_PER_HOUR	(3600U)
+#define SECONDS_PER_DAY		(86400U)
+
+#define FLUSH_STOPPED_S		(10U)	// Detect_core DETECT_STOPPED_DELAY_MS
+#define MIN_FLOW_S			(4U)
+#define MAX_FLOW_S			(20U)
+
+#define COMMS_TICK_MS		(120.0)
+#define MASTER_REPLY_MS		(30.0)
+#define LLAP_BAUD			(4800.0)
+#define FRAME_MS			((12.0 * 10.0 * 1000.0) / LLAP_BAUD) // 12 characters, 8N1
+
+#define MAX_FLUSHES			(1000000U)
+
+enum policy
+{
+	POLICY_IMMEDIATE,
+	POLICY_FIXED,
+	POLICY_ADAPTIVE,
+	MAX_POLICIES
+};
+typedef enum policy POLICY;
+
+struct site
+{
+	const char * name;
+	uint16_t perDay;
+	uint8_t hourWeights[24];
+};
+typedef struct site SITE;
+
+struct flush
+{
+	uint32_t completedSecs;
+	uint16_t durationSecs;
+};
+typedef struct flush FLUSH;
+
+struct stats
+{
+	uint32_t transmissions;
+	uint32_t frames;
+	uint32_t reports;
+	uint32_t peakHourTransmissions;
+	double totalDelay;
+	uint32_t worstDelay;
+	double radioMs;
+};
+typedef struct stats STATS;
+
+/*
+ * Private Function Prototypes
+ */
+
+static double uniform(double a, double b);
+static uint32_t generateTrace(const SITE * site, uint32_t days, FLUSH * flushes);
+static uint32_t readTrace(const char * path, FLUSH * flushes, uint32_t * pDays);
+static uint32_t addFlush(FLUSH * flushes, uint32_t n, uint32_t start, uint32_t flow);
+static void simulate(POLICY policy, const FLUSH * flushes, uint32_t n, uint32_t days, uint16_t budget, STATS * stats);
+static void transmit(STATS * stats, uint32_t records, uint32_t * hourCount);
+static void report(const char * site, POLICY policy, const STATS * stats, uint32_t days);
+
+/*
+ * Private Variables
+ */
+
+static const char * s_policyNames[MAX_POLICIES] = { "immediate", "fixed", "adaptive" };
+
+static const SITE s_sites[] = {
+	// Early morning and evening peaks at home
+	{ "household", 30, {0,0,0,0,0,1, 6,8,4,2,1,1, 2,1,1,1,2,3, 5,6,4,3,1,0} },
+	// Before school, breaks and lunch, nothing at night
+	{ "school", 300, {0,0,0,0,0,0, 0,4,6,2,8,2, 10,6,2,6,2,0, 0,0,0,0,0,0} },
+	// Market queue before opening, steady through the day
+	{ "public", 600, {0,0,0,0,1,4, 10,10,6,5,5,5, 6,5,5,5,5,5, 4,2,1,0,0,0} },
+};
+
+static FLUSH s_flushes[MAX_FLUSHES];
+
+int main(int argc, char * argv[])
+{
+	uint32_t days = 28;
+	uint16_t budget = TXSCHED_DEFAULT_BUDGET_S;
+	const char * tracePath = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:b:t:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd': days = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'b': budget = (uint16_t)strtoul(optarg, NULL, 10); break;
+		case 't': tracePath = optarg; break;
+		default: break;
+		}
+	}
+
+	if ((days == 0) || (days > 365))
+	{
+		fprintf(stderr, "Days must be 1 to 365\n");
+		return 1;
+	}
+
+	srand(1);
+
+	printf("budget %us\n", budget);
+	printf("%-10s %-10s %10s %10s %10s %10s %10s %10s\n",
+		"site", "policy", "flushes/d", "tx/d", "peak tx/h", "mean dly s", "max dly s", "radio s/d");
+
+	size_t nSites = tracePath ? 1 : sizeof(s_sites) / sizeof(s_sites[0]);
+
+	for (size_t i = 0; i < nSites; ++i)
+	{
+		uint32_t n;
+		const char * name;
+
+		if (tracePath)
+		{
+			n = readTrace(tracePath, s_flushes, &days);
+			name = "trace";
+		}
+		else
+		{
+			n = generateTrace(&s_sites[i], days, s_flushes);
+			name = s_sites[i].name;
+		}
+
+		for (uint8_t p = 0; p < MAX_POLICIES; ++p)
+		{
+			STATS stats;
+			simulate((POLICY)p, s_flushes, n, days, budget, &stats);
+			report(name, (POLICY)p, &stats, days);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static double uniform(double a, double b)
+{
+	return a + ((b - a) * ((double)rand() / (double)RAND_MAX));
+}
+
+static uint32_t generateTrace(const SITE * site, uint32_t days, FLUSH * flushes)
+{
+	uint32_t totalWeight = 0;
+	for (uint8_t h = 0; h < 24; ++h) { totalWeight += site->hourWeights[h]; }
+
+	uint32_t n = 0;
+
+	for (uint32_t t = 0; t < (days * SECONDS_PER_DAY); ++t)
+	{
+		uint8_t hour = (t % SECONDS_PER_DAY) / SECONDS_PER_HOUR;
+		double perSecond = ((double)site->perDay * site->hourWeights[hour]) / ((double)totalWeight * SECONDS_PER_HOUR);
+
+		if (uniform(0.0, 1.0) < perSecond)
+		{
+			n = addFlush(flushes, n, t, (uint32_t)uniform(MIN_FLOW_S, MAX_FLOW_S + 1));
+		}
+	}
+
+	return n;
+}
+
+static uint32_t readTrace(const char * path, FLUSH * flushes, uint32_t * pDays)
+{
+	FILE * f = fopen(path, "r");
+	if (!f)
+	{
+		perror(path);
+		exit(1);
+	}
+
+	uint32_t n = 0;
+	unsigned long start, flow;
+	unsigned long last = 0;
+
+	while ((n < MAX_FLUSHES) && (fscanf(f, "%lu %lu", &start, &flow) == 2))
+	{
+		n = addFlush(flushes, n, (uint32_t)start, (uint32_t)flow);
+		last = start;
+	}
+
+	fclose(f);
+
+	*pDays = (uint32_t)(last / SECONDS_PER_DAY) + 1;
+	return n;
+}
+
+static uint32_t addFlush(FLUSH * flushes, uint32_t n, uint32_t start, uint32_t flow)
+{
+	uint32_t completed = start + flow + FLUSH_STOPPED_S;
+
+	// Outflow starting again before the last flush completed extends it
+	if ((n > 0) && (start < flushes[n - 1].completedSecs))
+	{
+		FLUSH * pLast = &flushes[n - 1];
+		if (completed > pLast->completedSecs)
+		{
+			pLast->durationSecs += (uint16_t)(completed - pLast->completedSecs);
+			pLast->completedSecs = completed;
+		}
+		return n;
+	}
+
+	if (n < MAX_FLUSHES)
+	{
+		flushes[n].completedSecs = completed;
+		flushes[n].durationSecs = (uint16_t)flow;
+		n++;
+	}
+
+	return n;
+}
+
+static void simulate(POLICY policy, const FLUSH * flushes, uint32_t n, uint32_t days, uint16_t budget, STATS * stats)
+{
+	static uint32_t hourCount[365 * 24];
+
+	memset(stats, 0, sizeof(*stats));
+	memset(hourCount, 0, sizeof(hourCount));
+
+	TxSched_Init();
+	TxSched_SetBudget((policy == POLICY_IMMEDIATE) ? 0 : budget);
+
+	// The fixed policy is modelled here, with the scheduler's queue limit
+	uint32_t fixedAges[TXSCHED_MAX_RECORDS];
+	uint32_t fixedCount = 0;
+	uint32_t fixedStart = 0;
+
+	uint32_t next = 0;
+	uint32_t end = (days * SECONDS_PER_DAY) + budget + SECONDS_PER_HOUR;
+
+	for (uint32_t t = 0; t < end; ++t)
+	{
+		while ((next < n) && (flushes[next].completedSecs == t))
+		{
+			if (policy == POLICY_FIXED)
+			{
+				if (fixedCount == 0) { fixedStart = t; }
+				fixedAges[fixedCount++] = t;
+			}
+			else
+			{
+				TxSched_AddFlush(flushes[next].durationSecs, 200);
+			}
+			next++;
+		}
+
+		uint32_t records = 0;
+
+		if (policy == POLICY_FIXED)
+		{
+			if ((fixedCount == TXSCHED_MAX_RECORDS) || ((fixedCount > 0) && ((t - fixedStart) >= budget)))
+			{
+				for (uint32_t i = 0; i < fixedCount; ++i)
+				{
+					uint32_t delay = t - fixedAges[i];
+					stats->totalDelay += delay;
+					if (delay > stats->worstDelay) { stats->worstDelay = delay; }
+				}
+				records = fixedCount;
+				fixedCount = 0;
+			}
+		}
+		else if (TxSched_IsDue())
+		{
+			TXSCHED_RECORD record;
+			uint16_t age;
+
+			while (TxSched_TakeRecord(&record, &age))
+			{
+				stats->totalDelay += age;
+				if (age > stats->worstDelay) { stats->worstDelay = age; }
+				records++;
+			}
+		}
+
+		if (records)
+		{
+			transmit(stats, records, &hourCount[(t / SECONDS_PER_HOUR) % (365 * 24)]);
+		}
+
+		TxSched_Tick(1000);
+	}
+
+	for (uint32_t h = 0; h < (365 * 24); ++h)
+	{
+		if (hourCount[h] > stats->peakHourTransmissions) { stats->peakHourTransmissions = hourCount[h]; }
+	}
+}
+
+static void transmit(STATS * stats, uint32_t records, uint32_t * hourCount)
+{
+	stats->transmissions++;
+	stats->reports += records;
+	stats->frames += records + 2; // WAKE and the master's reply
+	stats->radioMs += FRAME_MS + MASTER_REPLY_MS + FRAME_MS + (records * COMMS_TICK_MS);
+	(*hourCount)++;
+}
+
+static void report(const char * site, POLICY policy, const STATS * stats, uint32_t days)
+{
+	printf("%-10s %-10s %10.1f %10.1f %10u %10.1f %10u %10.1f\n", site, s_policyNames[policy],
+		(double)stats->reports / days,
+		(double)stats->transmissions / days,
+		stats->peakHourTransmissions,
+		stats->reports ? stats->totalDelay / stats->reports : 0.0,
+		stats->worstDelay,
+		stats->radioMs / (1000.0 * days));
+}
@@ -0,0 +1,340 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/cpufunc.h>
+
+/*
+ * simavr Includes
+ */
+
+#include "avr_mcu_section.h"
+
+/*
+ * Local Application Includes
+ */
+
+#include "tempsense.h"
+#include "filter.h"
+#include "flush_chain.h"
+#include "comms.h"
+#include "avr_bench.h"
+
+/*
+ * Runs each hot path of the firmware a number of times with a spread of
+ * inputs, and prints the cycles and stack each took, as a table on the simavr
+ * console (GPIOR0). simavr quits when the benchmark sleeps with interrupts
+ * off at the end.
+ *
+ * Cycles are counted by Timer1 at the CPU clock. Each case has a baseline run
+ * the same way without the code under test, which is subtracted, so the
+ * figures are for the code alone. The pulse ISR is triggered by toggling its
+ * pin as an output, so its figure includes the interrupt response and RETI.
+ *
+ * Stack is measured by painting the free RAM below the stack pointer before
+ * each run and finding the deepest byte that lost its paint. It counts the
+ * bytes the code under test pushed, below its return address.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define STACK_PAINT_BYTE		(0xC5)
+
+#define TIMER1_FAST_CLOCK		(_BV(CS10))				// CPU clock
+#define TIMER1_SLOW_CLOCK		(_BV(CS11) | _BV(CS10))	// CPU clock / 64, for runs over 65535 cycles
+#define TIMER1_SLOW_DIVIDER		(64U)
+
+#define PULSE_PIN				(PIND2)	// PCINT18, OUTFLOW_PCINT_NUMBER
+
+#ifndef BENCH_REVISION
+#define BENCH_REVISION			"unknown"
+#endif
+
+typedef void (*BENCH_FN)(uint8_t run);
+
+struct bench_case
+{
+	const char * name;
+	BENCH_FN fn;
+	BENCH_FN baseline;
+	uint8_t runs;
+};
+typedef struct bench_case BENCH_CASE;
+
+struct bench_result
+{
+	uint32_t minCycles;
+	uint32_t maxCycles;
+	uint32_t totalCycles;
+	uint16_t maxStack;
+	bool approximate;
+};
+typedef struct bench_result BENCH_RESULT;
+
+/*
+ * Linker symbols (avr-libc default linker script)
+ */
+
+extern uint8_t _end;
+
+/*
+ * Private Function Prototypes
+ */
+
+static int consolePutChar(char c, FILE * stream);
+
+static void measure(BENCH_FN fn, uint8_t run, uint32_t * pCycles, uint16_t * pStack, bool * pApproximate);
+static void runCase(const BENCH_CASE * pCase, BENCH_RESULT * pResult);
+
+static void runNothing(uint8_t run);
+static void runFilter(uint8_t run);
+static void runConvert(uint8_t run);
+static void runBatchFrame(uint8_t run);
+static void runPulse(uint8_t run);
+static void runPulseMasked(uint8_t run);
+static void runTakeRx(uint8_t run);
+static void runWakePoll(uint8_t run);
+static void runDetectChain(uint8_t run);
+static void runDetectPipeline(uint8_t run);
+
+/*
+ * Private Variables
+ */
+
+AVR_MCU(F_CPU, "atmega328p");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+static FILE s_console = FDEV_SETUP_STREAM(consolePutChar, NULL, _FDEV_SETUP_WRITE);
+
+// Ten idle seconds, then a flush, so both paths through the filter are taken
+static const uint16_t s_pulses[] = {
+	15000, 15020, 14990, 15010, 15005, 14995, 15015, 14985, 15000, 15010,
+	13400, 13350, 13420, 13380, 13410, 13390, 15000, 15010, 14990, 15005
+};
+
+static const BENCH_CASE s_cases[] = {
+	{ "Filter_NewValue",			runFilter,			runNothing,		40 },
+	{ "convertToTenthsOfDegrees",	runConvert,			runNothing,		32 },
+	{ "sendData FB formatting",		runBatchFrame,		runNothing,		32 },
+	{ "pulse ISR",					runPulse,			runPulseMasked,	16 },
+	{ "COMMS_TakeRx (idle)",		runTakeRx,			runNothing,		16 },
+	{ "wake poll (idle)",			runWakePoll,		runNothing,		16 },
+	{ "detect chain (C)",			runDetectChain,		runNothing,		40 },
+	{ "detect chain (template)",	runDetectPipeline,	runNothing,		40 },
+};
+
+/*
+ * Public Function Defintions
+ */
+
+void Bench_Run(void)
+{
+	stdout = &s_console;
+
+	// Only the benchmark runs: stop the application tick
+	TIMSK0 = 0;
+	TIMSK2 = 0;
+	cli();
+
+	// The pulse pin is driven by the benchmark to raise its pin change interrupt
+	DDRD |= _BV(PULSE_PIN);
+	PCICR |= _BV(PCIE2);
+
+	printf_P(PSTR("LatrineSensor AVR benchmark, revision %s, %lu Hz\n"), BENCH_REVISION, (unsigned long)F_CPU);
+	printf_P(PSTR("function                     runs      min     mean      max  stack\n"));
+
+	for (uint8_t i = 0; i < (sizeof(s_cases) / sizeof(s_cases[0])); ++i)
+	{
+		BENCH_RESULT result;
+
+		runCase(&s_cases[i], &result);
+
+		printf_P(PSTR("%-26s %6u %8lu %8lu %8lu %6u%s\n"),
+			s_cases[i].name,
+			s_cases[i].runs,
+			(unsigned long)result.minCycles,
+			(unsigned long)(result.totalCycles / s_cases[i].runs),
+			(unsigned long)result.maxCycles,
+			result.maxStack,
+			result.approximate ? " ~" : "");
+	}
+
+	printf_P(PSTR("cycles at %lu Hz, stack in bytes; ~ marks runs timed at 1/%u resolution\n"),
+		(unsigned long)F_CPU, TIMER1_SLOW_DIVIDER);
+
+	// simavr ends the simulation here
+	cli();
+	sleep_enable();
+	sleep_cpu();
+
+	while (true) {}
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static int consolePutChar(char c, FILE * stream)
+{
+	(void)stream;
+	GPIOR0 = c;
+	return 0;
+}
+
+static void measure(BENCH_FN fn, uint8_t run, uint32_t * pCycles, uint16_t * pStack, bool * pApproximate)
+{
+	// SP is the next free byte, and nothing below it is in use with interrupts off
+	uint8_t * sp = (uint8_t *)SP;
+
+	for (uint8_t * p = &_end; p <= sp; ++p) { *p = STACK_PAINT_BYTE; }
+
+	TCCR1A = 0;
+	TCCR1B = 0;
+	TCNT1 = 0;
+	TIFR1 = _BV(TOV1);
+	TCCR1B = TIMER1_FAST_CLOCK;
+
+	fn(run);
+
+	TCCR1B = 0;
+	uint16_t ticks = TCNT1;
+	*pApproximate = (TIFR1 & _BV(TOV1));
+
+	if (*pApproximate)
+	{
+		// Too long for the full rate count, so time it again at a lower rate
+		TCNT1 = 0;
+		TIFR1 = _BV(TOV1);
+		TCCR1B = TIMER1_SLOW_CLOCK;
+
+		fn(run);
+
+		TCCR1B = 0;
+		*pCycles = (uint32_t)TCNT1 * TIMER1_SLOW_DIVIDER;
+	}
+	else
+	{
+		*pCycles = ticks;
+	}
+
+	uint8_t * p = &_end;
+	while ((p <= sp) && (*p == STACK_PAINT_BYTE)) { p++; }
+
+	// Includes the call's return address, which the baseline run cancels out
+	*pStack = (uint16_t)((sp + 1) - p);
+}
+
+static void runCase(const BENCH_CASE * pCase, BENCH_RESULT * pResult)
+{
+	uint32_t baseCycles;
+	uint16_t baseStack;
+	bool approximate;
+
+	measure(pCase->baseline, 0, &baseCycles, &baseStack, &approximate);
+
+	pResult->minCycles = UINT32_MAX;
+	pResult->maxCycles = 0;
+	pResult->totalCycles = 0;
+	pResult->maxStack = 0;
+	pResult->approximate = false;
+
+	for (uint8_t run = 0; run < pCase->runs; ++run)
+	{
+		uint32_t cycles;
+		uint16_t stack;
+
+		measure(pCase->fn, run, &cycles, &stack, &approximate);
+
+		cycles = (cycles > baseCycles) ? (cycles - baseCycles) : 0;
+		stack = (stack > baseStack) ? (stack - baseStack) : 0;
+
+		if (cycles < pResult->minCycles) { pResult->minCycles = cycles; }
+		if (cycles > pResult->maxCycles) { pResult->maxCycles = cycles; }
+		if (stack > pResult->maxStack) { pResult->maxStack = stack; }
+
+		pResult->totalCycles += cycles;
+		pResult->approximate |= approximate;
+	}
+}
+
+static void runNothing(uint8_t run)
+{
+	(void)run;
+}
+
+static void runFilter(uint8_t run)
+{
+	(void)Filter_NewValue(s_pulses[run % (sizeof(s_pulses) / sizeof(s_pulses[0]))]);
+}
+
+static void runConvert(uint8_t run)
+{
+	// Readings from near the top to near the bottom of the ADC range
+	(void)TS_BenchConvert(64U + ((uint16_t)run * 28U));
+}
+
+static void runBatchFrame(uint8_t run)
+{
+	char message[] = "aAAFBOOaaDDD";
+	APP_BenchWriteBatchFrame(message, (uint16_t)run * 31U, (int16_t)(run * 13) - 20, (uint16_t)run * 600U);
+}
+
+static void runPulse(uint8_t run)
+{
+	(void)run;
+	PCMSK2 |= _BV(PCINT18);
+	sei();
+	PIND = _BV(PULSE_PIN);
+	_NOP();
+	_NOP();
+	cli();
+}
+
+static void runPulseMasked(uint8_t run)
+{
+	(void)run;
+	PCMSK2 &= ~_BV(PCINT18);
+	sei();
+	PIND = _BV(PULSE_PIN);
+	_NOP();
+	_NOP();
+	cli();
+}
+
+static void runTakeRx(uint8_t run)
+{
+	(void)run;
+	(void)COMMS_TakeRx();
+}
+
+/* What each pulse costs on top of its ISR: one pass of the main loop's poll, finding nothing */
+static void runWakePoll(uint8_t run)
+{
+	(void)run;
+	(void)APP_BenchPollLibraryEvents();
+}
+
+/* The chain detectFlush runs. No conversions run in the bench, so neither chain compensates. */
+static void runDetectChain(uint8_t run)
+{
+	(void)FlushChain_Sample(s_pulses[run % (sizeof(s_pulses) / sizeof(s_pulses[0]))], 1000U);
+}
+
+static void runDetectPipeline(uint8_t run)
+{
+	(void)Bench_PipelineTick(s_pulses[run % (sizeof(s_pulses) / sizeof(s_pulses[0]))]);
+}
@@ -0,0 +1,34 @@
+#ifndef _AVR_BENCH_H_
+#define _AVR_BENCH_H_
+
+/*
+ * Cycle and stack benchmark of the firmware's hot paths, built with
+ * AVR_BENCH by avr_bench.mk and run under simavr. The firmware modules expose
+ * their private hot paths through the hooks below, in AVR_BENCH builds only.
+ */
+
+/*
+ * Public Function Prototypes
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Bench_Run(void);
+
+// avr_bench_pipeline.cpp: FirmwarePipeline fed with the given pulse count
+bool Bench_PipelineTick(uint16_t pulses);
+
+// latrinesensor.c
+void APP_BenchWriteBatchFrame(char * message, uint16_t durationSecs, int16_t outflow, uint16_t ageSecs);
+bool APP_BenchPollLibraryEvents(void);
+
+// tempsense.c
+int16_t TS_BenchConvert(uint16_t reading);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
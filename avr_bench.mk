@@ -0,0 +1,110 @@
+NAME=LatrineSensorBench
+
+CC=avr-gcc
+CXX=avr-g++
+SIMAVR=simavr
+
+RM = rm -f
+
+MCU_TARGET=atmega328p
+
+LIBS_DIR = $(PROJECTS_PATH)/Libs
+
+# avr_mcu_section.h, which tells simavr the MCU, clock and console register
+SIMAVR_INCLUDE = /usr/include/simavr/avr
+
+OPT_LEVEL=s
+
+INCLUDE_DIRS = \
+	-I..\Common \
+	-I$(LIBS_DIR)/AVR \
+	-I$(LIBS_DIR)/Common \
+	-I$(LIBS_DIR)/Devices \
+	-I$(LIBS_DIR)/Generics \
+	-I$(LIBS_DIR)/Protocols \
+	-I$(LIBS_DIR)/Utility \
+	-IArduino/libraries/LatrineSensor/src \
+	-I$(SIMAVR_INCLUDE) \
+
+CFILES = \
+	latrinesensor.c \
+	comms.c \
+	tempsense.c \
+	flush_counter.c \
+	flush_chain.c \
+	threshold.c \
+	filter.c \
+	memcheck.c \
+	capture.c \
+	summary.c \
+	tempcomp.c \
+	pitlevel.c \
+	txsched.c \
+	rtc.c \
+	sampling.c \
+	evqueue.c \
+	baseline.c \
+	avr_bench.c \
+	$(LIBS_DIR)/AVR/lib_clk.c \
+	$(LIBS_DIR)/AVR/lib_sleep.c \
+	$(LIBS_DIR)/AVR/lib_wdt.c \
+	$(LIBS_DIR)/AVR/lib_io.c \
+	$(LIBS_DIR)/AVR/lib_fuses.c \
+	$(LIBS_DIR)/AVR/lib_adc.c \
+	$(LIBS_DIR)/AVR/lib_pcint.c \
+	$(LIBS_DIR)/AVR/lib_uart.c \
+	$(LIBS_DIR)/AVR/lib_tmr8.c \
+	$(LIBS_DIR)/AVR/lib_tmr8_tick.c \
+	$(LIBS_DIR)/Protocols/llap.c \
+	$(LIBS_DIR)/Devices/lib_thermistor.c \
+	$(LIBS_DIR)/Devices/lib_pot_divider.c \
+	$(LIBS_DIR)/Generics/memorypool.c \
+	$(LIBS_DIR)/Generics/ringbuf.c \
+	$(LIBS_DIR)/Generics/statemachinemanager.c \
+	$(LIBS_DIR)/Generics/statemachine.c
+
+CPPFILES = \
+	avr_bench_pipeline.cpp
+
+# The revision is printed with the table, so results can be compared across commits
+REVISION := $(shell git describe --always --dirty 2>/dev/null || echo unknown)
+
+OPTS = \
+	-Wall \
+	-Wextra \
+	-DF_CPU=8000000 \
+	-DSUPPRESS_PCINT0 \
+	-DSUPPRESS_PCINT1 \
+	-DSUPPRESS_PCINT2 \
+	-DSUPPRESS_PCINT3 \
+	-DMEMORY_POOL_BYTES=128 \
+	-DTX_BUFFER_SIZE=15 \
+	-DAVR_BENCH \
+	-DBENCH_REVISION=\"$(REVISION)\" \
+	-ffunction-sections
+
+ifdef SM_GENERIC
+OPTS += -DSM_GENERIC
+endif
+
+ifdef MEDIAN
+OPTS += -DFILTER_MEDIAN_SAMPLES=$(MEDIAN)
+endif
+
+LDFLAGS = \
+	-Wl,-gc-sections
+
+LDSUFFIX = -lm
+
+# Build the benchmark firmware and run it under simavr, which prints the table
+all: $(NAME).elf
+	$(SIMAVR) $(NAME).elf
+
+$(NAME).elf: $(CFILES) $(CPPFILES)
+	$(CXX) $(INCLUDE_DIRS) $(OPTS) -std=gnu++11 -fno-exceptions -fno-rtti -O$(OPT_LEVEL) -mmcu=$(MCU_TARGET) -c $(CPPFILES)
+	$(CC) $(INCLUDE_DIRS) $(OPTS) -std=c99 $(LDFLAGS) -O$(OPT_LEVEL) -mmcu=$(MCU_TARGET) -o $@ $(CFILES) $(CPPFILES:.cpp=.o) $(LDSUFFIX)
+	@avr-size --format=avr --mcu=$(MCU_TARGET) $(NAME).elf
+
+clean:
+	$(RM) $(NAME).elf
+	$(RM) $(CPPFILES:.cpp=.o)
@@ -0,0 +1,47 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "firmware_pipeline.h"
+#include "avr_bench.h"
+
+/*
+ * The firmware's detection chain built as a FirmwarePipeline, for avr_bench.c
+ * to time against the same chain called from C.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SAMPLE_MS	(1000U)
+
+/*
+ * Private Variables
+ */
+
+static uint16_t s_pulses;
+
+struct BenchSource
+{
+	uint16_t take(void) { return s_pulses; }
+};
+
+static FirmwarePipeline<BenchSource> s_pipeline;
+
+/*
+ * Public Function Defintions
+ */
+
+bool Bench_PipelineTick(uint16_t pulses)
+{
+	s_pulses = pulses;
+	return s_pipeline.Tick(SAMPLE_MS);
+}
@@ -0,0 +1,397 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "baseline.h"
+
+/*
+ * Keeps a long horizon history of the filter's idle average, where sensor
+ * fouling and oscillator ageing show up as slow drift. Idle samples are
+ * accumulated over each hour into a min/mean/max bucket in the hourly ring,
+ * and the hours are folded into a bucket per day in the daily ring. Nothing
+ * is stored per sample, so the cost is one add and two compares per tick.
+ *
+ * On request the newest buckets of either ring are sent oldest first, as a
+ * start frame followed by one frame per bucket:
+ *
+ * "BRnnvvvva" R = H(ours) or D(ays), nn = buckets to follow (hex), vvvv = the
+ *             first non-empty bucket's mean (hex), a = age of the newest
+ *             bucket, in 4 minute (hours) or 2 hour (days) steps (hex)
+ * "Bsdddllhh" s = sequence digit 0-9, ddd = the mean's change from the
+ *             previous bucket (hex, two's complement; 800 = no idle samples
+ *             in the bucket), ll/hh = mean - min and max - mean (hex, FF = 255
+ *             or more)
+ *
+ * A change too large for three digits is sent clamped and the remainder
+ * carried into the next bucket's change, so the receiver's running total
+ * never drifts from the sensor's.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define MS_PER_MINUTE				(60000UL)
+#define MS_PER_HOUR					(60UL * MS_PER_MINUTE)
+#define HOURS_PER_DAY				(24U)
+
+#define EMPTY_MEAN					(0xFFFFU)	// No idle samples in the bucket
+#define MAX_OFFSET					(0xFFU)		// Two hex digits for each of min and max
+#define MAX_DELTA					(2047)		// Three hex digits, two's complement
+#define EMPTY_DELTA					(0x800U)	// The one three digit value outside +/- MAX_DELTA
+#define DELTA_MASK					(0xFFFU)
+
+#define SEQUENCE_DIGITS				(10U)
+#define MAX_AGE_DIGIT				(0xFU)
+#define HOUR_AGE_STEP_MS			(4UL * MS_PER_MINUTE)
+#define DAY_AGE_STEP_HOURS			(2U)
+
+struct bucket
+{
+	uint16_t mean;
+	uint8_t belowMean;
+	uint8_t aboveMean;
+};
+typedef struct bucket BUCKET;
+
+struct accumulator
+{
+	uint32_t sum;
+	uint16_t count;
+	uint16_t min;
+	uint16_t max;
+};
+typedef struct accumulator ACCUMULATOR;
+
+struct ring
+{
+	BUCKET * buckets;
+	uint8_t length;
+	uint8_t head;	// Next bucket to be written
+	uint8_t filled;
+};
+typedef struct ring RING;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void closeHour(void);
+
+static void resetAccumulator(ACCUMULATOR * acc);
+static void addToAccumulator(ACCUMULATOR * acc, uint16_t value, uint16_t min, uint16_t max);
+static void closeAccumulator(const ACCUMULATOR * acc, BUCKET * pBucket);
+
+static void pushBucket(RING * ring, const BUCKET * pBucket);
+static const BUCKET * uploadBucket(uint8_t i);
+
+static void writeStartFrame(char * msg);
+static void writeBucketFrame(char * msg, const BUCKET * pBucket);
+static void writeHex(char * msg, uint16_t value, uint8_t digits);
+
+/*
+ * Private Variables
+ */
+
+static BUCKET s_hourBuckets[BASELINE_HOURS];
+static BUCKET s_dayBuckets[BASELINE_DAYS];
+
+static RING s_hours;
+static RING s_days;
+
+static ACCUMULATOR s_hour;	// Idle samples this hour
+static ACCUMULATOR s_day;	// Hourly means today, and the samples' min and max
+
+static uint32_t s_msInHour;
+static uint8_t s_hoursInDay;
+
+static bool s_uploadPending;
+static char s_uploadResolution;
+static uint8_t s_uploadBuckets;
+static uint8_t s_frameIndex;
+static uint16_t s_lastMean;
+
+/*
+ * Public Function Defintions
+ */
+
+void Baseline_Init(void)
+{
+	s_hours.buckets = s_hourBuckets;
+	s_hours.length = BASELINE_HOURS;
+	s_hours.head = 0;
+	s_hours.filled = 0;
+
+	s_days.buckets = s_dayBuckets;
+	s_days.length = BASELINE_DAYS;
+	s_days.head = 0;
+	s_days.filled = 0;
+
+	resetAccumulator(&s_hour);
+	resetAccumulator(&s_day);
+
+	s_msInHour = 0;
+	s_hoursInDay = 0;
+
+	s_uploadPending = false;
+	s_frameIndex = 0;
+}
+
+/*
+ * Adds the idle average from a tick on which the filter was not flushing.
+ */
+void Baseline_AddSample(uint16_t idleAverage)
+{
+	addToAccumulator(&s_hour, idleAverage, idleAverage, idleAverage);
+}
+
+void Baseline_Tick(uint16_t ms)
+{
+	s_msInHour += ms;
+
+	// An upload in progress holds the rings still; the hour closes once it is sent
+	while ((s_msInHour >= MS_PER_HOUR) && (s_frameIndex == 0))
+	{
+		s_msInHour -= MS_PER_HOUR;
+		closeHour();
+	}
+}
+
+/*
+ * Asks for the newest buckets (all of them for 0) of the hourly or daily
+ * ring to be sent with the next report. Returns false if the resolution is
+ * not recognised or an upload is already being sent.
+ */
+bool Baseline_RequestUpload(char resolution, uint8_t buckets)
+{
+	if ((resolution != BASELINE_RESOLUTION_HOURS) && (resolution != BASELINE_RESOLUTION_DAYS))
+	{
+		return false;
+	}
+
+	if (s_frameIndex > 0)
+	{
+		return false;
+	}
+
+	s_uploadPending = true;
+	s_uploadResolution = resolution;
+	s_uploadBuckets = buckets;
+
+	return true;
+}
+
+bool Baseline_IsUploadDue(void)
+{
+	return s_uploadPending;
+}
+
+void Baseline_CancelUpload(void)
+{
+	s_uploadPending = false;
+	s_frameIndex = 0;
+}
+
+/*
+ * Writes the next 9 character report body of a requested upload into msg,
+ * the start frame first. Returns false, and ends the upload, once every
+ * frame has been written.
+ */
+bool Baseline_WriteNextFrame(char * msg)
+{
+	if (!s_uploadPending)
+	{
+		return false;
+	}
+
+	if (s_frameIndex == 0)
+	{
+		writeStartFrame(msg);
+	}
+	else if (s_frameIndex <= s_uploadBuckets)
+	{
+		writeBucketFrame(msg, uploadBucket(s_frameIndex - 1));
+	}
+	else
+	{
+		Baseline_CancelUpload();
+		return false;
+	}
+
+	s_frameIndex++;
+
+	return true;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void closeHour(void)
+{
+	BUCKET bucket;
+
+	closeAccumulator(&s_hour, &bucket);
+	pushBucket(&s_hours, &bucket);
+
+	if (bucket.mean != EMPTY_MEAN)
+	{
+		addToAccumulator(&s_day, bucket.mean, s_hour.min, s_hour.max);
+	}
+
+	resetAccumulator(&s_hour);
+
+	if (++s_hoursInDay == HOURS_PER_DAY)
+	{
+		s_hoursInDay = 0;
+
+		closeAccumulator(&s_day, &bucket);
+		pushBucket(&s_days, &bucket);
+
+		resetAccumulator(&s_day);
+	}
+}
+
+static void resetAccumulator(ACCUMULATOR * acc)
+{
+	acc->sum = 0;
+	acc->count = 0;
+	acc->min = UINT16_MAX;
+	acc->max = 0;
+}
+
+static void addToAccumulator(ACCUMULATOR * acc, uint16_t value, uint16_t min, uint16_t max)
+{
+	if (acc->count == UINT16_MAX)
+	{
+		return;
+	}
+
+	acc->sum += value;
+	acc->count++;
+
+	if (min < acc->min) { acc->min = min; }
+	if (max > acc->max) { acc->max = max; }
+}
+
+static void closeAccumulator(const ACCUMULATOR * acc, BUCKET * pBucket)
+{
+	if (acc->count == 0)
+	{
+		pBucket->mean = EMPTY_MEAN;
+		pBucket->belowMean = 0;
+		pBucket->aboveMean = 0;
+		return;
+	}
+
+	uint16_t mean = (uint16_t)((acc->sum + (acc->count / 2U)) / acc->count);
+
+	// A saturated count is no use as a baseline either, so the sentinel costs nothing
+	if (mean == EMPTY_MEAN) { mean--; }
+
+	// Guards the unsigned offsets against the adjusted mean above
+	uint16_t below = (acc->min < mean) ? (uint16_t)(mean - acc->min) : 0U;
+	uint16_t above = (acc->max > mean) ? (uint16_t)(acc->max - mean) : 0U;
+
+	pBucket->mean = mean;
+	pBucket->belowMean = (below > MAX_OFFSET) ? MAX_OFFSET : (uint8_t)below;
+	pBucket->aboveMean = (above > MAX_OFFSET) ? MAX_OFFSET : (uint8_t)above;
+}
+
+static void pushBucket(RING * ring, const BUCKET * pBucket)
+{
+	ring->buckets[ring->head] = *pBucket;
+	ring->head = (ring->head + 1U) % ring->length;
+
+	if (ring->filled < ring->length)
+	{
+		ring->filled++;
+	}
+}
+
+/* The i-th of the buckets being uploaded, oldest first */
+static const BUCKET * uploadBucket(uint8_t i)
+{
+	const RING * ring = (s_uploadResolution == BASELINE_RESOLUTION_DAYS) ? &s_days : &s_hours;
+
+	uint8_t index = (ring->head + ring->length - s_uploadBuckets + i) % ring->length;
+
+	return &ring->buckets[index];
+}
+
+static void writeStartFrame(char * msg)
+{
+	const RING * ring = (s_uploadResolution == BASELINE_RESOLUTION_DAYS) ? &s_days : &s_hours;
+	uint16_t age;
+
+	if ((s_uploadBuckets == 0) || (s_uploadBuckets > ring->filled))
+	{
+		s_uploadBuckets = ring->filled;
+	}
+
+	if (s_uploadResolution == BASELINE_RESOLUTION_DAYS)
+	{
+		age = s_hoursInDay / DAY_AGE_STEP_HOURS;
+	}
+	else
+	{
+		age = (uint16_t)(s_msInHour / HOUR_AGE_STEP_MS);
+	}
+
+	s_lastMean = 0;
+
+	for (uint8_t i = 0; i < s_uploadBuckets; ++i)
+	{
+		if (uploadBucket(i)->mean != EMPTY_MEAN)
+		{
+			s_lastMean = uploadBucket(i)->mean;
+			break;
+		}
+	}
+
+	msg[0] = 'B';
+	msg[1] = s_uploadResolution;
+	writeHex(&msg[2], s_uploadBuckets, 2);
+	writeHex(&msg[4], s_lastMean, 4);
+	writeHex(&msg[8], (age > MAX_AGE_DIGIT) ? MAX_AGE_DIGIT : age, 1);
+}
+
+static void writeBucketFrame(char * msg, const BUCKET * pBucket)
+{
+	uint16_t delta = EMPTY_DELTA;
+
+	if (pBucket->mean != EMPTY_MEAN)
+	{
+		int32_t change = (int32_t)pBucket->mean - (int32_t)s_lastMean;
+
+		if (change > MAX_DELTA) { change = MAX_DELTA; }
+		if (change < -MAX_DELTA) { change = -MAX_DELTA; }
+
+		// Track what the receiver will have, so a clamped change is made up next time
+		s_lastMean = (uint16_t)((int32_t)s_lastMean + change);
+		delta = (uint16_t)change & DELTA_MASK;
+	}
+
+	msg[0] = 'B';
+	msg[1] = '0' + ((s_frameIndex - 1U) % SEQUENCE_DIGITS);
+	writeHex(&msg[2], delta, 3);
+	writeHex(&msg[5], pBucket->belowMean, 2);
+	writeHex(&msg[7], pBucket->aboveMean, 2);
+}
+
+static void writeHex(char * msg, uint16_t value, uint8_t digits)
+{
+	for (int8_t i = digits - 1; i >= 0; --i)
+	{
+		uint8_t nibble = value & 0x0F;
+		msg[i] = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
+		value >>= 4;
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef _BASELINE_H_
+#define _BASELINE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define BASELINE_HOURS				(24)	// Hourly min/mean/max of the idle average
+#define BASELINE_DAYS				(14)	// Daily min/mean/max, beyond the hourly ring
+
+#define BASELINE_RESOLUTION_HOURS	('H')
+#define BASELINE_RESOLUTION_DAYS	('D')
+
+/*
+ * Public Function Prototypes
+ */
+
+void Baseline_Init(void);
+
+void Baseline_AddSample(uint16_t idleAverage);
+void Baseline_Tick(uint16_t ms);
+
+bool Baseline_RequestUpload(char resolution, uint8_t buckets);
+bool Baseline_IsUploadDue(void);
+void Baseline_CancelUpload(void);
+
+bool Baseline_WriteNextFrame(char * msg);
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "baseline.h"
+#include "host_test.h"
+
+/*
+ * Feeds the baseline history three days of a drifting idle average, with
+ * gaps for flushes and one hour with no idle samples at all, then uploads
+ * both rings and decodes the frames as a receiver would. The decoded buckets
+ * must match min/mean/max worked out here directly from the samples.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define TICK_MS					(1000U)
+#define TICKS_PER_HOUR			(3600L)
+#define SIM_HOURS				(72L)
+
+#define BASE_COUNT				(15000L)
+#define DRIFT_PER_HOUR			(-3L)		// Fouling: the idle count falls slowly
+#define NOISE_COUNTS			(20L)
+#define WIDE_NOISE_COUNTS		(400L)		// Beyond what two hex digits of offset can carry
+#define WIDE_HOUR				(50L)
+#define EMPTY_HOUR				(60L)		// Flushing all hour: no idle samples
+#define STEP_HOUR				(70L)		// Sensor reseated: the count jumps
+#define STEP_COUNTS				(3000L)
+
+#define FLUSH_PERIOD_TICKS		(900L)
+#define FLUSH_TICKS				(40L)
+
+#define FRAME_LENGTH			(9)
+
+struct expected
+{
+	long sum;
+	long count;
+	long min;
+	long max;
+};
+typedef struct expected EXPECTED;
+
+struct decoded
+{
+	long mean;		// -1 for an empty bucket
+	long belowMean;
+	long aboveMean;
+};
+typedef struct decoded DECODED;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void testEmpty(void);
+static void testHistory(void);
+static void testHeldDuringUpload(void);
+
+static long sampleAt(long tick);
+static void expectedBucket(const EXPECTED * e, DECODED * pBucket);
+static int upload(char resolution, uint8_t buckets, DECODED * pBuckets, int * pAge);
+static long hexField(const char * msg, int digits);
+
+/*
+ * Private Variables
+ */
+
+static int failures = 0;
+
+static EXPECTED s_hours[SIM_HOURS];
+static EXPECTED s_days[SIM_HOURS / 24];
+
+int main(void)
+{
+	testEmpty();
+	testHistory();
+	testHeldDuringUpload();
+
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void testEmpty(void)
+{
+	char msg[FRAME_LENGTH + 1] = {0};
+
+	Baseline_Init();
+
+	CHECK(!Baseline_IsUploadDue());
+	CHECK(!Baseline_WriteNextFrame(msg));
+	CHECK(!Baseline_RequestUpload('X', 0));
+
+	CHECK(Baseline_RequestUpload(BASELINE_RESOLUTION_HOURS, 0));
+	CHECK(Baseline_IsUploadDue());
+	CHECK(Baseline_WriteNextFrame(msg));
+	CHECK(strcmp(msg, "BH0000000") == 0);
+	CHECK(!Baseline_WriteNextFrame(msg));
+	CHECK(!Baseline_IsUploadDue());
+}
+
+static void testHistory(void)
+{
+	DECODED buckets[BASELINE_HOURS];
+	DECODED expected;
+	int age;
+
+	Baseline_Init();
+	memset(s_hours, 0, sizeof(s_hours));
+	memset(s_days, 0, sizeof(s_days));
+
+	for (long tick = 0; tick < (SIM_HOURS * TICKS_PER_HOUR); ++tick)
+	{
+		long hour = tick / TICKS_PER_HOUR;
+		long sample = sampleAt(tick);
+
+		if (sample >= 0)
+		{
+			Baseline_AddSample((uint16_t)sample);
+
+			EXPECTED * e = &s_hours[hour];
+			if ((e->count == 0) || (sample < e->min)) { e->min = sample; }
+			if ((e->count == 0) || (sample > e->max)) { e->max = sample; }
+			e->sum += sample;
+			e->count++;
+		}
+
+		Baseline_Tick(TICK_MS);
+	}
+
+	// Days are the mean of their hours' means, with the samples' min and max
+	for (long hour = 0; hour < SIM_HOURS; ++hour)
+	{
+		EXPECTED * day = &s_days[hour / 24];
+		DECODED h;
+
+		if (s_hours[hour].count == 0) { continue; }
+
+		expectedBucket(&s_hours[hour], &h);
+
+		if ((day->count == 0) || (s_hours[hour].min < day->min)) { day->min = s_hours[hour].min; }
+		if ((day->count == 0) || (s_hours[hour].max > day->max)) { day->max = s_hours[hour].max; }
+		day->sum += h.mean;
+		day->count++;
+	}
+
+	// The whole hourly ring: the last 24 hours, including the empty hour and the step
+	CHECK(upload(BASELINE_RESOLUTION_HOURS, 0, buckets, &age) == BASELINE_HOURS);
+	CHECK(age == 0);
+
+	for (int i = 0; i < BASELINE_HOURS; ++i)
+	{
+		long hour = SIM_HOURS - BASELINE_HOURS + i;
+
+		expectedBucket(&s_hours[hour], &expected);
+
+		if (hour == STEP_HOUR)
+		{
+			// Too large a change for one frame: clamped, then made up in the next
+			CHECK(buckets[i].mean == (buckets[i - 1].mean + 2047L));
+		}
+		else
+		{
+			CHECK(buckets[i].mean == expected.mean);
+		}
+
+		CHECK(buckets[i].belowMean == expected.belowMean);
+		CHECK(buckets[i].aboveMean == expected.aboveMean);
+	}
+
+	// Just the newest three hours, which start from the hour before the step
+	CHECK(upload(BASELINE_RESOLUTION_HOURS, 3, buckets, &age) == 3);
+	expectedBucket(&s_hours[SIM_HOURS - 3], &expected);
+	CHECK(buckets[0].mean == expected.mean);
+	CHECK(buckets[1].mean == (expected.mean + 2047L));
+	expectedBucket(&s_hours[SIM_HOURS - 1], &expected);
+	CHECK(buckets[2].mean == expected.mean);
+
+	// The daily ring holds the three days so far, however many are asked for
+	CHECK(upload(BASELINE_RESOLUTION_DAYS, 10, buckets, &age) == 3);
+	CHECK(age == 0);
+
+	for (int day = 0; day < 3; ++day)
+	{
+		expectedBucket(&s_days[day], &expected);
+		CHECK(buckets[day].mean == expected.mean);
+		CHECK(buckets[day].belowMean == expected.belowMean);
+		CHECK(buckets[day].aboveMean == expected.aboveMean);
+	}
+
+	printf("history: %ld hours, day means %ld %ld %ld, drift %+ld/day\n",
+		SIM_HOURS, buckets[0].mean, buckets[1].mean, buckets[2].mean, buckets[1].mean - buckets[0].mean);
+}
+
+static void testHeldDuringUpload(void)
+{
+	char msg[FRAME_LENGTH + 1] = {0};
+	DECODED buckets[BASELINE_HOURS];
+	int age;
+
+	Baseline_Init();
+
+	for (long tick = 0; tick < (2 * TICKS_PER_HOUR); ++tick)
+	{
+		Baseline_AddSample(15000U);
+		Baseline_Tick(TICK_MS);
+	}
+
+	// Ninety minutes over the hour once the upload has started
+	CHECK(Baseline_RequestUpload(BASELINE_RESOLUTION_HOURS, 0));
+	CHECK(Baseline_WriteNextFrame(msg));
+	CHECK(strcmp(msg, "BH023A980") == 0);
+	CHECK(!Baseline_RequestUpload(BASELINE_RESOLUTION_DAYS, 0));
+
+	for (int minute = 0; minute < 90; ++minute) { Baseline_Tick(60000U); }
+
+	CHECK(Baseline_WriteNextFrame(msg));
+	CHECK(strcmp(msg, "B00000000") == 0);
+	CHECK(Baseline_WriteNextFrame(msg));
+	CHECK(!Baseline_WriteNextFrame(msg));
+
+	// The held hour closes on the next tick, empty, half an hour ago
+	Baseline_Tick(TICK_MS);
+	CHECK(upload(BASELINE_RESOLUTION_HOURS, 0, buckets, &age) == 3);
+	CHECK(buckets[2].mean == -1);
+	CHECK(age == 7);
+
+	// Cancelling, as when the master does not answer WAKE, drops the upload
+	CHECK(Baseline_RequestUpload(BASELINE_RESOLUTION_HOURS, 0));
+	Baseline_CancelUpload();
+	CHECK(!Baseline_IsUploadDue());
+}
+
+/* The idle average on a tick, or -1 for a tick with the filter flushing */
+static long sampleAt(long tick)
+{
+	long hour = tick / TICKS_PER_HOUR;
+	long noise = (hour == WIDE_HOUR) ? WIDE_NOISE_COUNTS : NOISE_COUNTS;
+
+	if ((hour == EMPTY_HOUR) || ((tick % FLUSH_PERIOD_TICKS) < FLUSH_TICKS))
+	{
+		return -1;
+	}
+
+	long sample = BASE_COUNT + (DRIFT_PER_HOUR * tick) / TICKS_PER_HOUR;
+	sample += ((tick * 7919L) % ((2 * noise) + 1)) - noise;
+
+	if (hour >= STEP_HOUR) { sample += STEP_COUNTS; }
+
+	return sample;
+}
+
+static void expectedBucket(const EXPECTED * e, DECODED * pBucket)
+{
+	if (e->count == 0)
+	{
+		pBucket->mean = -1;
+		pBucket->belowMean = 0;
+		pBucket->aboveMean = 0;
+		return;
+	}
+
+	pBucket->mean = (e->sum + (e->count / 2)) / e->count;
+	pBucket->belowMean = (pBucket->mean - e->min > 255) ? 255 : (pBucket->mean - e->min);
+	pBucket->aboveMean = (e->max - pBucket->mean > 255) ? 255 : (e->max - pBucket->mean);
+}
+
+/* Requests an upload and decodes its frames as the master would. Returns the number of buckets. */
+static int upload(char resolution, uint8_t buckets, DECODED * pBuckets, int * pAge)
+{
+	char msg[FRAME_LENGTH + 1] = {0};
+
+	CHECK(Baseline_RequestUpload(resolution, buckets));
+	CHECK(Baseline_WriteNextFrame(msg));
+
+	CHECK((msg[0] == 'B') && (msg[1] == resolution));
+
+	int n = (int)hexField(&msg[2], 2);
+	long mean = hexField(&msg[4], 4);
+	*pAge = (int)hexField(&msg[8], 1);
+
+	for (int i = 0; i < n; ++i)
+	{
+		CHECK(Baseline_WriteNextFrame(msg));
+		CHECK((msg[0] == 'B') && (msg[1] == ('0' + (i % 10))));
+
+		long delta = hexField(&msg[2], 3);
+
+		if (delta == 0x800)
+		{
+			pBuckets[i].mean = -1;
+		}
+		else
+		{
+			mean += (delta >= 0x800) ? (delta - 0x1000) : delta;
+			pBuckets[i].mean = mean;
+		}
+
+		pBuckets[i].belowMean = hexField(&msg[5], 2);
+		pBuckets[i].aboveMean = hexField(&msg[7], 2);
+	}
+
+	CHECK(!Baseline_WriteNextFrame(msg));
+	CHECK(!Baseline_IsUploadDue());
+
+	return n;
+}
+
+static long hexField(const char * msg, int digits)
+{
+	char field[5] = {0};
+	memcpy(field, msg, digits);
+	return strtol(field, NULL, 16);
+}
@@ -0,0 +1,83 @@
+/*
+ * Standard Library Includes
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+
+#include <avr/io.h>
+ 
+/*
+ * AVR Library Includes
+ */
+
+#include "lib_uart.h"
+ 
+/*
+ * Local Application Includes
+ */
+
+#include "capture.h"
+
+/* 
+ * Private Variables
+ */
+
+static uint8_t s_sequence;
+static uint8_t s_frame[CAPTURE_FRAME_LENGTH];
+
+/*
+ * Private Function Prototypes
+ */
+
+static void writeU16(uint8_t offset, uint16_t value);
+
+/*
+ * Public Function Defintions
+ */
+
+void CAPTURE_Init(void)
+{
+	s_sequence = 0;
+	s_frame[0] = CAPTURE_SYNC0;
+	s_frame[1] = CAPTURE_SYNC1;
+	
+	UART_Init(UART0, CAPTURE_BAUD, 14, 14, false);
+}
+
+void CAPTURE_SendFrame(uint16_t pulseCount, uint16_t outflowReading, uint16_t ambientReading)
+{
+	uint8_t crc = 0;
+	uint8_t i;
+	
+	s_frame[CAPTURE_OFFSET_SEQ] = s_sequence++;
+	writeU16(CAPTURE_OFFSET_PULSES, pulseCount);
+	writeU16(CAPTURE_OFFSET_OUTFLOW, outflowReading);
+	writeU16(CAPTURE_OFFSET_AMBIENT, ambientReading);
+	
+	for (i = CAPTURE_OFFSET_SEQ; i < CAPTURE_OFFSET_CRC; ++i)
+	{
+		crc = CAPTURE_UpdateCRC(crc, s_frame[i]);
+	}
+	s_frame[CAPTURE_OFFSET_CRC] = crc;
+	
+	for (i = 0; i < CAPTURE_FRAME_LENGTH; ++i)
+	{
+		UART_PutChar(UART0, s_frame[i]);
+	}
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void writeU16(uint8_t offset, uint16_t value)
+{
+	s_frame[offset] = (uint8_t)(value & 0xFF);
+	s_frame[offset + 1] = (uint8_t)(value >> 8);
+}
@@ -0,0 +1,54 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Capture frames are sent at 500 kbaud, which the ATmega328p UART generates
+ * exactly from an 8MHz clock (U2X, UBRR = 1) and host serial drivers support.
+ */
+#define CAPTURE_BAUD			(500000UL)
+#define CAPTURE_TICK_MS			(10)
+
+#define CAPTURE_SYNC0			(0xA5)
+#define CAPTURE_SYNC1			(0x5A)
+
+/*
+ * Frame layout (multi-byte values are little-endian):
+ * 0-1: sync bytes
+ * 2: sequence number, incremented for every frame
+ * 3-4: raw pulse count for the last CAPTURE_TICK_MS window
+ * 5-6: last raw outflow ADC reading
+ * 7-8: last raw ambient ADC reading
+ * 9: CRC-8 (polynomial 0x07) of bytes 2 to 8
+ */
+enum capture_frame_offsets
+{
+	CAPTURE_OFFSET_SEQ = 2,
+	CAPTURE_OFFSET_PULSES = 3,
+	CAPTURE_OFFSET_OUTFLOW = 5,
+	CAPTURE_OFFSET_AMBIENT = 7,
+	CAPTURE_OFFSET_CRC = 9,
+	CAPTURE_FRAME_LENGTH = 10
+};
+
+/*
+ * Public Function Prototypes
+ */
+
+void CAPTURE_Init(void);
+void CAPTURE_SendFrame(uint16_t pulseCount, uint16_t outflowReading, uint16_t ambientReading);
+
+static inline uint8_t CAPTURE_UpdateCRC(uint8_t crc, uint8_t data)
+{
+	crc ^= data;
+	for (uint8_t i = 0; i < 8; ++i)
+	{
+		crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+	}
+	return crc;
+}
+
+#endif
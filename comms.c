@@ -42,6 +42,20 @@
  */
  
 #include "latrinesensor.h"
+#include "memcheck.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define LLAP_START_CHAR ('a')
+
+enum pending_reply
+{
+	REPLY_NONE,
+	REPLY_MEMORY
+};
+typedef enum pending_reply PENDING_REPLY;
 
 /* 
  * Private Variables
@@ -51,6 +65,8 @@ static char txrxBuffer[13]; // Use same buffer for transmit and receive
 
 static uint8_t rxIndex;
 
+static PENDING_REPLY s_pendingReply;
+
 static LLAP_DEVICE llapDevice;
 static char * deviceName = "PitSensor";
 static char * deviceType = "U00000001";
@@ -61,10 +77,11 @@ static char * serialNum = "PROTO01";
  * Private Function Prototypes
  */
 
-static void uartCheck(void);
 static void llapGenericHandler(LLAP_GENERIC_MSG_ENUM eMsgType, const char * genericStr, const char * msgBody);
 static void llapApplicationHandler(const char * msgBody);
 static void llapSendRequest(const char * msgBody);
+static void sendPendingReply(void);
+static void writeDecimal(char * msg, uint16_t value, uint8_t digits);
 
 /*
  * Public Function Defintions
@@ -73,6 +90,7 @@ static void llapSendRequest(const char * msgBody);
 void COMMS_Init(void)
 {
 	rxIndex = 0;
+	s_pendingReply = REPLY_NONE;
 	
 	UART_Init(UART0, 4800, 14, 14, false);
 	
@@ -97,34 +115,53 @@ void COMMS_Send(char * s)
 	LLAP_SendOutgoingMessage(&llapDevice, s);
 }
 
-void COMMS_Check(void)
-{ 
-	uartCheck();
-}
-
-static void uartCheck(void)
+/*
+ * Services the UART and returns true if a character has been received.
+ * Called on every wake of the main loop, with interrupts enabled.
+ */
+bool COMMS_TakeRx(void)
 {
 	bool rx = false;
 	bool tx = false;
 	UART0_Task(&rx, &tx);
 	
-	if (rx)
+	return rx;
+}
+
+/* Handles the character COMMS_TakeRx reported */
+void COMMS_HandleRx(void)
+{
+	char c = UART_GetChar(UART0, NULL);
+	
+	if (c == LLAP_START_CHAR)
+	{
+		// Always resynchronise on the start of a new message
+		rxIndex = 0;
+	}
+	
+	txrxBuffer[rxIndex++] = c;
+	txrxBuffer[rxIndex] = '\0';
+			
+	if (rxIndex == LLAP_MESSAGE_LENGTH)
 	{
-		txrxBuffer[rxIndex] = UART_GetChar(UART0, NULL);
-				
-		if (strlen(txrxBuffer) == LLAP_MESSAGE_LENGTH)
-		{
-			LLAP_HandleIncomingMessage(&llapDevice, txrxBuffer);
-			rxIndex = 0;
-		}
+		LLAP_HandleIncomingMessage(&llapDevice, txrxBuffer);
+		rxIndex = 0;
 	}
+	
+	sendPendingReply();
 }
 
 static void llapGenericHandler(LLAP_GENERIC_MSG_ENUM eMsgType, const char * genericStr, const char * msgBody)
 {
 	(void)eMsgType;
-	(void)genericStr;
 	(void)msgBody;
+	
+	// Only the master's ACK answers WAKE. Other generic messages (a HELLO, a
+	// device ID change) can arrive at any time and must not start a report.
+	if (strncmp(genericStr, "ACK", 3) == 0)
+	{
+		APP_HandleMasterReply();
+	}
 }
 
 static void llapApplicationHandler(const char * msgBody)
@@ -133,6 +170,40 @@ static void llapApplicationHandler(const char * msgBody)
 	{
 		APP_HandleNewThresholdSetting(&msgBody[2]);
 	}
+	else if ((msgBody[0] == 'R') && (msgBody[1] == 'P'))
+	{
+		APP_HandleNewReportPeriod(&msgBody[2]);
+	}
+	else if ((msgBody[0] == 'L') && (msgBody[1] == 'B'))
+	{
+		APP_HandleNewLatencyBudget(&msgBody[2]);
+	}
+	else if (msgBody[0] == 'S')
+	{
+		APP_HandleTimeSync(&msgBody[1]);
+	}
+	else if ((msgBody[0] == 'P') && (msgBody[1] == 'C'))
+	{
+		APP_HandleNewPitCapacity(&msgBody[2]);
+	}
+	else if ((msgBody[0] == 'F') && (msgBody[1] == 'R'))
+	{
+		APP_HandleNewFlowRate(&msgBody[2]);
+	}
+	else if ((msgBody[0] == 'L') && (msgBody[1] == 'R'))
+	{
+		APP_HandlePitEmptied();
+	}
+	else if ((msgBody[0] == 'B') && ((msgBody[1] == 'H') || (msgBody[1] == 'D')))
+	{
+		APP_HandleBaselineRequest(&msgBody[1]);
+	}
+	else if ((msgBody[0] == 'M') && (msgBody[1] == 'E') && (msgBody[2] == 'M'))
+	{
+		// Reply once the incoming message has been handled, since the
+		// transmit and receive buffers are shared
+		s_pendingReply = REPLY_MEMORY;
+	}
 }
 
 static void llapSendRequest(const char * msgBody)
@@ -140,3 +211,27 @@ static void llapSendRequest(const char * msgBody)
 	UART_PutStr(UART0, (uint8_t*)msgBody);
 }
 
+static void sendPendingReply(void)
+{
+	if (s_pendingReply == REPLY_MEMORY)
+	{
+		// Minimum free stack bytes seen since boot, then static RAM bytes
+		char message[] = "aAAMffffssss";
+		
+		writeDecimal(&message[4], MemCheck_GetStackFreeBytes(), 4);
+		writeDecimal(&message[8], MemCheck_GetStaticBytes(), 4);
+		
+		COMMS_Send(message);
+	}
+	
+	s_pendingReply = REPLY_NONE;
+}
+
+static void writeDecimal(char * msg, uint16_t value, uint8_t digits)
+{
+	while (digits--)
+	{
+		msg[digits] = (value % 10U) + '0';
+		value /= 10U;
+	}
+}
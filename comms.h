@@ -7,6 +7,8 @@
  
 void COMMS_Init(void);
 void COMMS_Send(char * s);
-void COMMS_Check(void);
+
+bool COMMS_TakeRx(void);
+void COMMS_HandleRx(void);
 
 #endif
@@ -0,0 +1,115 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "evqueue.h"
+
+/*
+ * Single producer, single consumer event queue from interrupts to the main
+ * loop. Neither side disables interrupts or waits for the other.
+ *
+ * The producer is interrupt context. AVR interrupts do not nest, so ISRs
+ * never post concurrently with each other, and code in the main loop may
+ * also post while interrupts are disabled. The consumer is the main loop.
+ *
+ * Each index is written by one side only and is a single byte, so it is
+ * read and written whole. The producer fills a slot before publishing the
+ * new head with a release store, and the consumer reads head with an acquire
+ * load before reading the slot, so a slot is never seen half written. The
+ * consumer frees a slot the same way through tail.
+ *
+ * Indexes run freely over 0-255 and are masked to the slot, so head - tail
+ * is the number of events queued, and a full queue is told apart from an
+ * empty one without a spare slot.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define INDEX_MASK	(EVQ_LENGTH - 1U)
+
+#if ((EVQ_LENGTH & INDEX_MASK) != 0) || (EVQ_LENGTH > 128)
+#error EVQ_LENGTH must be a power of two, at most 128
+#endif
+
+/*
+ * Private Variables
+ */
+
+static EVQ_EVENT s_events[EVQ_LENGTH];
+
+static uint8_t s_head;		// Written by the producer
+static uint8_t s_tail;		// Written by the consumer
+
+static uint8_t s_dropped;	// Written by the producer
+
+/*
+ * Public Function Defintions
+ */
+
+void EVQ_Init(void)
+{
+	__atomic_store_n(&s_head, 0U, __ATOMIC_RELAXED);
+	__atomic_store_n(&s_tail, 0U, __ATOMIC_RELAXED);
+	s_dropped = 0U;
+}
+
+/*
+ * Queues an event. Returns false, and counts the event as dropped, if the
+ * queue is full.
+ */
+bool EVQ_Post(uint8_t type, uint16_t data)
+{
+	uint8_t head = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+	uint8_t tail = __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE);
+
+	if ((uint8_t)(head - tail) == EVQ_LENGTH)
+	{
+		if (s_dropped < UINT8_MAX) { __atomic_store_n(&s_dropped, (uint8_t)(s_dropped + 1U), __ATOMIC_RELAXED); }
+		return false;
+	}
+
+	EVQ_EVENT * pEvent = &s_events[head & INDEX_MASK];
+	pEvent->type = type;
+	pEvent->data = data;
+
+	__atomic_store_n(&s_head, (uint8_t)(head + 1U), __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/*
+ * Removes the oldest event. Returns false if the queue is empty.
+ */
+bool EVQ_Take(EVQ_EVENT * pEvent)
+{
+	uint8_t tail = __atomic_load_n(&s_tail, __ATOMIC_RELAXED);
+	uint8_t head = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+
+	if (head == tail) { return false; }
+
+	*pEvent = s_events[tail & INDEX_MASK];
+
+	__atomic_store_n(&s_tail, (uint8_t)(tail + 1U), __ATOMIC_RELEASE);
+
+	return true;
+}
+
+bool EVQ_IsEmpty(void)
+{
+	return __atomic_load_n(&s_head, __ATOMIC_ACQUIRE) == __atomic_load_n(&s_tail, __ATOMIC_RELAXED);
+}
+
+/* Events lost to a full queue since EVQ_Init, saturating at 255 */
+uint8_t EVQ_GetDropped(void)
+{
+	return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,32 @@
+#ifndef _EVQUEUE_H_
+#define _EVQUEUE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define EVQ_LENGTH	(16U)	// Power of two, at most 128
+
+struct evq_event
+{
+	uint8_t type;
+	uint16_t data;
+};
+typedef struct evq_event EVQ_EVENT;
+
+/*
+ * Public Function Prototypes
+ */
+
+void EVQ_Init(void);
+
+// Producer side: interrupt context only
+bool EVQ_Post(uint8_t type, uint16_t data);
+
+// Consumer side: main loop only
+bool EVQ_Take(EVQ_EVENT * pEvent);
+bool EVQ_IsEmpty(void);
+
+uint8_t EVQ_GetDropped(void);
+
+#endif
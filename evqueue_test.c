@@ -0,0 +1,223 @@
+#define _POSIX_C_SOURCE 200112L // sched_yield
+
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "evqueue.h"
+#include "host_test.h"
+
+/*
+ * Checks the event queue on its own, then runs it with a thread standing in
+ * for the interrupts and the main thread as the main loop:
+ *
+ * lossless: the producer retries until each post succeeds, and every event
+ *           must arrive once, in order, intact.
+ * isr:      the producer posts in bursts and never waits, as an ISR would. The
+ *           events that arrive must be in order, and with the failed posts
+ *           must account for every event.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define THREAD_EVENTS		(2000000UL)
+#define BURST_LENGTH		(EVQ_LENGTH + 4U)
+
+struct producer
+{
+	bool retry;
+	unsigned long failedPosts;
+};
+typedef struct producer PRODUCER;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void testSingleThread(void);
+static void testThreads(bool retry);
+static void * producerThread(void * arg);
+
+static uint8_t typeOf(unsigned long i);
+static uint16_t dataOf(unsigned long i);
+
+/*
+ * Private Variables
+ */
+
+static int failures = 0;
+
+int main(void)
+{
+	testSingleThread();
+	testThreads(true);
+	testThreads(false);
+
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void testSingleThread(void)
+{
+	EVQ_EVENT event;
+
+	EVQ_Init();
+
+	CHECK(EVQ_IsEmpty());
+	CHECK(!EVQ_Take(&event));
+
+	for (unsigned long i = 0; i < EVQ_LENGTH; ++i)
+	{
+		CHECK(EVQ_Post(typeOf(i), dataOf(i)));
+	}
+
+	CHECK(!EVQ_Post(0U, 0U));
+	CHECK(EVQ_GetDropped() == 1U);
+
+	for (unsigned long i = 0; i < EVQ_LENGTH; ++i)
+	{
+		CHECK(EVQ_Take(&event) && (event.type == typeOf(i)) && (event.data == dataOf(i)));
+	}
+
+	CHECK(EVQ_IsEmpty());
+
+	// Past the wrap of the free running indexes, at every fill level
+	unsigned long posted = 0;
+	unsigned long taken = 0;
+
+	for (unsigned int round = 0; round < 600; ++round)
+	{
+		unsigned int fill = round % (EVQ_LENGTH + 1U);
+
+		while ((posted - taken) < fill)
+		{
+			CHECK(EVQ_Post(typeOf(posted), dataOf(posted)));
+			posted++;
+		}
+
+		while (EVQ_Take(&event))
+		{
+			CHECK((event.type == typeOf(taken)) && (event.data == dataOf(taken)));
+			taken++;
+		}
+	}
+
+	CHECK(posted == taken);
+
+	printf("single thread: %lu events through the queue\n", posted);
+}
+
+static void testThreads(bool retry)
+{
+	PRODUCER producer = { retry, 0UL };
+	pthread_t thread;
+	EVQ_EVENT event;
+
+	EVQ_Init();
+
+	if (pthread_create(&thread, NULL, producerThread, &producer) != 0)
+	{
+		printf("FAILED: could not start the producer thread\n");
+		failures++;
+		return;
+	}
+
+	unsigned long received = 0;
+	unsigned long next = 0;
+	bool ordered = true;
+	bool done = false;
+
+	while (!done)
+	{
+		while (EVQ_Take(&event))
+		{
+			// The data carries the low bits of the index, the type the next seven
+			unsigned long low = event.data;
+			unsigned long high = event.type;
+
+			// Events can only be missing (lost to a full queue), so move forward to the next match
+			while ((next < THREAD_EVENTS) && ((dataOf(next) != low) || (typeOf(next) != high))) { next++; }
+
+			if (next == THREAD_EVENTS) { ordered = false; break; }
+
+			received++;
+			next++;
+		}
+
+		// Nothing queued: let the producer run, as the main loop would sleep
+		sched_yield();
+
+		unsigned long failedPosts = __atomic_load_n(&producer.failedPosts, __ATOMIC_ACQUIRE);
+		done = (next >= THREAD_EVENTS) || !ordered || ((received + failedPosts) >= THREAD_EVENTS);
+
+		if (done)
+		{
+			pthread_join(thread, NULL);
+
+			// Anything posted after the last check
+			while (EVQ_Take(&event)) { received++; }
+		}
+	}
+
+	CHECK(ordered);
+	CHECK((received + producer.failedPosts) == THREAD_EVENTS);
+
+	if (retry)
+	{
+		CHECK(received == THREAD_EVENTS);
+	}
+
+	printf("%-8s: %lu events, %lu received, %lu posts failed on a full queue\n",
+		retry ? "lossless" : "isr", THREAD_EVENTS, received, producer.failedPosts);
+}
+
+static void * producerThread(void * arg)
+{
+	PRODUCER * pProducer = (PRODUCER *)arg;
+	unsigned long failed = 0;
+
+	for (unsigned long i = 0; i < THREAD_EVENTS; ++i)
+	{
+		if (pProducer->retry)
+		{
+			while (!EVQ_Post(typeOf(i), dataOf(i))) { sched_yield(); }
+		}
+		else
+		{
+			if (!EVQ_Post(typeOf(i), dataOf(i))) { failed++; }
+
+			// A pause after each burst lets the main loop catch up, as between interrupts
+			if ((i % BURST_LENGTH) == (BURST_LENGTH - 1U)) { sched_yield(); }
+		}
+	}
+
+	__atomic_store_n(&pProducer->failedPosts, failed, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/* Together the type and data are a 23 bit event index, unique within a run */
+static uint8_t typeOf(unsigned long i)
+{
+	return (uint8_t)((i >> 16) & 0x7FU);
+}
+
+static uint16_t dataOf(unsigned long i)
+{
+	return (uint16_t)(i & 0xFFFFU);
+}
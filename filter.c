@@ -5,24 +5,17 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-/*
- * Generic Library Includes
- */
- 
-#include "averager.h"
-
 /*
  * Local Application Includes
  */
 
+#include "detect_core.h"
 #include "threshold.h"
 #include "filter.h"
 
 /*
  * Defines and typedefs
  */
- 
-#define N 10 // Number of samples to average
 
 /*
  * Private Function Prototypes
@@ -31,56 +24,40 @@
 /* 
  * Private Variables
  */
- 
-static uint16_t s_idleAverage = 0UL;
-static uint16_t s_lastThreeAverage = 0UL;
 
-static AVERAGER* s_idleAverager;
-static AVERAGER* s_lastThreeAverager;
+static DETECT_FILTER s_filter;
 
-static bool s_bFlushing;
+#if FILTER_MEDIAN_SAMPLES
+static DETECT_MEDIAN s_median;
+#endif
 
 void Filter_Init(void)
 {
-	s_idleAverager = AVERAGER_GetAverager(U16, N);
-	s_lastThreeAverager = AVERAGER_GetAverager(U16, 3);
-	s_bFlushing = false;
+	Detect_FilterInit(&s_filter, FILTER_IDLE_SAMPLES);
+#if FILTER_MEDIAN_SAMPLES
+	Detect_MedianInit(&s_median, FILTER_MEDIAN_SAMPLES);
+#endif
 }
 
 bool Filter_NewValue(uint16_t newValue)
 {
+#if FILTER_MEDIAN_SAMPLES
+	newValue = Detect_MedianAdd(&s_median, newValue);
+#endif
+	return Detect_FilterNewValue(&s_filter, newValue, Threshold_Get());
+}
 
-	AVERAGER_NewData(s_lastThreeAverager, &newValue);
-	AVERAGER_GetAverage(s_lastThreeAverager, &s_lastThreeAverage);
-
-	// Flush has started when average reading has dropped below threshold
-	bool bFlushing = s_lastThreeAverage < (s_idleAverage - Threshold_Get());
-
-	if (s_bFlushing && !bFlushing)
-	{
-		// Stopped flushing, reset the idle averager to the last three readings
-		AVERAGER_Reset(s_idleAverager, &s_lastThreeAverage);
-	}
-	
-	s_bFlushing = bFlushing;
-	
-	if (!bFlushing)
-	{
-		// Not flushing, so make this reading part of the idle average and update
-		AVERAGER_NewData(s_idleAverager, &newValue);
-		AVERAGER_GetAverage(s_idleAverager, &s_idleAverage);
-
-	}
-	
-	return s_bFlushing;
+bool Filter_IsDeviating(void)
+{
+	return Detect_FilterIsDeviating(&s_filter, Threshold_Get());
 }
 
 uint16_t Filter_GetIdleAverage(void)
 {
-	return s_idleAverage;
+	return s_filter.idleAverage;
 }
 
 uint16_t Filter_GetLastThreeAverage(void)
 {
-	return s_lastThreeAverage;
-}
\ No newline at end of file
+	return s_filter.recentAverage;
+}
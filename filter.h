@@ -4,13 +4,22 @@
 /*
  * Defines and typedefs
  */
- 
+
+// Temperature compensation keeps the baseline flat, so a short window is enough
+#define FILTER_IDLE_SAMPLES (4U)
+
+// Median pre-filter window (3, 5 or 7) to reject spikes, 0 for none. Set with "make MEDIAN=n".
+#ifndef FILTER_MEDIAN_SAMPLES
+#define FILTER_MEDIAN_SAMPLES (0U)
+#endif
+
 /*
  * Public Function Prototypes
  */
  
 void Filter_Init(void);
 bool Filter_NewValue(uint16_t newValue);
+bool Filter_IsDeviating(void);
 
 uint16_t Filter_GetIdleAverage(void);
 uint16_t Filter_GetLastThreeAverage(void);
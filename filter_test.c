@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 199309L
+
 /*
  * Standard Library Includes
  */
@@ -5,8 +7,13 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 /*
  * Utility Library Includes
  */
@@ -17,16 +24,100 @@
  * Local Application Includes
  */
 
+#include "detect_core.h"
+#include "threshold.h"
 #include "filter.h"
+#include "host_test.h"
+
+/*
+ * With no arguments, prints a CSV trace of the firmware filter over a test
+ * sequence: sample, idle average, recent average, flushing.
+ *
+ * With "compare", replays a simulated day of flushes with isolated noise
+ * bursts through the flush detector with no median pre-filter and with 3, 5
+ * and 7 sample medians, and scores each against the true flushes. Also checks the
+ * median networks against a sort, and times each path on the host.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SIM_SAMPLES				(86400L)
+#define TIMING_SAMPLES			(2000000L)
+
+#define SPIKE_MIN_COUNTS		(1500)
+#define SPIKE_MAX_COUNTS		(4000)
+#define BURST_GAP_SAMPLES		(DETECT_MEDIAN_MAX_SAMPLES)	// Bursts are isolated
+
+#define FLUSH_PERIOD_S			(600L)
+#define FLUSH_MIN_S				(10L)
+#define FLUSH_MAX_S				(60L)
+
+#define THRESHOLD				(250U)	// Firmware threshold and idle window
+#define IDLE_SAMPLES			(4U)
+
+#define N_PIPELINES				(4)
+#define MAX_FLUSHES				((SIM_SAMPLES / FLUSH_PERIOD_S) + 1)
+
+struct scenario
+{
+	const char * name;
+	long spikePeriod;	// Mean samples between noise bursts, 0 for none
+	uint8_t burstLength;
+};
+typedef struct scenario SCENARIO;
+
+struct pipeline
+{
+	uint8_t medianLength;
+	DETECT_MEDIAN median;
+	DETECT_FILTER filter;
+	DETECT_FLUSH flush;
+	long start;
+	SIM_SCORE score;
+};
+typedef struct pipeline PIPELINE;
+
+/*
+ * Private Function Prototypes
+ */
+
+static int trace(void);
+static int compare(void);
+static bool checkNetworks(void);
+static bool checkLowIdle(void);
+static uint16_t sample(const SCENARIO * s, long t, bool * pFlowing);
+static double hostCyclesPerSample(uint8_t medianLength);
+
+/*
+ * Private Variables
+ */
 
 static SEQUENCE * seq;
+static int failures = 0;
+
+static const SCENARIO s_scenarios[] = {
+	{ "clean",			0,		0 },
+	{ "EMI spikes",		300,	1 },
+	{ "pump bursts",	600,	2 },
+};
 
 int main(int argc, char * argv[])
 {
-	(void)argc; (void)argv;
+	if ((argc > 1) && (strcmp(argv[1], "compare") == 0))
+	{
+		return compare();
+	}
+	
+	return trace();
+}
 
+static int trace(void)
+{
 	srand (time(NULL));
 	
+	Threshold_Init();
 	Filter_Init();
 	
 	seq = SEQGEN_GetNewSequence(1000);
@@ -46,4 +137,241 @@ int main(int argc, char * argv[])
 	} while (!SEQGEN_EOS(seq));
 
 	return 0;
-}
\ No newline at end of file
+}
+
+static int compare(void)
+{
+	static SIM_FLUSH flushes[MAX_FLUSHES];
+	static uint8_t matched[N_PIPELINES][MAX_FLUSHES];
+	static const uint8_t medianLengths[N_PIPELINES] = { 0, 3, 5, 7 };
+	
+	CHECK(checkNetworks());
+	CHECK(checkLowIdle());
+	
+	for (size_t sc = 0; sc < (sizeof(s_scenarios) / sizeof(s_scenarios[0])); ++sc)
+	{
+		const SCENARIO * s = &s_scenarios[sc];
+		PIPELINE pipelines[N_PIPELINES];
+		long nFlushes = 0;
+		bool wasFlowing = false;
+		
+		memset(matched, 0, sizeof(matched));
+		srand(1);
+		
+		for (uint8_t p = 0; p < N_PIPELINES; ++p)
+		{
+			memset(&pipelines[p], 0, sizeof(PIPELINE));
+			pipelines[p].medianLength = medianLengths[p];
+			Detect_MedianInit(&pipelines[p].median, medianLengths[p]);
+			Detect_FilterInit(&pipelines[p].filter, IDLE_SAMPLES);
+			Detect_FlushReset(&pipelines[p].flush);
+		}
+		
+		for (long t = 0; t < SIM_SAMPLES; ++t)
+		{
+			bool flowing;
+			uint16_t count = sample(s, t, &flowing);
+			
+			if (flowing && !wasFlowing) { flushes[nFlushes].start = t; }
+			if (!flowing && wasFlowing) { flushes[nFlushes++].end = t; }
+			wasFlowing = flowing;
+			
+			for (uint8_t p = 0; p < N_PIPELINES; ++p)
+			{
+				PIPELINE * pl = &pipelines[p];
+				uint16_t value = pl->medianLength ? Detect_MedianAdd(&pl->median, count) : count;
+				bool flushing = Detect_FilterNewValue(&pl->filter, value, THRESHOLD);
+				
+				if (flushing && (Detect_FlushDurationMs(&pl->flush) == 0U)) { pl->start = t; }
+				
+				if (Detect_FlushUpdate(&pl->flush, DETECT_SAMPLE_MS, flushing))
+				{
+					if (Detect_FlushTriggered(&pl->flush))
+					{
+						long end = t - (DETECT_STOPPED_DELAY_MS / DETECT_SAMPLE_MS);
+						Sim_Score(&pl->score, flushes, matched[p], nFlushes, pl->start, end, Detect_FlushDurationMs(&pl->flush));
+					}
+					Detect_FlushReset(&pl->flush);
+				}
+			}
+		}
+		
+		printf("%s: %ld flushes\n", s->name, nFlushes);
+		
+		for (uint8_t p = 0; p < N_PIPELINES; ++p)
+		{
+			SIM_SCORE * score = &pipelines[p].score;
+			uint32_t scored = score->detected ? score->detected : 1U;
+			
+			printf("  median %u: %3u detected, %3u false, %3u split, mean duration error %4.1fs\n",
+				pipelines[p].medianLength, score->detected, score->falseFlushes, score->splits, (double)score->durationError / scored);
+		}
+		
+		if (s->spikePeriod == 0)
+		{
+			// Without noise every path finds every flush
+			for (uint8_t p = 0; p < N_PIPELINES; ++p)
+			{
+				CHECK(pipelines[p].score.detected == (uint32_t)nFlushes);
+				CHECK(pipelines[p].score.falseFlushes == 0);
+			}
+		}
+		else
+		{
+			// A window of 2n+1 rejects bursts of up to n samples
+			for (uint8_t p = 1; p < N_PIPELINES; ++p)
+			{
+				if (pipelines[p].medianLength > (2U * s->burstLength))
+				{
+					CHECK(pipelines[p].score.detected == (uint32_t)nFlushes);
+					CHECK(pipelines[p].score.falseFlushes == 0);
+					CHECK(pipelines[p].score.splits == 0);
+				}
+			}
+			CHECK(pipelines[0].score.falseFlushes > 0);
+		}
+	}
+	
+	printf("Host cycles per sample:");
+	for (uint8_t p = 0; p < N_PIPELINES; ++p)
+	{
+		printf(" median %u %.1f%s", medianLengths[p], hostCyclesPerSample(medianLengths[p]), (p < (N_PIPELINES - 1)) ? "," : "\n");
+	}
+	
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
+
+/*
+ * By the 0-1 principle a comparator network is correct for all inputs if it
+ * is correct for every input of zeros and ones.
+ */
+static bool checkNetworks(void)
+{
+	static const uint8_t lengths[] = { 3, 5, 7 };
+	
+	for (uint8_t l = 0; l < sizeof(lengths); ++l)
+	{
+		uint8_t n = lengths[l];
+		
+		for (uint16_t bits = 0; bits < (1U << n); ++bits)
+		{
+			DETECT_MEDIAN median;
+			uint16_t out = 0;
+			uint8_t ones = 0;
+			
+			Detect_MedianInit(&median, n);
+			for (uint8_t i = 0; i < n; ++i)
+			{
+				uint16_t bit = (bits >> i) & 1U;
+				ones += bit;
+				out = Detect_MedianAdd(&median, bit);
+			}
+			
+			if (out != ((ones > (n / 2U)) ? 1U : 0U)) { return false; }
+		}
+	}
+	
+	return true;
+}
+
+/*
+ * With the idle count below the threshold, idle - threshold is negative. The
+ * core compares signed, so it can't wrap to a huge value that reads as a
+ * flush on every sample, as the firmware's 16 bit unsigned compare did with
+ * the AVR's 16 bit int.
+ */
+static bool checkLowIdle(void)
+{
+	DETECT_FILTER filter;
+	bool flushing = false;
+	
+	Detect_FilterInit(&filter, IDLE_SAMPLES);
+	for (uint16_t i = 0; i < 100; ++i)
+	{
+		flushing |= Detect_FilterNewValue(&filter, (uint16_t)(THRESHOLD / 2U) + (i % 3U), THRESHOLD);
+	}
+	
+	// Down to nothing: still no drop of more than the threshold
+	for (uint16_t i = 0; i < 10; ++i)
+	{
+		flushing |= Detect_FilterNewValue(&filter, 0U, THRESHOLD);
+	}
+	
+	return !flushing;
+}
+
+static uint16_t sample(const SCENARIO * s, long t, bool * pFlowing)
+{
+	static SIM_FLUSH flush;
+	static uint8_t burstLeft;
+	static uint8_t holdoff;
+	static int32_t burst;
+	
+	if ((t % FLUSH_PERIOD_S) == 0)
+	{
+		Sim_PlanFlush(&flush, t, FLUSH_PERIOD_S, FLUSH_MIN_S, FLUSH_MAX_S);
+	}
+	
+	*pFlowing = (t >= flush.start) && (t < flush.end);
+	
+	int32_t count = Sim_Count(*pFlowing);
+	
+	if (holdoff)
+	{
+		holdoff--;
+	}
+	else if (s->spikePeriod && ((rand() % s->spikePeriod) == 0))
+	{
+		// Either way: down looks like a flush starting, up like one ending
+		burst = SPIKE_MIN_COUNTS + (rand() % (SPIKE_MAX_COUNTS - SPIKE_MIN_COUNTS));
+		if (rand() & 1) { burst = -burst; }
+		burstLeft = s->burstLength;
+		holdoff = s->burstLength + BURST_GAP_SAMPLES;
+	}
+	
+	if (burstLeft)
+	{
+		count += burst;
+		burstLeft--;
+	}
+	
+	return (uint16_t)count;
+}
+
+static double hostCyclesPerSample(uint8_t medianLength)
+{
+	DETECT_MEDIAN median;
+	DETECT_FILTER filter;
+	volatile bool sink = false;
+	
+	Detect_MedianInit(&median, medianLength);
+	Detect_FilterInit(&filter, IDLE_SAMPLES);
+	srand(2);
+	
+	static uint16_t counts[4096];
+	for (int i = 0; i < 4096; ++i) { counts[i] = (uint16_t)(SIM_BASE_COUNT + (rand() % 2000) - 1000); }
+	
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t start = __rdtsc();
+#else
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+	
+	for (long i = 0; i < TIMING_SAMPLES; ++i)
+	{
+		uint16_t value = counts[i & 4095];
+		if (medianLength) { value = Detect_MedianAdd(&median, value); }
+		sink = Detect_FilterNewValue(&filter, value, THRESHOLD);
+	}
+	(void)sink;
+	
+#if defined(__x86_64__) || defined(__i386__)
+	return (double)(__rdtsc() - start) / TIMING_SAMPLES;
+#else
+	// Reported as nanoseconds where there is no cycle counter
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec)) / TIMING_SAMPLES;
+#endif
+}
@@ -0,0 +1,68 @@
+#ifndef _FIRMWARE_PIPELINE_H_
+#define _FIRMWARE_PIPELINE_H_
+
+/*
+ * The firmware's flush detection chain (FlushChain_Sample in flush_chain.c)
+ * expressed as a DetectPipeline, for C++ builds:
+ *
+ *	pulses -> FlushChain_Compensate -> [median] -> Filter (FILTER_IDLE_SAMPLES, Threshold_Get)
+ *	       -> FlushChain_Sampled -> Flush counter -> FlushChain_Stopped, FlushChain_Flushed
+ *
+ * Only the filter and counter are the template's own; compensation and
+ * everything done with the results go through the same functions as the C
+ * chain, so the two cannot drift apart. The pulse source is left as a
+ * parameter. The detect circuit gating in sampling.c stays outside the chain,
+ * since it decides whether a sample is taken at all. Include after stdint.h
+ * and stdbool.h, like the C headers.
+ */
+
+#include "DetectPipeline.h"
+
+extern "C" {
+#include "threshold.h"
+#include "filter.h"
+#include "flush_chain.h"
+}
+
+/*
+ * Defines and typedefs
+ */
+
+struct FirmwareThreshold
+{
+	static uint16_t get(void) { return Threshold_Get(); }
+};
+
+struct FlushChainPreFilter
+{
+	uint16_t apply(uint16_t count) { return FlushChain_Compensate(count); }
+};
+
+struct FlushChainReporter
+{
+	template <class Detector>
+	void sample(uint16_t ms, const Detector & detector)
+	{
+		FlushChain_Sampled(detector.IsFlushing(), detector.IsDeviating(), detector.GetIdleAverage(), ms);
+	}
+
+	void flush(uint32_t durationMs) { FlushChain_Flushed(durationMs); }
+	void idle(void) { FlushChain_Stopped(); }
+};
+
+#if FILTER_MEDIAN_SAMPLES
+typedef PreFilterChain<FlushChainPreFilter, MedianPreFilter<FILTER_MEDIAN_SAMPLES> > FirmwarePreFilter;
+#else
+typedef FlushChainPreFilter FirmwarePreFilter;
+#endif
+
+template <class Source, class Reporter = FlushChainReporter>
+using FirmwarePipeline = DetectPipeline<
+	Source,
+	FirmwarePreFilter,
+	MeanDetector<FirmwareThreshold, FILTER_IDLE_SAMPLES>,
+	FlushCounter,
+	Reporter
+>;
+
+#endif
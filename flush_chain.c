@@ -0,0 +1,128 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "detect_core.h"
+#include "tempsense.h"
+#include "tempcomp.h"
+#include "filter.h"
+#include "flush_counter.h"
+#include "summary.h"
+#include "pitlevel.h"
+#include "txsched.h"
+#include "rtc.h"
+#include "sampling.h"
+#include "baseline.h"
+#include "flush_chain.h"
+
+/*
+ * The flush detection chain, run on each sample the detect circuit was
+ * powered for:
+ *
+ *	pulses -> TComp_Apply -> Filter -> Baseline, Sampling -> Flush counter
+ *	       -> TComp_Learn -> Summary, Level, TxSched
+ *
+ * FlushChain_Sample is the whole chain on filter.c and flush_counter.c, as
+ * the firmware runs it. The stages either side of the filter and counter are
+ * public too, so that the FirmwarePipeline template (firmware_pipeline.h),
+ * which has its own filter and counter, reports exactly the same way.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define MS_PER_SECOND	(1000U)
+
+/*
+ * Public Function Defintions
+ */
+
+/*
+ * Returns true once there has been no flushing for long enough that flush
+ * counting has stopped, which is when the state machine goes back to idle.
+ *
+ * pulses must have been counted over ms. The counts are compared against a
+ * DETECT_SAMPLE_MS idle average, so a sample over any other window (pulses
+ * counted while a report was being sent, say) is dropped, and nothing in the
+ * chain sees it.
+ */
+bool FlushChain_Sample(uint16_t pulses, uint16_t ms)
+{
+	if (ms != DETECT_SAMPLE_MS)
+	{
+		return false;
+	}
+	
+	uint16_t count = FlushChain_Compensate(pulses);
+
+	bool isFlushing = Filter_NewValue(count);
+
+	FlushChain_Sampled(isFlushing, Filter_IsDeviating(), Filter_GetIdleAverage(), ms);
+
+	bool countingStopped = Flush_UpdateCount(ms, isFlushing);
+
+	if (countingStopped)
+	{
+		FlushChain_Stopped();
+
+		if (Flush_SensorHasTriggered())
+		{
+			FlushChain_Flushed(Flush_GetOutflowSenseDurationMs());
+		}
+
+		Flush_Reset();
+	}
+
+	return countingStopped;
+}
+
+uint16_t FlushChain_Compensate(uint16_t pulses)
+{
+	// Compensation references the first temperatures it sees, so wait for real ones
+	if (!TS_HasReadings())
+	{
+		return pulses;
+	}
+
+	return TComp_Apply(pulses, TS_GetTemperature(SENSOR_OUTFLOW), TS_GetTemperature(SENSOR_AMBIENT));
+}
+
+/* After the filter, for every sample */
+void FlushChain_Sampled(bool isFlushing, bool isDeviating, uint16_t idleAverage, uint16_t ms)
+{
+	if (!isFlushing)
+	{
+		Baseline_AddSample(idleAverage);
+	}
+
+	Sampling_Result(isDeviating, ms);
+}
+
+/* For every sample taken while flush counting is stopped */
+void FlushChain_Stopped(void)
+{
+	// No flushing for a while, so this sample is a clean baseline to learn from
+	TComp_Learn();
+}
+
+/* For each completed flush, after FlushChain_Stopped */
+void FlushChain_Flushed(uint32_t durationMs)
+{
+	Summary_AddFlush(durationMs, RTC_GetMinuteOfDay());
+	Level_AddFlush(durationMs);
+
+	if (!Summary_IsEnabled())
+	{
+		// Queue the flush, the scheduler decides when it is sent
+		uint16_t durationSecs = (durationMs + (MS_PER_SECOND / 2U)) / MS_PER_SECOND;
+		TxSched_AddFlush(durationSecs, TS_GetTemperature(SENSOR_OUTFLOW));
+	}
+}
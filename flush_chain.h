@@ -0,0 +1,19 @@
+#ifndef _FLUSH_CHAIN_H_
+#define _FLUSH_CHAIN_H_
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Public Function Prototypes
+ */
+
+bool FlushChain_Sample(uint16_t pulses, uint16_t ms);
+
+uint16_t FlushChain_Compensate(uint16_t pulses);
+void FlushChain_Sampled(bool isFlushing, bool isDeviating, uint16_t idleAverage, uint16_t ms);
+void FlushChain_Stopped(void);
+void FlushChain_Flushed(uint32_t durationMs);
+
+#endif
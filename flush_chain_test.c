@@ -0,0 +1,334 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "detect_core.h"
+#include "tempsense.h"
+#include "tempcomp.h"
+#include "filter.h"
+#include "flush_counter.h"
+#include "summary.h"
+#include "pitlevel.h"
+#include "txsched.h"
+#include "rtc.h"
+#include "sampling.h"
+#include "baseline.h"
+#include "threshold.h"
+#include "flush_chain.h"
+#include "host_test.h"
+
+/*
+ * Runs the flush detection chain, as detectFlush does, around the samples the
+ * firmware takes while a report is being sent. Those are counted over the
+ * whole report, and must be dropped rather than let into the idle average,
+ * where one high sample holds the filter in flushing for good. Each case then
+ * puts a real flush through the chain and checks it is queued as it should be.
+ *
+ * Temperatures are not compensated: TS_HasReadings is false throughout.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SETTLE_S				(30L)
+#define FLUSH_S					(12L)
+#define FLUSH_BUCKET			(3U)		// 8-15s in the summary's duration histogram
+
+#define COMMS_TICK_MS			(120U)
+
+// WAKE, every retry at 240, 480 and 960ms, then a frame: the worst case
+#define REPORT_WINDOW_MS		(DETECT_SAMPLE_MS + 120U + 240U + 480U + 960U + 120U)
+
+#define SUMMARY_PERIOD_MINUTES	(60U)
+#define SUMMARY_FRAMES			(7U)
+#define FRAME_LENGTH			(9)
+
+#define BATCH_STAMP_FRAMES		(1U)		// The E frame ahead of the FB frames
+
+#define SECONDS_PER_HOUR		(3600L)
+#define BASELINE_FRAMES			(1U + BASELINE_HOURS)	// Start frame and every hour
+#define BASELINE_DELTA_SIGN		(0x800L)
+
+/*
+ * Private Function Prototypes
+ */
+
+static void testLongSample(void);
+static void testSummaryReport(void);
+static void testBatchedReport(void);
+static void testBaselineUpload(void);
+
+static void initChain(void);
+static bool feed(long seconds, bool flowing);
+static void feedHours(long hours);
+static uint8_t takeFlushes(uint16_t * pDurationSecs);
+static void dropReportSample(uint8_t frames);
+static void checkRealFlush(void);
+static uint16_t takeSummaryFlushes(uint8_t * pBucket);
+static long hexField(const char * msg, int digits);
+
+/*
+ * Private Variables
+ */
+
+static int failures = 0;
+
+int main(void)
+{
+	testLongSample();
+	testSummaryReport();
+	testBatchedReport();
+	testBaselineUpload();
+
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
+
+/*
+ * In place of tempsense.c, which needs the ADC
+ */
+
+TENTHSDEGC TS_GetTemperature(TEMPERATURE_SENSOR eSensor)
+{
+	(void)eSensor;
+	return 0;
+}
+
+bool TS_HasReadings(void)
+{
+	return false;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void testLongSample(void)
+{
+	initChain();
+	feed(SETTLE_S, false);
+
+	// The first idle tick after a report, counted over all of it
+	uint32_t pulses = ((uint32_t)Sim_Count(false) * REPORT_WINDOW_MS) / DETECT_SAMPLE_MS;
+	CHECK(!FlushChain_Sample((uint16_t)pulses, REPORT_WINDOW_MS));
+
+	CHECK(feed(SETTLE_S, false));
+	CHECK(labs((long)Filter_GetIdleAverage() - SIM_BASE_COUNT) <= SIM_NOISE_COUNTS);
+	CHECK(takeFlushes(NULL) == 0U);
+
+	checkRealFlush();
+}
+
+static void testSummaryReport(void)
+{
+	char msg[FRAME_LENGTH + 1] = {0};
+	uint8_t frames = 0U;
+
+	initChain();
+	Summary_SetPeriod(SUMMARY_PERIOD_MINUTES);
+	feed(SETTLE_S, false);
+
+	// A period with no flushes is still sent in full, as sendSummaryFrame does
+	while (Summary_WriteNextFrame(msg)) { frames++; }
+	CHECK(frames == SUMMARY_FRAMES);
+	dropReportSample(frames);
+
+	CHECK(feed(SETTLE_S, false));
+	CHECK(labs((long)Filter_GetIdleAverage() - SIM_BASE_COUNT) <= SIM_NOISE_COUNTS);
+
+	checkRealFlush();
+
+	Summary_SetPeriod(0U);
+}
+
+static void testBatchedReport(void)
+{
+	uint16_t durationSecs = 0U;
+
+	initChain();
+	feed(SETTLE_S, false);
+
+	// Fill the queue with real flushes, then send it as one batch: an E frame and an FB frame each
+	for (uint8_t i = 0U; i < TXSCHED_MAX_RECORDS; ++i)
+	{
+		CHECK(!feed(FLUSH_S, true));
+		CHECK(feed(SETTLE_S, false));
+	}
+
+	uint8_t records = takeFlushes(&durationSecs);
+	CHECK(records == TXSCHED_MAX_RECORDS);
+	CHECK(labs((long)durationSecs - FLUSH_S) <= 2L);
+	dropReportSample(BATCH_STAMP_FRAMES + records);
+
+	CHECK(feed(SETTLE_S, false));
+	CHECK(labs((long)Filter_GetIdleAverage() - SIM_BASE_COUNT) <= SIM_NOISE_COUNTS);
+
+	checkRealFlush();
+}
+
+static void testBaselineUpload(void)
+{
+	char msg[FRAME_LENGTH + 1] = {0};
+	uint8_t frames = 0U;
+
+	initChain();
+	feedHours(BASELINE_HOURS);
+
+	// The whole hourly ring, as sendBaselineFrame sends it
+	CHECK(Baseline_RequestUpload(BASELINE_RESOLUTION_HOURS, BASELINE_HOURS));
+	while (Baseline_WriteNextFrame(msg)) { frames++; }
+	CHECK(frames == BASELINE_FRAMES);
+	dropReportSample(frames);
+
+	// The hour after the upload follows on from the one before, with no step
+	feedHours(1L);
+	CHECK(Baseline_RequestUpload(BASELINE_RESOLUTION_HOURS, 2U));
+	while (Baseline_WriteNextFrame(msg)) { continue; }
+
+	long delta = hexField(&msg[2], 3);
+	if (delta >= BASELINE_DELTA_SIGN) { delta -= (2L * BASELINE_DELTA_SIGN); }
+
+	CHECK(labs(delta) <= SIM_NOISE_COUNTS);
+	CHECK(hexField(&msg[5], 2) <= SIM_NOISE_COUNTS);
+	CHECK(hexField(&msg[7], 2) <= SIM_NOISE_COUNTS);
+
+	checkRealFlush();
+}
+
+static void initChain(void)
+{
+	srand(1);
+
+	Threshold_Init();
+	TComp_Init();
+	Filter_Init();
+	Flush_Reset();
+	Summary_Init();
+	Level_Reset();
+	Level_Init();
+	TxSched_Init();
+	RTC_Init();
+	Sampling_Init(SAMPLING_DEFAULT_GATED_PERIOD);
+	Baseline_Init();
+}
+
+/* One second samples, returns what the chain returned for the last */
+static bool feed(long seconds, bool flowing)
+{
+	bool stopped = false;
+
+	for (long s = 0; s < seconds; ++s)
+	{
+		stopped = FlushChain_Sample(Sim_Count(flowing), DETECT_SAMPLE_MS);
+	}
+
+	return stopped;
+}
+
+/* Idle samples with the baseline history ticked alongside, as the main loop does */
+static void feedHours(long hours)
+{
+	for (long s = 0; s < (hours * SECONDS_PER_HOUR); ++s)
+	{
+		(void)FlushChain_Sample(Sim_Count(false), DETECT_SAMPLE_MS);
+		Baseline_Tick(DETECT_SAMPLE_MS);
+	}
+}
+
+/* Takes the flushes queued for sending, as sendFlushReport would */
+static uint8_t takeFlushes(uint16_t * pDurationSecs)
+{
+	TXSCHED_RECORD record;
+	uint16_t ageSecs;
+	uint8_t count = 0U;
+
+	while (TxSched_TakeRecord(&record, &ageSecs))
+	{
+		if (pDurationSecs) { *pDurationSecs = record.durationSecs; }
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * The first idle tick after a report of this many frames, one per comms tick
+ * after the WAKE, counted over all of it
+ */
+static void dropReportSample(uint8_t frames)
+{
+	uint16_t windowMs = DETECT_SAMPLE_MS + ((frames + 1U) * COMMS_TICK_MS);
+	uint32_t pulses = ((uint32_t)Sim_Count(false) * windowMs) / DETECT_SAMPLE_MS;
+
+	CHECK(!FlushChain_Sample((uint16_t)pulses, windowMs));
+}
+
+/*
+ * A flush after the report is detected and queued, or added to the summary,
+ * with about its real length
+ */
+static void checkRealFlush(void)
+{
+	uint16_t durationSecs = 0U;
+	uint8_t bucket = 0U;
+
+	CHECK(!feed(FLUSH_S, true));
+	CHECK(feed(SETTLE_S, false));
+
+	if (Summary_IsEnabled())
+	{
+		CHECK(takeFlushes(NULL) == 0U);
+		CHECK(takeSummaryFlushes(&bucket) == 1U);
+		CHECK(bucket == FLUSH_BUCKET);
+	}
+	else
+	{
+		CHECK(takeFlushes(&durationSecs) == 1U);
+		CHECK(labs((long)durationSecs - FLUSH_S) <= 2L);
+	}
+}
+
+/*
+ * Writes out the summary and returns the flushes in its duration histogram,
+ * setting pBucket to the last bucket with any
+ */
+static uint16_t takeSummaryFlushes(uint8_t * pBucket)
+{
+	char msg[FRAME_LENGTH + 1] = {0};
+	uint16_t flushes = 0U;
+
+	while (Summary_WriteNextFrame(msg))
+	{
+		if (msg[1] != 'D') { continue; }
+
+		for (uint8_t i = 0U; i < 2U; ++i)
+		{
+			long count = hexField(&msg[3 + (3 * i)], 3);
+
+			if (count > 0)
+			{
+				*pBucket = (uint8_t)(((msg[2] - '0') * 2) + i);
+				flushes += (uint16_t)count;
+			}
+		}
+	}
+
+	return flushes;
+}
+
+static long hexField(const char * msg, int digits)
+{
+	char field[5] = {0};
+	memcpy(field, msg, digits);
+	return strtol(field, NULL, 16);
+}
@@ -9,20 +9,14 @@
  * Local Application Includes
  */
 
+#include "detect_core.h"
 #include "flush_counter.h"
 
-/*
- * Defines and typedefs
- */
- 
-#define DETECTION_THRESHOLD_MS (1000U)
-#define DETECTION_DELAY_BEFORE_STOPPED_MS (10000U)
-
 /* 
  * Private Variables
  */
-static uint32_t totalFlushTimeMs = 0U;
-static int16_t	countFinishedTimeoutMs = 0U;
+
+static DETECT_FLUSH s_flush;
 
 /*
  * Public Function Defintions
@@ -30,33 +24,20 @@ static int16_t	countFinishedTimeoutMs = 0U;
 
 void Flush_Reset(void)
 {
-	totalFlushTimeMs = 0U;
-	countFinishedTimeoutMs = 0U;
+	Detect_FlushReset(&s_flush);
 }
 
 bool Flush_UpdateCount(uint16_t timeMs, bool detect)
 {
-	
-	if (detect)
-	{
-		countFinishedTimeoutMs = DETECTION_DELAY_BEFORE_STOPPED_MS;
-		totalFlushTimeMs += timeMs;
-	}
-	else
-	{
-		countFinishedTimeoutMs -= timeMs;
-	}
-
-	return (countFinishedTimeoutMs <= 0);
+	return Detect_FlushUpdate(&s_flush, timeMs, detect);
 }
 
 bool Flush_SensorHasTriggered(void)
 {
-	return (totalFlushTimeMs > DETECTION_THRESHOLD_MS);
+	return Detect_FlushTriggered(&s_flush);
 }
 
 uint32_t Flush_GetOutflowSenseDurationMs(void)
 {
-	return totalFlushTimeMs;
+	return Detect_FlushDurationMs(&s_flush);
 }
-
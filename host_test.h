@@ -0,0 +1,96 @@
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+/*
+ * Shared by the host tests and simulations: the assertion macro, and the
+ * synthetic pulse count trace that flush detection is tested against. Counts
+ * are one per second, idle at SIM_BASE_COUNT with uniform noise, and lower by
+ * SIM_FLOW_DROP_COUNTS while water flows. Detections are scored against the
+ * true flushes with Sim_Score.
+ *
+ * Include after stdlib.h, stdbool.h, stdint.h and stdio.h. CHECK counts into
+ * an int named failures, which the test defines.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define CHECK(x) do { if (!(x)) { printf("FAILED: %s (%s line %d)\n", #x, __FILE__, __LINE__); failures++; } } while (0)
+
+#define SIM_BASE_COUNT			(15000)
+#define SIM_NOISE_COUNTS		(60)
+#define SIM_FLOW_DROP_COUNTS	(1200)
+
+#define SIM_FLUSH_SETTLE_S		(30L)	// Idle time left after the last flush in a period
+
+struct sim_flush
+{
+	long start;		// First second with water flowing
+	long end;		// First second without
+};
+typedef struct sim_flush SIM_FLUSH;
+
+struct sim_score
+{
+	uint32_t detected;
+	uint32_t falseFlushes;
+	uint32_t splits;		// Second and later detections of one flush
+	long durationError;		// Sum of absolute errors, seconds
+};
+typedef struct sim_score SIM_SCORE;
+
+/*
+ * Public Function Definitions
+ */
+
+static inline int32_t Sim_Noise(void)
+{
+	return (rand() % ((2 * SIM_NOISE_COUNTS) + 1)) - SIM_NOISE_COUNTS;
+}
+
+static inline uint16_t Sim_Count(bool flowing)
+{
+	return (uint16_t)(SIM_BASE_COUNT + Sim_Noise() - (flowing ? SIM_FLOW_DROP_COUNTS : 0));
+}
+
+/*
+ * Plans one flush of minLength to maxLength seconds, starting at a random
+ * time in the period from periodStart.
+ */
+static inline void Sim_PlanFlush(SIM_FLUSH * pFlush, long periodStart, long period, long minLength, long maxLength)
+{
+	pFlush->start = periodStart + (rand() % (period - maxLength - SIM_FLUSH_SETTLE_S));
+	pFlush->end = pFlush->start + minLength + (rand() % (maxLength - minLength + 1));
+}
+
+/*
+ * Scores a detection from detectStart to detectEnd (seconds) against the
+ * first true flush it overlaps. matched has an entry per flush, zeroed before
+ * the run, so that a flush detected twice counts as split.
+ */
+static inline void Sim_Score(SIM_SCORE * pScore, const SIM_FLUSH * flushes, uint8_t * matched, long nFlushes,
+	long detectStart, long detectEnd, uint32_t durationMs)
+{
+	for (long f = 0; f < nFlushes; ++f)
+	{
+		if ((detectStart <= flushes[f].end) && (detectEnd >= flushes[f].start))
+		{
+			if (matched[f])
+			{
+				pScore->splits++;
+			}
+			else
+			{
+				matched[f] = 1;
+				pScore->detected++;
+				pScore->durationError += labs((long)((durationMs + 500U) / 1000U) - (flushes[f].end - flushes[f].start));
+			}
+			return;
+		}
+	}
+
+	pScore->falseFlushes++;
+}
+
+#endif
@@ -14,6 +14,7 @@
 #include <avr/sleep.h>
 #include <avr/interrupt.h>
 #include <avr/eeprom.h>
+#include <util/atomic.h>
 
 /*
  * AVR Library Includes
@@ -33,7 +34,9 @@
  */
 
 #include "statemachine.h"
-#include "statemachinemanager.h" 
+#ifdef SM_GENERIC
+#include "statemachinemanager.h"
+#endif
 
 /*
  * Local Application Includes
@@ -45,40 +48,43 @@
 #include "filter.h"
 #include "threshold.h"
 #include "comms.h"
+#include "memcheck.h"
+#include "capture.h"
+#include "summary.h"
+#include "tempcomp.h"
+#include "pitlevel.h"
+#include "txsched.h"
+#include "rtc.h"
+#include "sampling.h"
+#include "evqueue.h"
+#include "baseline.h"
+#include "flush_chain.h"
+#include "latrinesensor_sm.h"
+
+#ifdef AVR_BENCH
+#include "avr_bench.h"
+#endif
 
 /*
  * Defines and typedefs
  */
 
-enum states
-{
-	IDLE,
-	SENDING1,
-	SENDING2,
-	SENDING3,
-	LEVEL_TEST,
-	MAX_STATES
-};
-typedef enum states STATES;
-
-enum events
-{
-	TIMER,
-	TEST_LEVEL,
-	COMPLETE,
-	DETECT,
-	NO_DETECT,
-	PIT_FULL,
-	PIT_NOT_FULL,
-	SEND_COMPLETE,
-	MAX_EVENTS
-};
-typedef enum events EVENTS;
-
 // Make sure these defines are kept in sync or bad things will happen.
 #define IDLE_TICK_MS	(1000)
 #define COMMS_TICK_MS	(120)
 
+// After WAKE, wait up to COMMS_TICK_MS for the master to reply, doubling the
+// wait on each retry
+#define WAKE_RETRIES	(3)
+
+// Flushes older than this are sent as FB, with their own outflow temperature
+// and age, rather than as FE with the temperatures now
+#define FRESH_FLUSH_SECS	(60U)
+
+// Wakes by the pulse interrupt alone go back to sleep without polling the
+// library's flags, up to this many in a row (about 1ms of pulses)
+#define PULSE_WAKES_PER_POLL	(16U)
+
 #define OUTFLOW_PCINT_VECTOR		PCINT2_vect
 #define OUTFLOW_PCINT_NUMBER		18
 
@@ -103,6 +109,10 @@ typedef enum events EVENTS;
 #define	SETUP_PIN0			0
 #define	SETUP_PIN1			1
 
+// The reset input holds the detect oscillator stopped while low
+#define DETECT_CIRCUIT_ON			IO_On(DETECT_CIRCUIT_RESET_PORT, DETECT_CIRCUIT_RESET_PIN)
+#define DETECT_CIRCUIT_OFF			IO_Off(DETECT_CIRCUIT_RESET_PORT, DETECT_CIRCUIT_RESET_PIN)
+
 #define TEST_LED_ON					IO_On(GENERIC_OUTPUT_PORT, GENERIC_OUTPUT_PIN)
 #define TEST_LED_OFF				IO_Off(GENERIC_OUTPUT_PORT, GENERIC_OUTPUT_PIN)
 #define	TEST_LED_TOGGLE				IO_Toggle(GENERIC_OUTPUT_PINS, GENERIC_OUTPUT_PIN)
@@ -112,10 +122,29 @@ typedef enum events EVENTS;
 enum test_mode_enum
 {
 	TEST_MODE_NONE,
-	TEST_MODE_STATE
+	TEST_MODE_STATE,
+	TEST_MODE_CAPTURE
 };
 typedef enum test_mode_enum TEST_MODE_ENUM;
 
+// Events from interrupts to the main loop, through evqueue.c
+enum irq_event
+{
+	IRQ_EVENT_CONVERSION,
+	IRQ_EVENT_UART_RX,
+	IRQ_EVENT_TICK			// Data is the tick length in ms
+};
+typedef enum irq_event IRQ_EVENT;
+
+enum report_enum
+{
+	REPORT_FLUSH,
+	REPORT_SUMMARY,
+	REPORT_LEVEL,
+	REPORT_BASELINE
+};
+typedef enum report_enum REPORT_ENUM;
+
 /*
  * Private Function Prototypes
  */
@@ -123,58 +152,103 @@ typedef enum test_mode_enum TEST_MODE_ENUM;
 static void setupTimers(void);
 static void setupIO(void);
 
-static void writeTemperatureToMessage(char * msg, TEMPERATURE_SENSOR eSensor);
+static void writeTemperatureToMessage(char * msg, TENTHSDEGC temp);
+static void writeDurationToMessage(char * msg, uint16_t durationSecs);
+static void writeHexToMessage(char * msg, uint32_t value, uint8_t digits);
+static void writeBatchFrame(char * message, const TXSCHED_RECORD * pRecord, uint16_t ageSecs);
+static bool sendFlushReport(void);
+static bool sendSummaryFrame(void);
+static bool sendLevelReport(void);
+static bool sendBaselineFrame(void);
 
 static void runNormalApplication(void);
+static void runCaptureApplication(void);
+
+static void waitForEvents(void);
+static bool pollLibraryEvents(void);
+static void postLibraryEvents(bool rx);
+static void handleEvent(const EVQ_EVENT * pEvent);
+
+static uint16_t takePulseCount(void);
+static void detectFlush(uint16_t pulses, uint16_t windowMs);
 
 static void readTestMode(void);
 
-static int8_t setupStateMachine(void);
+static void setupStateMachine(void);
 
 static void onIdleState(SM_STATEID old, SM_STATEID new, SM_EVENT e);
 static void wakeMaster(SM_STATEID old, SM_STATEID new, SM_EVENT e);
 static void startWakeTimer(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void retryWake(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void abandonReport(SM_STATEID old, SM_STATEID new, SM_EVENT e);
 static void sendData(SM_STATEID old, SM_STATEID new, SM_EVENT e);
 static void testAndResetCount(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void testLevel(SM_STATEID old, SM_STATEID new, SM_EVENT e);
 
 #ifdef TEST_HARNESS
 static void onStateChange(SM_STATEID old, SM_STATEID new, SM_EVENT e);
 #else
-#define onStateChange NULL
+#define onStateChange SM_NO_ACTION
 #endif
 
 /*
- * Main state machine pointers
+ * Main state machine, described in latrinesensor_sm.h. By default this builds
+ * the switch dispatcher from sm_dispatch.h; define SM_GENERIC to build the
+ * table for the generic statemachine runtime instead.
  */
 
-static const SM_STATE stateIdle = {IDLE, NULL, onIdleState};
-static const SM_STATE stateSending1 = {SENDING1, NULL, onStateChange};
-static const SM_STATE stateSending2 = {SENDING2, NULL, onStateChange};
-static const SM_STATE stateSending3 = {SENDING3, NULL, onStateChange};
-static const SM_STATE stateLevelTest = {LEVEL_TEST, NULL, onStateChange};
+#ifdef SM_GENERIC
 
-static const SM_ENTRY sm[] = {
-	{&stateIdle,		DETECT,			wakeMaster,		&stateSending1	},
-	{&stateIdle,		TIMER,			testAndResetCount,	&stateIdle	},
+#define SM_NO_ACTION NULL
 
-	{&stateSending1,	SEND_COMPLETE,	startWakeTimer,	&stateSending2	},
-	{&stateSending2,	TIMER,			sendData,		&stateSending3	},
-	{&stateSending3,	SEND_COMPLETE,	NULL,			&stateIdle		},
-	
+#define GENERIC_STATE(s, fn) [s] = {s, NULL, fn},
+#define GENERIC_ENTRY(s, e, fn, n) {&smStates[s], e, fn, &smStates[n]},
+
+static const SM_STATE smStates[] = {
+	LATRINESENSOR_STATES(GENERIC_STATE)
+};
+
+static const SM_ENTRY sm[] = {
+	LATRINESENSOR_TRANSITIONS(GENERIC_ENTRY)
 	{NULL,				(STATES)0,		NULL,			NULL}
 };
 
+static int8_t smIndex;
+
+#define smEvent(e) SM_Event(smIndex, e)
+#define smGetState() SM_GetState(smIndex)
+
+#else
+
+#define SM_DISPATCH_STATES			LATRINESENSOR_STATES
+#define SM_DISPATCH_TRANSITIONS		LATRINESENSOR_TRANSITIONS
+#define SM_DISPATCH_INITIAL_STATE	LATRINESENSOR_INITIAL_STATE
+#define SM_DISPATCH_NUMBER_OF_STATES	MAX_STATES
+#define SM_DISPATCH_NUMBER_OF_EVENTS	MAX_EVENTS
+#define SM_DISPATCH_MAX_QUEUED		LATRINESENSOR_MAX_QUEUED_EVENTS
+#include "sm_dispatch.h"
+
+#define smEvent(e) SMD_Event(e)
+#define smGetState() SMD_GetState()
+
+#endif
+
 /* 
  * Private Variables
  */
 
-static int8_t smIndex;
-
 static TMR8_TICK_CONFIG applicationTick;
 
 static TEST_MODE_ENUM testMode;
 
+static REPORT_ENUM s_report;
+static bool s_batchReport;
+static bool s_stampPending;
+
+static uint8_t s_wakeRetries;
+
 static volatile uint16_t s_flushPulseCount;
+static uint16_t s_pulseWindowMs;	// Ticked time since the count was taken, UINT16_MAX if unknown
 
 int main(void)
 {
@@ -182,22 +256,52 @@ int main(void)
 	
 	WD_DISABLE();
 	
+	MemCheck_Init();
+	
 	setupIO();
 	readTestMode();
 		
 	setupTimers();
 	
-	smIndex = setupStateMachine();
+	setupStateMachine();
 	
 	TS_Setup();
 	
 	Threshold_Init();
 	
+	Summary_Init();
+	
+	TComp_Init();
+	
+	Level_Init();
+	
+	TxSched_Init();
+	
+	RTC_Init();
+	
+	Baseline_Init();
+	
 	Filter_Init();
 	
+	Sampling_Init(SAMPLING_DEFAULT_GATED_PERIOD);
+	
 	Flush_Reset();
-		
+	
+	EVQ_Init();
+	
+	if (testMode == TEST_MODE_CAPTURE)
+	{
+		CAPTURE_Init();
+		sei();
+		runCaptureApplication();
+	}
+	
 	COMMS_Init();
+	
+#ifdef AVR_BENCH
+	// Everything is set up as for the application, which the benchmark replaces
+	Bench_Run();
+#endif
 		
 	sei();
 	
@@ -220,48 +324,267 @@ void APP_HandleNewThresholdSetting(const char * msg)
 	}
 }
 
+void APP_HandleNewLatencyBudget(const char * msg)
+{
+	// A budget of zero sends every flush as soon as it is complete
+	TxSched_SetBudget((uint16_t)atol(msg));
+}
+
+void APP_HandleTimeSync(const char * msg)
+{
+	// Exactly eight hex digits of seconds since 1970
+	char * end;
+	uint32_t epochSecs = strtoul(msg, &end, 16);
+	
+	if ((end - msg) == 8)
+	{
+		RTC_Sync(epochSecs);
+	}
+}
+
+void APP_HandleNewPitCapacity(const char * msg)
+{
+	Level_SetCapacity((uint16_t)atol(msg));
+}
+
+void APP_HandleNewFlowRate(const char * msg)
+{
+	uint16_t newFlowRate = (uint16_t)atol(msg);
+	
+	if (newFlowRate > 0)
+	{
+		Level_SetFlowRate(newFlowRate);
+	}
+}
+
+void APP_HandlePitEmptied(void)
+{
+	Level_Reset();
+}
+
+void APP_HandleBaselineRequest(const char * msg)
+{
+	// "H" or "D" and the number of buckets, none for the whole ring
+	(void)Baseline_RequestUpload(msg[0], (uint8_t)atoi(&msg[1]));
+}
+
+void APP_HandleMasterReply(void)
+{
+	// Only has an effect while waiting in SENDING2 for the master to wake
+	smEvent(MASTER_READY);
+}
+
+void APP_HandleNewReportPeriod(const char * msg)
+{
+	// A period of zero minutes goes back to reporting every flush
+	Summary_SetPeriod((uint16_t)atol(msg));
+}
+
+#ifdef AVR_BENCH
+void APP_BenchWriteBatchFrame(char * message, uint16_t durationSecs, int16_t outflow, uint16_t ageSecs)
+{
+	TXSCHED_RECORD record = { durationSecs, 0U, outflow };
+	writeBatchFrame(message, &record, ageSecs);
+}
+
+bool APP_BenchPollLibraryEvents(void)
+{
+	return pollLibraryEvents();
+}
+#endif
+
 static void runNormalApplication(void)
 {
+	EVQ_EVENT event;
+	
+#ifndef TEST_HARNESS
+	// Timers, UART and ADC all run in idle sleep
+	set_sleep_mode(SLEEP_MODE_IDLE);
+#endif
+	
 	while (true)
 	{
+		DO_TEST_HARNESS_RUNNING();
+		
+		waitForEvents();
+		
+		// Events are handled in the order the interrupts posted them
+		while (EVQ_Take(&event))
+		{
+			handleEvent(&event);
+		}
+		
+		if ( TS_IsTimeForOutflowRead() )
+		{
+			TS_StartConversion(SENSOR_OUTFLOW);
+		}
+		else if ( TS_IsTimeForAmbientRead() )
 		{
-			DO_TEST_HARNESS_RUNNING();
+			TS_StartConversion(SENSOR_AMBIENT);
+		}
 
-			TS_Check();
+		if (testMode == TEST_MODE_STATE)
+		{
+			uint8_t state = (uint8_t)smGetState() + 1;
 			
-			if (TMR8_Tick_TestAndClear(&applicationTick))
-			{
-				TS_AmbientTimerTick(applicationTick.reload);
-				SM_Event(smIndex, TIMER);
-			}
-					
-			if ( TS_IsTimeForOutflowRead() )
+			while(state--)
 			{
-				TS_StartConversion(SENSOR_OUTFLOW);
-			}
-			else if ( TS_IsTimeForAmbientRead() )
-			{
-				TS_StartConversion(SENSOR_AMBIENT);
+				TEST_LED_OFF;
+				TEST_LED_ON;
+				TEST_LED_OFF;
 			}
+		}
+		
+		MemCheck_Task();
+	}
+}
 
-			if (testMode == TEST_MODE_STATE)
-			{
-				uint8_t state = (uint8_t)SM_GetState(smIndex) + 1;
-				
-				while(state--)
-				{
-					TEST_LED_OFF;
-					TEST_LED_ON;
-					TEST_LED_OFF;
-				}
-			}
+/*
+ * Returns once there is at least one event queued, sleeping until then.
+ * Interrupts are disabled from the last check of the queue until sleep_cpu,
+ * and the instruction after sei always runs before any interrupt, so an
+ * interrupt that arrives after the check still wakes the CPU.
+ *
+ * Every interrupt wakes the CPU. While the detect circuit is on, the pulse
+ * interrupt is most of them, about 15000 a second, and it only counts, so a
+ * wake where the count is all that changed goes straight back to sleep.
+ * Interrupts are disabled by the first instruction after sleep_cpu, which
+ * always runs before another interrupt is taken, so only the interrupt that
+ * woke the CPU has run. Any other left pending wakes it again as soon as it
+ * sleeps, leaving the count as it was, and the flags are polled then. The
+ * limit covers a pulse pending at every one of those wakes.
+ */
+static void waitForEvents(void)
+{
+#ifdef TEST_HARNESS
+	// The harness drives time from the main loop, so never wait here
+	(void)pollLibraryEvents();
+#else
+	uint8_t pulseWakes = 0U;
+	
+	while (!pollLibraryEvents())
+	{
+		uint16_t pulses;
+		
+		do
+		{
+			pulses = s_flushPulseCount;
+			sleep_enable();
+			sei();
+			sleep_cpu();
+			cli();
+			sleep_disable();
+		} while ((s_flushPulseCount != pulses) && (++pulseWakes < PULSE_WAKES_PER_POLL));
+		
+		pulseWakes = 0U;
+		sei();
+	}
+#endif
+	
+	sei();
+}
+
+/*
+ * One pass over the library's flags, which returns with interrupts disabled
+ * and true if there are events queued.
+ *
+ * UART0_Task is library code that services the UART, so it is not called
+ * with interrupts disabled. A character that arrives after it and before
+ * sleep_cpu is not seen until the next poll: within PULSE_WAKES_PER_POLL
+ * pulses while the detect circuit is on, otherwise the next timer interrupt.
+ */
+static bool pollLibraryEvents(void)
+{
+	bool rx = COMMS_TakeRx();
+	
+	cli();
+	postLibraryEvents(rx);
+	
+	return !EVQ_IsEmpty();
+}
+
+/*
+ * The timer tick, ADC and UART interrupts are in the AVR library, and set
+ * flags rather than posting. Their flags are turned into events here, with
+ * interrupts disabled, which makes this part of the queue's producer side.
+ */
+static void postLibraryEvents(bool rx)
+{
+	if (TS_TakeConversion())
+	{
+		(void)EVQ_Post(IRQ_EVENT_CONVERSION, 0U);
+	}
+	
+	if (rx)
+	{
+		(void)EVQ_Post(IRQ_EVENT_UART_RX, 0U);
+	}
+	
+	if (TMR8_Tick_TestAndClear(&applicationTick))
+	{
+		(void)EVQ_Post(IRQ_EVENT_TICK, applicationTick.reload);
+	}
+}
+
+static void handleEvent(const EVQ_EVENT * pEvent)
+{
+	switch (pEvent->type)
+	{
+	case IRQ_EVENT_CONVERSION:
+		TS_HandleConversion();
+		break;
+		
+	case IRQ_EVENT_UART_RX:
+		COMMS_HandleRx();
+		break;
+		
+	case IRQ_EVENT_TICK:
+		s_pulseWindowMs = (s_pulseWindowMs > (UINT16_MAX - pEvent->data)) ? UINT16_MAX : (s_pulseWindowMs + pEvent->data);
+		TS_TimerTick(pEvent->data);
+		TxSched_Tick(pEvent->data);
+		RTC_Tick(pEvent->data);
+		Baseline_Tick(pEvent->data);
+		smEvent(TIMER);
+		break;
+		
+	default:
+		break;
+	}
+}
+
+static void runCaptureApplication(void)
+{
+	TEMPERATURE_SENSOR eNextSensor = SENSOR_OUTFLOW;
+	
+	TMR8_Tick_SetNewReloadValue(&applicationTick, CAPTURE_TICK_MS);
+	
+	while (true)
+	{
+		DO_TEST_HARNESS_RUNNING();
+		
+		TS_Check();
+		
+		if (TMR8_Tick_TestAndClear(&applicationTick))
+		{
+			CAPTURE_SendFrame(
+				takePulseCount(),
+				TS_GetRawReading(SENSOR_OUTFLOW),
+				TS_GetRawReading(SENSOR_AMBIENT)
+			);
+			
+			// Alternate the sensors so both readings stay fresh
+			TS_StartConversion(eNextSensor);
+			eNextSensor = (eNextSensor == SENSOR_OUTFLOW) ? SENSOR_AMBIENT : SENSOR_OUTFLOW;
 		}
+		
+		MemCheck_Task();
 	}
 }
 
 static void setupIO(void)
 {
 	IO_SetMode(eDETECT_CIRCUIT_RESET_PORT, DETECT_CIRCUIT_RESET_PIN, IO_MODE_OUTPUT);
+	DETECT_CIRCUIT_ON;
 	IO_SetMode(eGENERIC_OUTPUT_PORT, GENERIC_OUTPUT_PIN, IO_MODE_OUTPUT);
 	
 	IO_SetMode(eSETUP_PORT, SETUP_PIN0, IO_MODE_INPUT);
@@ -296,16 +619,98 @@ static void testAndResetCount(SM_STATEID old, SM_STATEID new, SM_EVENT e)
 {
 	(void)old; (void)new; (void)e;
 	
-	bool isFlushing = Filter_NewValue(s_flushPulseCount);
-	s_flushPulseCount = 0;
+	uint16_t windowMs = s_pulseWindowMs;
+	uint16_t pulses = takePulseCount();
+	
+	// Counts from ticks when the detect circuit was off are discarded
+	if (Sampling_Tick())
+	{
+		detectFlush(pulses, windowMs);
+	}
+	
+	if (Sampling_IsCircuitOn())
+	{
+		DETECT_CIRCUIT_ON;
+	}
+	else
+	{
+		DETECT_CIRCUIT_OFF;
+	}
+	
+	bool reportStarted = false;
+	
+	Level_Tick(IDLE_TICK_MS, TS_GetTemperature(SENSOR_OUTFLOW));
+	
+	if (Summary_Tick(IDLE_TICK_MS))
+	{
+		s_report = REPORT_SUMMARY;
+		smEvent(REPORT_DUE);
+		reportStarted = true;
+	}
+	else if (TxSched_IsDue())
+	{
+		// Stays due until sent, so a summary report going first only delays it
+		s_report = REPORT_FLUSH;
+		s_batchReport = (TxSched_Pending() > 1U) || (TxSched_GetOldestAgeSecs() >= FRESH_FLUSH_SECS);
+		s_stampPending = s_batchReport && RTC_IsSet();
+		smEvent(DETECT);
+		reportStarted = true;
+	}
+	else if (Baseline_IsUploadDue())
+	{
+		s_report = REPORT_BASELINE;
+		smEvent(REPORT_DUE);
+		reportStarted = true;
+	}
+	
+	if (!reportStarted && Level_IsCheckDue())
+	{
+		// Otherwise the check waits for the next idle tick
+		smEvent(TEST_LEVEL);
+	}
+}
+
+/* A count over anything but one whole idle tick is dropped by the chain */
+static void detectFlush(uint16_t pulses, uint16_t windowMs)
+{
+	if (FlushChain_Sample(pulses, windowMs))
+	{
+		smEvent(NO_DETECT);
+	}
+}
+
+static uint16_t takePulseCount(void)
+{
+	uint16_t count;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		count = s_flushPulseCount;
+		s_flushPulseCount = 0;
+	}
+	
+	s_pulseWindowMs = 0U;
 	
-	bool countingStopped = Flush_UpdateCount(IDLE_TICK_MS, isFlushing);
+	return count;
+}
+
+static void testLevel(SM_STATEID old, SM_STATEID new, SM_EVENT e)
+{
+	(void)old; (void)new; (void)e;
 	
-	if (countingStopped)
+	switch (Level_Check())
 	{
-		// Nothing was detected this time, so send a detect/no detect event 
-		// final result to the state machine
-		SM_Event(smIndex, Flush_SensorHasTriggered() ? DETECT: NO_DETECT);
+	case LEVEL_REPORT_FULL:
+		s_report = REPORT_LEVEL;
+		smEvent(PIT_FULL);
+		break;
+	case LEVEL_REPORT_NOT_FULL:
+		s_report = REPORT_LEVEL;
+		smEvent(PIT_NOT_FULL);
+		break;
+	default:
+		smEvent(COMPLETE);
+		break;
 	}
 }
 
@@ -313,54 +718,207 @@ static void wakeMaster(SM_STATEID old, SM_STATEID new, SM_EVENT e)
 {
 	(void)old; (void)new; (void)e;
 	COMMS_Send("WAKE");
-	SM_Event(smIndex, SEND_COMPLETE);
+	smEvent(SEND_COMPLETE);
 }
 
 static void startWakeTimer(SM_STATEID old, SM_STATEID new, SM_EVENT e)
 {
 	(void)old; (void)new; (void)e;
+	s_wakeRetries = 0;
 	TMR8_Tick_SetNewReloadValue(&applicationTick, COMMS_TICK_MS);
 }
 
-static void sendData(SM_STATEID old, SM_STATEID new, SM_EVENT e)
+static void retryWake(SM_STATEID old, SM_STATEID new, SM_EVENT e)
+{
+	(void)old; (void)new; (void)e;
+	
+	if (s_wakeRetries == WAKE_RETRIES)
+	{
+		smEvent(WAKE_TIMEOUT);
+		return;
+	}
+	
+	s_wakeRetries++;
+	COMMS_Send("WAKE");
+	TMR8_Tick_SetNewReloadValue(&applicationTick, COMMS_TICK_MS << s_wakeRetries);
+}
+
+static void abandonReport(SM_STATEID old, SM_STATEID new, SM_EVENT e)
 {
 	(void)old; (void)new; (void)e;
 	
-	uint32_t detectDurationSecs = (Flush_GetOutflowSenseDurationMs() + 500U) / 1000U;
+	// The master is not listening. Queued flushes are kept and retried later;
+	// a summary carries over to the next period and a level report stays
+	// pending until the next level check. A baseline upload is dropped, since
+	// the master asks for it again if it still wants it.
+	if (s_report == REPORT_FLUSH)
+	{
+		TxSched_Retry();
+	}
+	else if (s_report == REPORT_BASELINE)
+	{
+		Baseline_CancelUpload();
+	}
+}
+
+static void sendData(SM_STATEID old, SM_STATEID new, SM_EVENT e)
+{
+	(void)new; (void)e;
+	
+	if (old == SENDING2)
+	{
+		// The master answered, so frames go at the comms tick, not the last WAKE backoff
+		TMR8_Tick_SetNewReloadValue(&applicationTick, COMMS_TICK_MS);
+	}
+	
+	bool complete;
+	
+	switch (s_report)
+	{
+	case REPORT_SUMMARY:
+		complete = sendSummaryFrame();
+		break;
+	case REPORT_LEVEL:
+		complete = sendLevelReport();
+		break;
+	case REPORT_BASELINE:
+		complete = sendBaselineFrame();
+		break;
+	default:
+		complete = sendFlushReport();
+		break;
+	}
+	
+	// Multi-frame reports stay in SENDING3 and send the next frame on the next tick
+	if (complete)
+	{
+		smEvent(SEND_COMPLETE);
+	}
+}
+
+static bool sendFlushReport(void)
+{
+	TXSCHED_RECORD record;
+	uint16_t ageSecs;
 	
-	char message[] = "aAAFEOOAADDD";
+	if (s_stampPending)
+	{
+		// A batch starts with the sensor's time, which the ages in FB frames count back from
+		char message[] = "aAAE00000000";
+		writeHexToMessage(&message[4], RTC_GetEpoch(), 8);
+		COMMS_Send(message);
+		
+		s_stampPending = false;
+		return false;
+	}
 	
-	writeTemperatureToMessage(&message[5], SENSOR_OUTFLOW);
-	writeTemperatureToMessage(&message[7], SENSOR_AMBIENT);
+	if (!TxSched_TakeRecord(&record, &ageSecs))
+	{
+		return true;
+	}
 	
-	// uint8_t duration to string conversion:
-	if (detectDurationSecs < 999)
+	if (s_batchReport)
 	{
-		message[9] = detectDurationSecs / 100U;
-		detectDurationSecs -= (message[9] * 100U);
-		message[10] = detectDurationSecs / 10U;
-		detectDurationSecs -= (message[10] * 10U);
-		message[11] = detectDurationSecs;
+		char message[] = "aAAFBOOaaDDD";
 		
-		message[9] += '0';
-		message[10] += '0';
-		message[11] += '0';
+		writeBatchFrame(message, &record, ageSecs);
+		COMMS_Send(message);
 	}
 	else
 	{
-		message[9] = '?';
-		message[10] = '?';
-		message[11] = '?';
+		char message[] = "aAAFEOOAADDD";
+		
+		writeTemperatureToMessage(&message[5], TS_GetTemperature(SENSOR_OUTFLOW));
+		writeTemperatureToMessage(&message[7], TS_GetTemperature(SENSOR_AMBIENT));
+		writeDurationToMessage(&message[9], record.durationSecs);
+		
+		COMMS_Send(message);
+	}
+	
+	return (TxSched_Pending() == 0U);
+}
+
+static bool sendSummaryFrame(void)
+{
+	char message[] = "aAAHDN000000";
+	
+	if (Summary_WriteNextFrame(&message[3]))
+	{
+		COMMS_Send(message);
+		return false;
 	}
 	
+	return true;
+}
+
+static bool sendLevelReport(void)
+{
+	char message[] = "aAALVNC000--";
+	
+	Level_WriteReport(&message[3]);
 	COMMS_Send(message);
-	SM_Event(smIndex, SEND_COMPLETE);
+	
+	return true;
 }
 
-static void writeTemperatureToMessage(char * msg, TEMPERATURE_SENSOR eSensor)
+static bool sendBaselineFrame(void)
 {
-	TENTHSDEGC temp = TS_GetTemperature(eSensor);
+	char message[] = "aAABH0000000";
+	
+	if (Baseline_WriteNextFrame(&message[3]))
+	{
+		COMMS_Send(message);
+		return false;
+	}
+	
+	return true;
+}
+
+/* One frame per queued flush: outflow temperature when it finished, age in minutes (hex), duration */
+static void writeBatchFrame(char * message, const TXSCHED_RECORD * pRecord, uint16_t ageSecs)
+{
+	uint16_t ageMinutes = ageSecs / 60U;
+	
+	if (ageMinutes > 0xFFU) { ageMinutes = 0xFFU; }
 	
+	writeTemperatureToMessage(&message[5], pRecord->outflow);
+	writeHexToMessage(&message[7], ageMinutes, 2);
+	writeDurationToMessage(&message[9], pRecord->durationSecs);
+}
+
+static void writeDurationToMessage(char * msg, uint16_t durationSecs)
+{
+	if (durationSecs < 999)
+	{
+		msg[0] = durationSecs / 100U;
+		durationSecs -= (msg[0] * 100U);
+		msg[1] = durationSecs / 10U;
+		durationSecs -= (msg[1] * 10U);
+		msg[2] = durationSecs;
+		
+		msg[0] += '0';
+		msg[1] += '0';
+		msg[2] += '0';
+	}
+	else
+	{
+		msg[0] = '?';
+		msg[1] = '?';
+		msg[2] = '?';
+	}
+}
+
+static void writeHexToMessage(char * msg, uint32_t value, uint8_t digits)
+{
+	while (digits--)
+	{
+		msg[digits] = "0123456789ABCDEF"[value & 0x0FU];
+		value >>= 4;
+	}
+}
+
+static void writeTemperatureToMessage(char * msg, TENTHSDEGC temp)
+{
 	if (temp > 0)
 	{
 		temp = (temp + 5) / 10; // Only care about integer degrees
@@ -390,34 +948,50 @@ static void writeTemperatureToMessage(char * msg, TEMPERATURE_SENSOR eSensor)
 static void onIdleState(SM_STATEID old, SM_STATEID new, SM_EVENT e)
 {
 	(void)old; (void)new; (void)e;
+	
+	if (applicationTick.reload != IDLE_TICK_MS)
+	{
+		// Back from a report. The pulses counted while it was sent are not a
+		// sample, and the first idle tick may end part way through a comms
+		// tick, so its count is dropped too.
+		(void)takePulseCount();
+		s_pulseWindowMs = UINT16_MAX;
+	}
+	
 	TMR8_Tick_SetNewReloadValue(&applicationTick, IDLE_TICK_MS);
 }
 
-static int8_t setupStateMachine(void)
+static void setupStateMachine(void)
 {
-	int8_t smIndex= -1;
-	
+#ifdef SM_GENERIC
 	SMM_Config(1, 5);
-	smIndex = SM_Init(&stateIdle, MAX_EVENTS, MAX_STATES, sm);
+	smIndex = SM_Init(&smStates[IDLE], MAX_EVENTS, MAX_STATES, sm);
 	
 	if (smIndex >= 0)
 	{
 		SM_SetActive(smIndex, true);
 	}
-
-	return smIndex;
+#else
+	SMD_Init();
+#endif
 }
 
 #ifdef TEST_HARNESS
 static void onStateChange(SM_STATEID old, SM_STATEID new, SM_EVENT e)
 {
-	char * states[] = { "IDLE", "COUNTING", "SENDING", "LEVEL_TEST"};
-	char * events[] = { "TIMER", "TEST_LEVEL", "COMPLETE", "DETECT", "NO_DETECT", "PIT_FULL", "PIT_NOT_FULL", "SEND_COMPLETE"};
+	char * states[] = { "IDLE", "SENDING1", "SENDING2", "SENDING3", "LEVEL_TEST"};
+	char * events[] = { "TIMER", "TEST_LEVEL", "COMPLETE", "DETECT", "NO_DETECT", "PIT_FULL", "PIT_NOT_FULL", "SEND_COMPLETE", "REPORT_DUE", "MASTER_READY", "WAKE_TIMEOUT"};
 
 	printf("Entering state %s from %s with event %s\n", states[new], states[old], events[e]);
 }
 #endif
 
+/*
+ * Counts only: an event per pulse would fill the event queue. The count is
+ * taken on the tick event. The pulse still wakes the CPU, which sees only the
+ * count has changed and goes back to sleep without polling the library's
+ * flags (see waitForEvents).
+ */
 ISR(OUTFLOW_PCINT_VECTOR)
 {
 	s_flushPulseCount++;
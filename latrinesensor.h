@@ -2,5 +2,13 @@
 #define _LATRINE_SENSOR_H_
 
 void APP_HandleNewThresholdSetting(const char * msg);
+void APP_HandleNewReportPeriod(const char * msg);
+void APP_HandleNewLatencyBudget(const char * msg);
+void APP_HandleTimeSync(const char * msg);
+void APP_HandleNewPitCapacity(const char * msg);
+void APP_HandleNewFlowRate(const char * msg);
+void APP_HandlePitEmptied(void);
+void APP_HandleBaselineRequest(const char * msg);
+void APP_HandleMasterReply(void);
 
 #endif
@@ -0,0 +1,85 @@
+#ifndef _LATRINESENSOR_SM_H_
+#define _LATRINESENSOR_SM_H_
+
+/*
+ * Application state machine, written once as X-macro tables so that the same
+ * description can build either the generic SM_ENTRY table or the switch
+ * dispatcher generated by sm_dispatch.h.
+ *
+ * The including file must declare every action named here.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+enum states
+{
+	IDLE,
+	SENDING1,
+	SENDING2,
+	SENDING3,
+	LEVEL_TEST,
+	MAX_STATES
+};
+typedef enum states STATES;
+
+enum events
+{
+	TIMER,
+	TEST_LEVEL,
+	COMPLETE,
+	DETECT,
+	NO_DETECT,
+	PIT_FULL,
+	PIT_NOT_FULL,
+	SEND_COMPLETE,
+	REPORT_DUE,
+	MASTER_READY,
+	WAKE_TIMEOUT,
+	MAX_EVENTS
+};
+typedef enum events EVENTS;
+
+#define LATRINESENSOR_INITIAL_STATE	IDLE
+
+/*
+ * The most events actions ever raise before they are handled. TIMER in IDLE
+ * runs testAndResetCount, which can raise NO_DETECT (detectFlush) and then one
+ * of REPORT_DUE, DETECT or TEST_LEVEL: two queued. NO_DETECT is ignored in
+ * IDLE, and each of the others runs an action that raises one event
+ * (wakeMaster SEND_COMPLETE; testLevel PIT_FULL, PIT_NOT_FULL or COMPLETE)
+ * into the slot it left. The actions those run raise nothing more. Every other
+ * action raises at most one event (sendData SEND_COMPLETE, retryWake
+ * WAKE_TIMEOUT), and entry actions raise none. Update this with any change to
+ * the actions' smEvent calls.
+ */
+#define LATRINESENSOR_MAX_QUEUED_EVENTS	(2)
+
+/* X(state, entryAction) for every state */
+#define LATRINESENSOR_STATES(X) \
+	X(IDLE,			onIdleState)	\
+	X(SENDING1,		onStateChange)	\
+	X(SENDING2,		onStateChange)	\
+	X(SENDING3,		onStateChange)	\
+	X(LEVEL_TEST,	onStateChange)
+
+/* X(state, event, action, nextState) for every transition */
+#define LATRINESENSOR_TRANSITIONS(X) \
+	X(IDLE,			DETECT,			wakeMaster,			SENDING1)	\
+	X(IDLE,			TIMER,			testAndResetCount,	IDLE)		\
+	X(IDLE,			REPORT_DUE,		wakeMaster,			SENDING1)	\
+	X(IDLE,			TEST_LEVEL,		testLevel,			LEVEL_TEST)	\
+																		\
+	X(LEVEL_TEST,	PIT_FULL,		wakeMaster,			SENDING1)	\
+	X(LEVEL_TEST,	PIT_NOT_FULL,	wakeMaster,			SENDING1)	\
+	X(LEVEL_TEST,	COMPLETE,		SM_NO_ACTION,		IDLE)		\
+																		\
+	X(SENDING1,		SEND_COMPLETE,	startWakeTimer,		SENDING2)	\
+	X(SENDING2,		MASTER_READY,	sendData,			SENDING3)	\
+	X(SENDING2,		TIMER,			retryWake,			SENDING2)	\
+	X(SENDING2,		WAKE_TIMEOUT,	abandonReport,		IDLE)		\
+	X(SENDING3,		TIMER,			sendData,			SENDING3)	\
+	X(SENDING3,		SEND_COMPLETE,	SM_NO_ACTION,		IDLE)
+
+#endif
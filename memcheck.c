@@ -0,0 +1,148 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "memcheck.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define STACK_PAINT_BYTE (0xC5)
+
+// Scan a few bytes per call so the idle loop is never held up for long
+#define SCAN_BYTES_PER_TASK (16)
+
+/*
+ * Linker symbols (avr-libc default linker script)
+ */
+
+#ifndef TEST_HARNESS
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+#endif
+
+/*
+ * Private Function Prototypes
+ */
+
+#ifndef TEST_HARNESS
+void MemCheck_PaintStack(void) __attribute__ ((naked, used, section(".init1")));
+#endif
+
+/* 
+ * Private Variables
+ */
+
+static uint16_t s_stackFreeBytes;
+
+#ifdef TEST_HARNESS
+static uintptr_t s_stackBase;
+#else
+static uint8_t * s_scanPtr;
+#endif
+
+/*
+ * Public Function Defintions
+ */
+
+#ifndef TEST_HARNESS
+
+/*
+ * Runs from .init1, before the stack pointer is set up and before .data/.bss
+ * are initialised, so everything between the end of static RAM and the top
+ * of the stack is filled with the paint byte.
+ */
+void MemCheck_PaintStack(void)
+{
+	uint8_t * p = &_end;
+	
+	while (p <= &__stack)
+	{
+		*p++ = STACK_PAINT_BYTE;
+	}
+}
+
+void MemCheck_Init(void)
+{
+	s_scanPtr = &_end;
+	s_stackFreeBytes = (uint16_t)(&__stack - &_end);
+}
+
+void MemCheck_Task(void)
+{
+	// The stack grows down towards _end, so the first byte above _end that has
+	// lost its paint marks the deepest stack use seen so far.
+	uint8_t n = SCAN_BYTES_PER_TASK;
+	
+	while (n--)
+	{
+		if ((*s_scanPtr != STACK_PAINT_BYTE) || (s_scanPtr >= &__stack))
+		{
+			uint16_t freeBytes = (uint16_t)(s_scanPtr - &_end);
+			
+			if (freeBytes < s_stackFreeBytes)
+			{
+				s_stackFreeBytes = freeBytes;
+			}
+			
+			s_scanPtr = &_end;
+			return;
+		}
+		
+		s_scanPtr++;
+	}
+}
+
+uint16_t MemCheck_GetStaticBytes(void)
+{
+	return (uint16_t)(&_end - &__data_start);
+}
+
+#else
+
+/*
+ * On the host there is no painted stack. Track the lowest stack address seen
+ * by the idle loop instead, which is enough to spot call depth regressions.
+ */
+
+void MemCheck_Init(void)
+{
+	uint8_t marker;
+	s_stackBase = (uintptr_t)&marker;
+	s_stackFreeBytes = UINT16_MAX;
+}
+
+void MemCheck_Task(void)
+{
+	uint8_t marker;
+	uintptr_t used = s_stackBase - (uintptr_t)&marker;
+	uint16_t freeBytes = (used < UINT16_MAX) ? (uint16_t)(UINT16_MAX - used) : 0U;
+
+	if (freeBytes < s_stackFreeBytes)
+	{
+		s_stackFreeBytes = freeBytes;
+		printf("Stack high-water: %u bytes below main\n", (unsigned int)(UINT16_MAX - freeBytes));
+	}
+}
+
+uint16_t MemCheck_GetStaticBytes(void)
+{
+	return 0U;
+}
+
+#endif
+
+uint16_t MemCheck_GetStackFreeBytes(void)
+{
+	return s_stackFreeBytes;
+}
@@ -0,0 +1,14 @@
+#ifndef _MEMCHECK_H_
+#define _MEMCHECK_H_
+
+/*
+ * Public Function Prototypes
+ */
+
+void MemCheck_Init(void);
+void MemCheck_Task(void);
+
+uint16_t MemCheck_GetStackFreeBytes(void);
+uint16_t MemCheck_GetStaticBytes(void);
+
+#endif
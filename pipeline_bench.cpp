@@ -0,0 +1,246 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef __AVR__
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+/*
+ * Local Application Includes
+ */
+
+#include "firmware_pipeline.h"
+
+extern "C" {
+#include "tempsense.h"
+#include "tempcomp.h"
+#include "flush_counter.h"
+#include "summary.h"
+#include "pitlevel.h"
+#include "txsched.h"
+#include "rtc.h"
+#include "sampling.h"
+#include "baseline.h"
+}
+
+#ifndef __AVR__
+#include "host_test.h"
+#endif
+
+/*
+ * Compares the firmware's flush detection chain, FlushChain_Sample as
+ * detectFlush calls it, with the same chain built as a FirmwarePipeline.
+ * Both run everything detectFlush does, into the real summary, pit level,
+ * transmit scheduler, sampling and baseline modules; only the temperatures
+ * are fixed here, in place of tempsense.c.
+ *
+ * On the host, both are run over the same simulated sensor trace. The flushes
+ * they queue for sending must match exactly, as must the pit level, and the
+ * host cycles per sample of each are printed.
+ *
+ * For the AVR, build with PIPELINE_AVR_C or PIPELINE_AVR_CPP defined to get
+ * an image holding only one chain, fed from a volatile, so avr-size can
+ * compare them ("make -f pipeline_bench.mk size").
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SAMPLE_MS			(1000U)
+
+#define TRACE_SAMPLES		(200000L)
+#define FLUSH_PERIOD_S		(600L)
+#define FLUSH_MIN_S			(4L)
+#define FLUSH_MAX_S			(33L)
+
+// Temperatures are held fixed, so that TComp learning in the first run does not change the second
+#define BENCH_OUTFLOW		(180)
+#define BENCH_AMBIENT		(250)
+
+struct BenchResult
+{
+	uint32_t flushes;
+	uint32_t totalSecs;
+	uint16_t levelPercent;
+};
+
+/*
+ * Private Variables
+ */
+
+#ifdef __AVR__
+static volatile uint16_t s_input;
+static volatile uint32_t s_output;
+#else
+static uint16_t s_trace[TRACE_SAMPLES];
+static long s_next;
+#endif
+
+static BenchResult s_result;
+
+/*
+ * Policies for the bench
+ */
+
+struct BenchSource
+{
+#ifdef __AVR__
+	uint16_t take(void) { return s_input; }
+#else
+	uint16_t take(void) { return s_trace[s_next++]; }
+#endif
+};
+
+typedef FirmwarePipeline<BenchSource> BenchPipeline;
+
+/*
+ * In place of tempsense.c, which needs the ADC
+ */
+
+extern "C" TENTHSDEGC TS_GetTemperature(TEMPERATURE_SENSOR eSensor)
+{
+	return (eSensor == SENSOR_OUTFLOW) ? BENCH_OUTFLOW : BENCH_AMBIENT;
+}
+
+extern "C" bool TS_HasReadings(void)
+{
+	return true;
+}
+
+/* Takes the flushes queued for sending, as sendData would */
+static void collectFlushes(void)
+{
+	TXSCHED_RECORD record;
+	uint16_t ageSecs;
+
+	while (TxSched_TakeRecord(&record, &ageSecs))
+	{
+		s_result.flushes++;
+		s_result.totalSecs += record.durationSecs;
+	}
+}
+
+static void initModules(void)
+{
+	Threshold_Init();
+	TComp_Init();
+#ifndef PIPELINE_AVR_CPP
+	Filter_Init();
+	Flush_Reset();
+#endif
+	Summary_Init();
+	Level_Reset();
+	Level_Init();
+	TxSched_Init();
+	RTC_Init();
+	Sampling_Init(SAMPLING_DEFAULT_GATED_PERIOD);
+	Baseline_Init();
+	s_result = BenchResult();
+}
+
+#ifdef __AVR__
+
+int main(void)
+{
+	initModules();
+
+#if defined(PIPELINE_AVR_CPP)
+	static BenchPipeline pipeline;
+	while (true) { s_output = pipeline.Tick(SAMPLE_MS); collectFlushes(); s_output = s_result.totalSecs; }
+#elif defined(PIPELINE_AVR_C)
+	while (true) { s_output = FlushChain_Sample(s_input, SAMPLE_MS); collectFlushes(); s_output = s_result.totalSecs; }
+#else
+#error Define PIPELINE_AVR_C or PIPELINE_AVR_CPP
+#endif
+}
+
+#else
+
+/*
+ * Private Function Prototypes
+ */
+
+static void makeTrace(void);
+static uint64_t now(void);
+
+int main(void)
+{
+	makeTrace();
+
+	// Both loops take the queued flushes each sample, so the cost of that is the same in each
+	initModules();
+	uint64_t start = now();
+	for (long i = 0; i < TRACE_SAMPLES; ++i) { FlushChain_Sample(s_trace[i], SAMPLE_MS); collectFlushes(); }
+	uint64_t cTime = now() - start;
+	s_result.levelPercent = Level_GetPercent();
+	BenchResult cResult = s_result;
+
+	initModules();
+	s_next = 0;
+	static BenchPipeline pipeline;
+	start = now();
+	for (long i = 0; i < TRACE_SAMPLES; ++i) { pipeline.Tick(SAMPLE_MS); collectFlushes(); }
+	uint64_t cppTime = now() - start;
+	s_result.levelPercent = Level_GetPercent();
+	BenchResult cppResult = s_result;
+
+#if defined(__x86_64__) || defined(__i386__)
+	const char * unit = "cycles";
+#else
+	const char * unit = "ns";
+#endif
+
+	printf("%-10s %10s %12s %12s %14s\n", "chain", "flushes", "total s", "level %", unit);
+	printf("%-10s %10u %12u %12u %14.1f\n", "C", cResult.flushes, cResult.totalSecs, cResult.levelPercent,
+		(double)cTime / TRACE_SAMPLES);
+	printf("%-10s %10u %12u %12u %14.1f\n", "pipeline", cppResult.flushes, cppResult.totalSecs, cppResult.levelPercent,
+		(double)cppTime / TRACE_SAMPLES);
+
+	bool match = (cResult.flushes == cppResult.flushes) && (cResult.totalSecs == cppResult.totalSecs) &&
+		(cResult.levelPercent == cppResult.levelPercent);
+
+	printf("%s\n", match ? "PASSED" : "FAILED: chains disagree");
+
+	return match ? 0 : 1;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void makeTrace(void)
+{
+	SIM_FLUSH flush = {0, 0};
+
+	srand(1);
+
+	for (long i = 0; i < TRACE_SAMPLES; ++i)
+	{
+		if ((i % FLUSH_PERIOD_S) == 0) { Sim_PlanFlush(&flush, i, FLUSH_PERIOD_S, FLUSH_MIN_S, FLUSH_MAX_S); }
+
+		s_trace[i] = Sim_Count((i >= flush.start) && (i < flush.end));
+	}
+}
+
+static uint64_t now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	// Nanoseconds where there is no cycle counter
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return ((uint64_t)t.tv_sec * 1000000000U) + (uint64_t)t.tv_nsec;
+#endif
+}
+
+#endif
@@ -0,0 +1,55 @@
+NAME = pipeline_bench
+CC = gcc
+CXX = g++
+FLAGS = -Wall -Wextra -O2 $(OPTS)
+
+AVR_CC = avr-gcc
+AVR_CXX = avr-g++
+AVR_SIZE = avr-size
+MCU = atmega328p
+AVR_FLAGS = -Wall -Wextra -Os -mmcu=$(MCU) -DF_CPU=8000000 -ffunction-sections -fdata-sections -Wl,--gc-sections $(OPTS)
+
+LIBS_DIR = ../Libs
+
+INCLUDE_DIRS = \
+	-I. \
+	-IArduino/libraries/LatrineSensor/src
+
+HOST_INCLUDE_DIRS = \
+	-IHost \
+	-I$(LIBS_DIR)/AVR/Harness \
+	$(INCLUDE_DIRS)
+
+# Everything detectFlush calls, apart from tempsense.c: the bench fixes the temperatures
+CFILES = \
+	flush_chain.c \
+	threshold.c \
+	tempcomp.c \
+	filter.c \
+	flush_counter.c \
+	summary.c \
+	pitlevel.c \
+	txsched.c \
+	rtc.c \
+	sampling.c \
+	baseline.c \
+
+# Runs both chains over the same trace, checks they agree and prints host cycles per sample
+all: build
+	$(NAME).exe
+
+build:
+	$(CC) $(FLAGS) -std=c99 -DTEST_HARNESS $(HOST_INCLUDE_DIRS) -c $(CFILES)
+	$(CXX) $(FLAGS) -std=gnu++11 -DTEST_HARNESS $(HOST_INCLUDE_DIRS) pipeline_bench.cpp \
+		$(CFILES:.c=.o) -o $(NAME).exe
+
+# Flash and RAM of an AVR image holding only the C chain, and of one holding only the template.
+# Unused code is dropped at link time, so the C image has no template and the template image
+# no filter.c or flush_counter.c.
+size:
+	$(AVR_CC) $(AVR_FLAGS) -std=gnu99 $(INCLUDE_DIRS) -c $(CFILES)
+	$(AVR_CXX) $(AVR_FLAGS) -std=gnu++11 -DPIPELINE_AVR_C $(INCLUDE_DIRS) pipeline_bench.cpp \
+		$(CFILES:.c=.o) -o $(NAME)_c.elf
+	$(AVR_CXX) $(AVR_FLAGS) -std=gnu++11 -DPIPELINE_AVR_CPP $(INCLUDE_DIRS) pipeline_bench.cpp \
+		$(CFILES:.c=.o) -o $(NAME)_cpp.elf
+	$(AVR_SIZE) $(NAME)_c.elf $(NAME)_cpp.elf
@@ -0,0 +1,314 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+
+#include <avr/eeprom.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tempsense.h"
+#include "pitlevel.h"
+
+/*
+ * Estimates the pit fill level from the outflow volume, in constant memory.
+ * Each flush adds its duration times the flow rate. Every hour the volume
+ * decays by a fraction that rises with pit temperature, modelling drainage
+ * and digestion, so the estimate is
+ *
+ *	V(n+1) = V(n) * (1 - k(T)) + flowRate * flushSeconds
+ *
+ * Only a report is sent when the level crosses a 10% band or the full
+ * threshold, and at a daily checkpoint. The volume is saved to EEPROM at
+ * each report so it survives a reset.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define DEFAULT_CAPACITY_LITRES		(3000U)
+#define DEFAULT_FLOW_ML_PER_SEC		(250U)
+
+#define ERASED_EEPROM_WORD			(0xFFFFU)
+#define ERASED_EEPROM_DWORD			(0xFFFFFFFFUL)
+
+#define MAX_VOLUME_ML				(ERASED_EEPROM_DWORD - 1UL)	// So that a saved volume never reads as erased
+
+#define BAND_PERCENT				(10U)
+#define BAND_HYSTERESIS_PERCENT		(2U)	// Falling crossings need to drop this far into the lower band
+#define MAX_REPORT_PERCENT			(999U)
+
+#define CHECKPOINT_HOURS			(24U)
+
+#define MS_PER_SECOND				(1000UL)
+#define MS_PER_MINUTE				(60000UL)
+#define MAX_FLUSH_SECONDS			(UINT32_MAX / UINT16_MAX)	// About 18 hours, beyond any real flush
+#define MINUTES_PER_HOUR			(60U)
+
+/*
+ * Hourly decay fraction in Q16 at 0, 5, 10, ... 40 degrees C. This is 1% a
+ * day at 20 degrees, scaled by 1.07 per degree as for biological processes.
+ */
+#define DECAY_STEP_TENTHS			(50)
+#define DECAY_TABLE_LENGTH			(9U)
+
+/*
+ * Private Function Prototypes
+ */
+
+static uint16_t decayRateQ16(TENTHSDEGC temperature);
+static void applyDecay(uint16_t rateQ16);
+static bool updateCrossings(uint16_t percent);
+static void save(void);
+
+/*
+ * Private Variables
+ */
+
+static const uint8_t s_decayTable[DECAY_TABLE_LENGTH] = {7, 10, 14, 19, 27, 38, 54, 75, 106};
+
+static uint32_t s_volumeMl;
+uint32_t EEMEM s_volumeEEPROM = 0UL;
+
+static uint16_t s_capacityLitres;
+uint16_t EEMEM s_capacityEEPROM = DEFAULT_CAPACITY_LITRES;
+
+static uint16_t s_flowRate;
+uint16_t EEMEM s_flowRateEEPROM = DEFAULT_FLOW_ML_PER_SEC;
+
+static uint16_t s_msInMinute;
+static uint8_t s_minutesInHour;
+static uint8_t s_hoursToCheckpoint;
+
+static bool s_checkDue;
+static bool s_checkpointDue;
+static bool s_reportPending;
+static char s_reportReason;
+
+static bool s_full;
+static uint8_t s_reportedBand;
+
+/*
+ * Public Function Defintions
+ */
+
+void Level_Init(void)
+{
+	s_volumeMl = eeprom_read_dword(&s_volumeEEPROM);
+	if (s_volumeMl == ERASED_EEPROM_DWORD) { s_volumeMl = 0UL; }
+
+	s_capacityLitres = eeprom_read_word(&s_capacityEEPROM);
+	if ((s_capacityLitres == ERASED_EEPROM_WORD) || (s_capacityLitres == 0U)) { s_capacityLitres = DEFAULT_CAPACITY_LITRES; }
+
+	s_flowRate = eeprom_read_word(&s_flowRateEEPROM);
+	if (s_flowRate == ERASED_EEPROM_WORD) { s_flowRate = DEFAULT_FLOW_ML_PER_SEC; }
+
+	s_hoursToCheckpoint = CHECKPOINT_HOURS;
+	s_checkDue = false;
+	s_checkpointDue = false;
+	s_reportPending = false;
+
+	// Start from the saved level without reporting it again
+	uint16_t percent = Level_GetPercent();
+	s_full = (percent >= LEVEL_FULL_PERCENT);
+	s_reportedBand = percent / BAND_PERCENT;
+}
+
+void Level_SetCapacity(uint16_t litres)
+{
+	if (litres == 0U) { return; }
+
+	s_capacityLitres = litres;
+	eeprom_update_word(&s_capacityEEPROM, s_capacityLitres);
+	s_checkDue = true;
+}
+
+void Level_SetFlowRate(uint16_t mlPerSecond)
+{
+	s_flowRate = mlPerSecond;
+	eeprom_update_word(&s_flowRateEEPROM, s_flowRate);
+}
+
+void Level_Reset(void)
+{
+	// The pit has been emptied
+	s_volumeMl = 0UL;
+	save();
+	s_checkDue = true;
+}
+
+void Level_AddFlush(uint32_t durationMs)
+{
+	// Whole seconds and the remainder are multiplied separately, so neither product can overflow
+	uint32_t seconds = durationMs / MS_PER_SECOND;
+	if (seconds > MAX_FLUSH_SECONDS) { seconds = MAX_FLUSH_SECONDS; }
+
+	uint32_t addedMl = (seconds * s_flowRate) + (((durationMs % MS_PER_SECOND) * s_flowRate) / MS_PER_SECOND);
+
+	s_volumeMl = ((MAX_VOLUME_ML - s_volumeMl) < addedMl) ? MAX_VOLUME_ML : (s_volumeMl + addedMl);
+	s_checkDue = true;
+}
+
+void Level_Tick(uint16_t ms, TENTHSDEGC pitTemperature)
+{
+	s_msInMinute += ms;
+
+	while (s_msInMinute >= MS_PER_MINUTE)
+	{
+		s_msInMinute -= MS_PER_MINUTE;
+
+		if (++s_minutesInHour == MINUTES_PER_HOUR)
+		{
+			s_minutesInHour = 0U;
+
+			applyDecay(decayRateQ16(pitTemperature));
+			s_checkDue = true;
+
+			if (--s_hoursToCheckpoint == 0U)
+			{
+				s_hoursToCheckpoint = CHECKPOINT_HOURS;
+				s_checkpointDue = true;
+			}
+		}
+	}
+}
+
+bool Level_IsCheckDue(void)
+{
+	return s_checkDue;
+}
+
+/*
+ * Decides whether a level report is needed. A report stays pending until it
+ * has been written with Level_WriteReport, so one that could not be sent is
+ * retried at the next check.
+ */
+LEVEL_RESULT Level_Check(void)
+{
+	s_checkDue = false;
+
+	if (updateCrossings(Level_GetPercent()))
+	{
+		s_reportPending = true;
+		s_reportReason = 'X';
+		save();
+	}
+
+	if (s_checkpointDue)
+	{
+		s_checkpointDue = false;
+		if (!s_reportPending) { s_reportReason = 'C'; }
+		s_reportPending = true;
+		save();
+	}
+
+	if (!s_reportPending)
+	{
+		return LEVEL_NO_REPORT;
+	}
+
+	return s_full ? LEVEL_REPORT_FULL : LEVEL_REPORT_NOT_FULL;
+}
+
+uint16_t Level_GetPercent(void)
+{
+	uint32_t percent = s_volumeMl / ((uint32_t)s_capacityLitres * 10U);
+	return (percent > MAX_REPORT_PERCENT) ? MAX_REPORT_PERCENT : (uint16_t)percent;
+}
+
+/*
+ * Writes the 9 character report body "LVsrppp--": s is F (full) or N (not
+ * full), r is X (band crossing) or C (checkpoint), ppp is the percent full.
+ */
+void Level_WriteReport(char * msg)
+{
+	uint16_t percent = Level_GetPercent();
+
+	msg[0] = 'L';
+	msg[1] = 'V';
+	msg[2] = s_full ? 'F' : 'N';
+	msg[3] = s_reportReason;
+
+	for (int8_t i = 6; i >= 4; --i)
+	{
+		msg[i] = '0' + (percent % 10U);
+		percent /= 10U;
+	}
+
+	msg[7] = '-';
+	msg[8] = '-';
+
+	s_reportPending = false;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static uint16_t decayRateQ16(TENTHSDEGC temperature)
+{
+	if (temperature < 0) { temperature = 0; }
+
+	uint8_t index = temperature / DECAY_STEP_TENTHS;
+	if (index >= (DECAY_TABLE_LENGTH - 1U))
+	{
+		return s_decayTable[DECAY_TABLE_LENGTH - 1U];
+	}
+
+	uint8_t fraction = temperature % DECAY_STEP_TENTHS;
+	uint16_t low = s_decayTable[index];
+	uint16_t high = s_decayTable[index + 1U];
+
+	return low + (((high - low) * fraction) / DECAY_STEP_TENTHS);
+}
+
+static void applyDecay(uint16_t rateQ16)
+{
+	// V * rate / 65536 without a 64-bit multiply
+	uint32_t decay = ((s_volumeMl >> 16) * rateQ16) + (((s_volumeMl & 0xFFFFUL) * rateQ16) >> 16);
+	s_volumeMl -= decay;
+}
+
+static bool updateCrossings(uint16_t percent)
+{
+	bool crossed = false;
+	uint8_t band = percent / BAND_PERCENT;
+
+	if (!s_full && (percent >= LEVEL_FULL_PERCENT))
+	{
+		s_full = true;
+		crossed = true;
+	}
+	else if (s_full && (percent < LEVEL_NOT_FULL_PERCENT))
+	{
+		s_full = false;
+		crossed = true;
+	}
+
+	if (band > s_reportedBand)
+	{
+		s_reportedBand = band;
+		crossed = true;
+	}
+	else if ((band < s_reportedBand) && ((percent + BAND_HYSTERESIS_PERCENT) < (s_reportedBand * BAND_PERCENT)))
+	{
+		s_reportedBand = band;
+		crossed = true;
+	}
+
+	return crossed;
+}
+
+static void save(void)
+{
+	eeprom_update_dword(&s_volumeEEPROM, s_volumeMl);
+}
@@ -0,0 +1,38 @@
+#ifndef _PITLEVEL_H_
+#define _PITLEVEL_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define LEVEL_FULL_PERCENT			(90U)
+#define LEVEL_NOT_FULL_PERCENT		(85U)	// Hysteresis below LEVEL_FULL_PERCENT
+
+enum level_result
+{
+	LEVEL_NO_REPORT,
+	LEVEL_REPORT_FULL,
+	LEVEL_REPORT_NOT_FULL
+};
+typedef enum level_result LEVEL_RESULT;
+
+/*
+ * Public Function Prototypes
+ */
+
+void Level_Init(void);
+
+void Level_SetCapacity(uint16_t litres);
+void Level_SetFlowRate(uint16_t mlPerSecond);
+void Level_Reset(void);
+
+void Level_AddFlush(uint32_t durationMs);
+void Level_Tick(uint16_t ms, TENTHSDEGC pitTemperature);
+
+bool Level_IsCheckDue(void);
+LEVEL_RESULT Level_Check(void);
+
+uint16_t Level_GetPercent(void);
+void Level_WriteReport(char * msg);
+
+#endif
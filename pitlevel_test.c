@@ -0,0 +1,323 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tempsense.h"
+#include "pitlevel.h"
+#include "host_test.h"
+
+/*
+ * Drives the pit level estimate through flushes, capacity changes and hours
+ * of decay, and checks the reports it asks for: band crossings up and down
+ * (with the falling hysteresis), the full and not full transitions, the
+ * daily checkpoint, and a report that stays pending when it is not sent.
+ * The decay rate between table points is checked by how many hours the
+ * level takes to fall through a band.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define FLOW_ML_PER_SEC			(250U)
+#define CAPACITY_LITRES			(1000U)
+#define LARGE_CAPACITY_LITRES	(20000U)	// Makes the rounding in the decay small
+#define MAX_FLUSH_MS			(3600000UL)
+
+#define MS_PER_MINUTE			(60000U)
+#define MINUTES_PER_HOUR		(60)
+
+#define WARM_TENTHS				(225)		// Half way between the 20 and 25 degree table points
+#define WARM_RATE_Q16			(32.0)		// 27 + (38 - 27) / 2, rounded down
+#define MAX_HOURS				(2000)
+
+/*
+ * Private Function Prototypes
+ */
+
+static void testRisingBands(void);
+static void testFallingHysteresis(void);
+static void testFull(void);
+static void testPendingAfterAbandon(void);
+static void testCheckpoint(void);
+static void testDecay(void);
+static void testLongFlush(void);
+
+static void start(uint16_t capacityLitres);
+static void addPercent(uint16_t percent);
+static void runHour(TENTHSDEGC temperature);
+static LEVEL_RESULT checkAndSend(char * msg);
+
+/*
+ * Private Variables
+ */
+
+static int failures = 0;
+
+static uint16_t s_capacityLitres;
+
+int main(void)
+{
+	Level_Init();
+
+	testRisingBands();
+	testFallingHysteresis();
+	testFull();
+	testPendingAfterAbandon();
+	testCheckpoint();
+	testDecay();
+	testLongFlush();
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void testRisingBands(void)
+{
+	char msg[10] = {0};
+
+	start(CAPACITY_LITRES);
+
+	addPercent(9);
+	CHECK(Level_IsCheckDue());
+	CHECK(checkAndSend(msg) == LEVEL_NO_REPORT);
+	CHECK(!Level_IsCheckDue());
+
+	addPercent(1);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX010--") == 0);
+
+	// Reported once per band
+	addPercent(5);
+	CHECK(checkAndSend(msg) == LEVEL_NO_REPORT);
+
+	// Several bands at once is one report
+	addPercent(30);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX045--") == 0);
+}
+
+static void testFallingHysteresis(void)
+{
+	char msg[10] = {0};
+
+	// 300 litres: 30% of 1000 litres
+	start(CAPACITY_LITRES);
+	addPercent(30);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+
+	// 29%, 28%: only just below the band, so no report
+	Level_SetCapacity(1010);
+	CHECK(checkAndSend(msg) == LEVEL_NO_REPORT);
+	CHECK(Level_GetPercent() == 29);
+	Level_SetCapacity(1050);
+	CHECK(checkAndSend(msg) == LEVEL_NO_REPORT);
+	CHECK(Level_GetPercent() == 28);
+
+	// 27% is more than the hysteresis into the lower band
+	Level_SetCapacity(1100);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX027--") == 0);
+
+	// Back up into the band is reported straight away
+	Level_SetCapacity(1000);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX030--") == 0);
+}
+
+static void testFull(void)
+{
+	char msg[10] = {0};
+
+	start(CAPACITY_LITRES);
+	addPercent(89);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX089--") == 0);
+
+	addPercent(1);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_FULL);
+	CHECK(strcmp(msg, "LVFX090--") == 0);
+
+	// Still full between LEVEL_NOT_FULL_PERCENT and LEVEL_FULL_PERCENT
+	Level_SetCapacity(1050);
+	CHECK(Level_GetPercent() == 85);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_FULL);
+	CHECK(strcmp(msg, "LVFX085--") == 0);
+
+	Level_SetCapacity(1060);
+	CHECK(Level_GetPercent() == 84);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX084--") == 0);
+
+	// Full again only at LEVEL_FULL_PERCENT
+	Level_SetCapacity(1000);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_FULL);
+	CHECK(strcmp(msg, "LVFX090--") == 0);
+
+	// Emptying the pit is reported as not full
+	Level_Reset();
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX000--") == 0);
+}
+
+static void testPendingAfterAbandon(void)
+{
+	char msg[10] = {0};
+
+	start(CAPACITY_LITRES);
+	addPercent(20);
+
+	// The master did not answer, so the report was never written
+	CHECK(Level_Check() == LEVEL_REPORT_NOT_FULL);
+
+	// Still pending at the next check, with no new crossing
+	Level_SetCapacity(CAPACITY_LITRES);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(strcmp(msg, "LVNX020--") == 0);
+
+	CHECK(checkAndSend(msg) == LEVEL_NO_REPORT);
+
+	// A checkpoint while a crossing is pending keeps the crossing as the reason
+	addPercent(10);
+	CHECK(Level_Check() == LEVEL_REPORT_NOT_FULL);
+	for (int hour = 0; hour < 24; ++hour) { runHour(200); }
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	CHECK(msg[3] == 'X');
+}
+
+static void testCheckpoint(void)
+{
+	char msg[10] = {0};
+
+	start(CAPACITY_LITRES);
+	addPercent(45);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+
+	// Checked every hour, but only reported once a day
+	for (int day = 0; day < 3; ++day)
+	{
+		for (int hour = 0; hour < 23; ++hour)
+		{
+			runHour(0);
+			CHECK(Level_IsCheckDue());
+			CHECK(checkAndSend(msg) == LEVEL_NO_REPORT);
+		}
+
+		runHour(0);
+		CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+		CHECK(msg[3] == 'C');
+	}
+}
+
+static void testDecay(void)
+{
+	static const TENTHSDEGC temperatures[] = {200, WARM_TENTHS, 250};
+	static const double ratesQ16[] = {27.0, WARM_RATE_Q16, 38.0};
+	int hoursToFall[3];
+
+	for (int i = 0; i < 3; ++i)
+	{
+		char msg[10] = {0};
+		int hour = 0;
+
+		start(LARGE_CAPACITY_LITRES);
+		addPercent(10);
+		CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+
+		// From 10% until the band crossing below 8%
+		for (hour = 1; hour < MAX_HOURS; ++hour)
+		{
+			runHour(temperatures[i]);
+			if ((checkAndSend(msg) != LEVEL_NO_REPORT) && (msg[3] == 'X')) { break; }
+		}
+
+		// Decay rounds down, so takes a little longer than the exact model
+		double expected = ceil(log(0.8) / log(1.0 - (ratesQ16[i] / 65536.0)));
+		CHECK((hour >= expected) && (hour <= (expected * 1.005)));
+		CHECK(strcmp(msg, "LVNX007--") == 0);
+
+		hoursToFall[i] = hour;
+	}
+
+	printf("Hours to fall from 10%% to 7%%: %d at 20C, %d at 22.5C, %d at 25C\n",
+		hoursToFall[0], hoursToFall[1], hoursToFall[2]);
+
+	// Below freezing the rate is held at the end of the table: well under 1% a day
+	char msg[10] = {0};
+	start(CAPACITY_LITRES);
+	addPercent(10);
+	CHECK(checkAndSend(msg) == LEVEL_REPORT_NOT_FULL);
+	for (int hour = 0; hour < 24; ++hour) { runHour(-50); }
+	CHECK(Level_GetPercent() == 9);
+}
+
+static void testLongFlush(void)
+{
+	// 20 minutes at 60 litres a second is 72000 litres: more than 32 bits as ms times ml per second
+	start(60000U);
+	Level_SetFlowRate(60000U);
+	Level_AddFlush(20UL * MS_PER_MINUTE);
+	CHECK(Level_GetPercent() == 120);
+
+	Level_SetFlowRate(FLOW_ML_PER_SEC);
+}
+
+/* An empty pit of the given capacity, with nothing left to report */
+static void start(uint16_t capacityLitres)
+{
+	Level_SetFlowRate(FLOW_ML_PER_SEC);
+	Level_SetCapacity(capacityLitres);
+	s_capacityLitres = capacityLitres;
+	Level_Reset();
+	Level_Init();
+	(void)Level_Check();
+	CHECK(Level_Check() == LEVEL_NO_REPORT);
+}
+
+/* Flushes adding the given percentage of the capacity set by start */
+static void addPercent(uint16_t percent)
+{
+	uint32_t ms = (((uint32_t)percent * s_capacityLitres * 10U) / FLOW_ML_PER_SEC) * 1000U;
+
+	while (ms > 0U)
+	{
+		uint32_t flushMs = (ms > MAX_FLUSH_MS) ? MAX_FLUSH_MS : ms;
+		Level_AddFlush(flushMs);
+		ms -= flushMs;
+	}
+}
+
+static void runHour(TENTHSDEGC temperature)
+{
+	for (int minute = 0; minute < MINUTES_PER_HOUR; ++minute)
+	{
+		Level_Tick(MS_PER_MINUTE, temperature);
+	}
+}
+
+/* Checks the level, and sends any report asked for as the firmware would */
+static LEVEL_RESULT checkAndSend(char * msg)
+{
+	LEVEL_RESULT result = Level_Check();
+
+	if (result != LEVEL_NO_REPORT)
+	{
+		Level_WriteReport(msg);
+	}
+
+	return result;
+}
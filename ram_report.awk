@@ -0,0 +1,54 @@
+# Per-module static RAM breakdown from an avr-gcc link map.
+# Usage: awk -f ram_report.awk LatrineSensor.map
+
+# Only the memory map part of the file lists final placements
+/^Linker script and memory map/ { inMap = 1; next }
+
+!inMap { next }
+
+# Input sections that end up in SRAM: initialised data (including read-only
+# data, which avr-gcc places in RAM), zeroed data and common symbols
+function isRamSection(name)
+{
+	return (name ~ /^\.(data|bss|noinit|rodata)/) || (name == "COMMON")
+}
+
+function hex(s,    i, n, c)
+{
+	n = 0
+	s = tolower(substr(s, 3))
+	for (i = 1; i <= length(s); i++)
+	{
+		c = index("0123456789abcdef", substr(s, i, 1))
+		n = (n * 16) + c - 1
+	}
+	return n
+}
+
+function addSize(size, object)
+{
+	if (object == "" || size == 0) { return }
+	sub(/^.*[\/\\]/, "", object)
+	ram[object] += size
+	total += size
+}
+
+# Long section names are printed alone with the address/size/object on the next line
+pending != "" {
+	if ($1 ~ /^0x/) { addSize(hex($2), $3) }
+	pending = ""
+	next
+}
+
+/^ [^ ]/ && isRamSection($1) {
+	if (NF == 1) { pending = $1 }
+	else if ($2 ~ /^0x/ && NF >= 4) { addSize(hex($3), $4) }
+	next
+}
+
+END {
+	printf "%-32s %6s\n", "Module", "Bytes"
+	for (object in ram) { printf "%-32s %6d\n", object, ram[object] | "sort -k2 -n -r" }
+	close("sort -k2 -n -r")
+	printf "%-32s %6d\n", "Total", total
+}
@@ -0,0 +1,215 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+
+#include <avr/eeprom.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "rtc.h"
+
+/*
+ * Keeps wall clock time as a 32-bit count of seconds since 1970, advanced
+ * only by the application timer tick (RTC_Tick from the main loop). The timer
+ * keeps running while the CPU sleeps, so no time is lost there; nothing else
+ * drives the clock. Each tick costs one 16x32 multiply and an add, and a
+ * divide only on ticks where the correction reaches a whole millisecond.
+ *
+ * The tick source is assumed to be off by a constant rate, measured between
+ * time syncs from the master as
+ *
+ *	drift = (master elapsed - local elapsed) / local elapsed
+ *
+ * against the uncorrected local time, and averaged over syncs unless it
+ * changes by more than the sync jitter can explain. The drift is
+ * kept in EEPROM so a unit keeps its correction over a reset. Until the first
+ * sync the clock counts from power up, as from midnight.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define ERASED_EEPROM_DWORD			(0xFFFFFFFFUL)
+
+#define PPM							(1000000L)
+#define MS_PER_SECOND				(1000U)
+#define SECONDS_PER_MINUTE			(60U)
+#define SECONDS_PER_DAY				(86400UL)
+
+#define MIN_MEASURE_SECS			(3600UL)		// 1s sync resolution is then under 300ppm
+#define MAX_MEASURE_SECS			(7UL * SECONDS_PER_DAY)	// Keeps the sums within 32 bits
+#define DRIFT_EWMA_SHIFT			(2)				// New measurement has a weight of 1/4
+#define MAX_SYNC_ERROR_SECS			(4L)			// Larger differences restart the average
+#define DRIFT_SAVE_PPM				(20L)			// Smaller changes are not worth an EEPROM write
+
+/*
+ * Private Function Prototypes
+ */
+
+static void measureDrift(uint32_t epochSecs);
+
+/*
+ * Private Variables
+ */
+
+static uint32_t s_epochSecs;
+static uint16_t s_msInSecond;
+static int32_t s_correction;	// In ms x ppm, so PPM is one millisecond
+
+static int32_t s_driftPpm;
+static int32_t s_savedDriftPpm;
+static bool s_haveDrift;
+uint32_t EEMEM s_driftPpmEEPROM = ERASED_EEPROM_DWORD;
+
+static bool s_isSet;
+static uint32_t s_syncEpochSecs;
+static uint32_t s_rawSecsSinceSync;
+static uint16_t s_rawMsSinceSync;
+
+/*
+ * Public Function Defintions
+ */
+
+void RTC_Init(void)
+{
+	uint32_t saved = eeprom_read_dword(&s_driftPpmEEPROM);
+	
+	s_haveDrift = (saved != ERASED_EEPROM_DWORD);
+	s_driftPpm = s_haveDrift ? (int32_t)saved : 0;
+	s_savedDriftPpm = s_driftPpm;
+	
+	s_epochSecs = 0UL;
+	s_msInSecond = 0U;
+	s_correction = 0L;
+	s_isSet = false;
+}
+
+void RTC_Tick(uint16_t ms)
+{
+	s_rawMsSinceSync += ms;
+	while (s_rawMsSinceSync >= MS_PER_SECOND)
+	{
+		s_rawMsSinceSync -= MS_PER_SECOND;
+		s_rawSecsSinceSync++;
+	}
+	
+	int32_t elapsed = ms;
+	
+	s_correction += (int32_t)ms * s_driftPpm;
+	if ((s_correction >= PPM) || (s_correction <= -PPM))
+	{
+		int32_t wholeMs = s_correction / PPM;
+		s_correction -= wholeMs * PPM;
+		elapsed += wholeMs;
+	}
+	
+	// A negative drift can never take back more than the tick itself
+	elapsed += s_msInSecond;
+	while (elapsed >= (int32_t)MS_PER_SECOND)
+	{
+		elapsed -= MS_PER_SECOND;
+		s_epochSecs++;
+	}
+	s_msInSecond = (elapsed > 0) ? (uint16_t)elapsed : 0U;
+}
+
+/*
+ * Sets the clock from the master, and measures the drift since the last
+ * sync if it was long enough ago to be meaningful.
+ */
+void RTC_Sync(uint32_t epochSecs)
+{
+	if (s_isSet && (s_rawSecsSinceSync < MIN_MEASURE_SECS))
+	{
+		// Too soon to measure: keep the earlier reference so the next sync spans longer
+		s_epochSecs = epochSecs;
+		s_msInSecond = 0U;
+		return;
+	}
+	
+	if (s_isSet && (s_rawSecsSinceSync <= MAX_MEASURE_SECS))
+	{
+		measureDrift(epochSecs);
+	}
+	
+	s_epochSecs = epochSecs;
+	s_msInSecond = 0U;
+	s_correction = 0L;
+	
+	s_isSet = true;
+	s_syncEpochSecs = epochSecs;
+	s_rawSecsSinceSync = 0UL;
+	s_rawMsSinceSync = 0U;
+}
+
+bool RTC_IsSet(void)
+{
+	return s_isSet;
+}
+
+uint32_t RTC_GetEpoch(void)
+{
+	return s_epochSecs;
+}
+
+uint16_t RTC_GetMinuteOfDay(void)
+{
+	return (uint16_t)((s_epochSecs % SECONDS_PER_DAY) / SECONDS_PER_MINUTE);
+}
+
+int32_t RTC_GetDriftPpm(void)
+{
+	return s_driftPpm;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void measureDrift(uint32_t epochSecs)
+{
+	uint32_t localSecs = s_rawSecsSinceSync + ((s_rawMsSinceSync >= (MS_PER_SECOND / 2U)) ? 1U : 0U);
+	int32_t errorSecs = (int32_t)(epochSecs - s_syncEpochSecs) - (int32_t)localSecs;
+	
+	// ppm = errorSecs * 10^6 / localSecs, split so nothing overflows 32 bits
+	int32_t ppm = (errorSecs / (int32_t)localSecs) * PPM;
+	int32_t remainder = errorSecs % (int32_t)localSecs;
+	ppm += (remainder * 1000L) / (int32_t)localSecs * 1000L;
+	ppm += (((remainder * 1000L) % (int32_t)localSecs) * 1000L) / (int32_t)localSecs;
+	
+	if ((ppm > RTC_MAX_DRIFT_PPM) || (ppm < -RTC_MAX_DRIFT_PPM))
+	{
+		// Not a plausible oscillator error, so the master's time must have jumped
+		return;
+	}
+	
+	// One second of sync error over the interval, in ppm
+	int32_t resolution = PPM / (int32_t)localSecs;
+	
+	if (s_haveDrift && (labs(ppm - s_driftPpm) <= (MAX_SYNC_ERROR_SECS * resolution)))
+	{
+		s_driftPpm += (ppm - s_driftPpm) / (1L << DRIFT_EWMA_SHIFT);
+	}
+	else
+	{
+		// First measurement, or the oscillator has changed by more than sync jitter explains
+		s_driftPpm = ppm;
+		s_haveDrift = true;
+	}
+	
+	if (labs(s_driftPpm - s_savedDriftPpm) >= DRIFT_SAVE_PPM)
+	{
+		s_savedDriftPpm = s_driftPpm;
+		eeprom_update_dword(&s_driftPpmEEPROM, (uint32_t)s_savedDriftPpm);
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef _RTC_H_
+#define _RTC_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define RTC_MAX_DRIFT_PPM			(200000L)	// Watchdog oscillator spread, with margin
+
+/*
+ * Public Function Prototypes
+ */
+
+void RTC_Init(void);
+
+void RTC_Tick(uint16_t ms);
+void RTC_Sync(uint32_t epochSecs);
+
+bool RTC_IsSet(void);
+uint32_t RTC_GetEpoch(void);
+uint16_t RTC_GetMinuteOfDay(void);
+int32_t RTC_GetDriftPpm(void);
+
+#endif
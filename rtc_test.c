@@ -0,0 +1,109 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "rtc.h"
+#include "host_test.h"
+
+/*
+ * Runs the clock for two weeks from a tick source that is off by a fixed
+ * rate, with a time sync from the master every six hours, and checks that
+ * the drift is learned and the error just before each sync shrinks to a
+ * few seconds. Ticks alternate between idle and comms lengths, as in the
+ * firmware.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define START_EPOCH				(1700000000UL)
+#define SIM_DAYS				(14L)
+#define SYNC_PERIOD_S			(6L * 3600L)
+#define SETTLE_DAYS				(2L)
+
+/*
+ * Private Function Prototypes
+ */
+
+static double run(double driftPpm, double * pLastErrorSecs);
+
+/*
+ * Private Variables
+ */
+
+static int failures = 0;
+
+int main(void)
+{
+	static const double drifts[] = { 50.0, -12000.0, 85000.0 };
+	
+	for (unsigned int i = 0; i < (sizeof(drifts) / sizeof(drifts[0])); ++i)
+	{
+		double lastError;
+		double uncorrected = fabs(drifts[i]) * SYNC_PERIOD_S / 1e6;
+		double worst = run(drifts[i], &lastError);
+		
+		printf("Tick error %+7.0fppm: uncorrected %6.1fs per sync, corrected worst %4.1fs after %ld days, last %3.1fs, learned %+7ldppm\n",
+			drifts[i], uncorrected, worst, SETTLE_DAYS, lastError, (long)RTC_GetDriftPpm());
+		
+		CHECK(labs(RTC_GetDriftPpm() - (long)drifts[i]) < 300);
+		CHECK(lastError < 3.0);
+	}
+	
+	// A master clock that jumps is not learned as drift
+	int32_t before = RTC_GetDriftPpm();
+	for (long s = 0; s < SYNC_PERIOD_S; ++s) { RTC_Tick(1000); }
+	RTC_Sync(RTC_GetEpoch() + 86400UL);
+	CHECK(RTC_GetDriftPpm() == before);
+	CHECK(RTC_GetMinuteOfDay() == ((RTC_GetEpoch() % 86400UL) / 60UL));
+	
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures;
+}
+
+/*
+ * Returns the worst error just before a sync, once the clock has had
+ * SETTLE_DAYS to learn the drift. Each run starts from the drift learned by
+ * the one before, as after moving a unit.
+ */
+static double run(double driftPpm, double * pLastErrorSecs)
+{
+	RTC_Init();
+	RTC_Sync(START_EPOCH);
+	
+	double trueSecs = 0.0;
+	double worst = 0.0;
+	long nextSync = SYNC_PERIOD_S;
+	long ticks = 0;
+	
+	while (trueSecs < (SIM_DAYS * 86400.0))
+	{
+		uint16_t ms = ((ticks++ % 16) == 0) ? 120 : 1000;
+		
+		RTC_Tick(ms);
+		trueSecs += (ms / 1000.0) * (1.0 + (driftPpm / 1e6));
+		
+		if (trueSecs >= nextSync)
+		{
+			double error = fabs(((double)RTC_GetEpoch() - START_EPOCH) - trueSecs);
+			
+			if (trueSecs > (SETTLE_DAYS * 86400.0) && (error > worst)) { worst = error; }
+			*pLastErrorSecs = error;
+			
+			RTC_Sync(START_EPOCH + (uint32_t)(trueSecs + 0.5));
+			nextSync += SYNC_PERIOD_S;
+		}
+	}
+	
+	return worst;
+}
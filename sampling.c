@@ -0,0 +1,125 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "detect_core.h"
+#include "sampling.h"
+
+/*
+ * Decides when the detect circuit is powered. While the pit is idle the
+ * circuit is gated: it is powered for one idle tick in every gatedPeriodTicks,
+ * and only the count from that tick is a sample. Whole ticks are used so the
+ * sample covers the same window as in continuous mode, and the filter sees
+ * the same counts.
+ *
+ * Any deviation seen by the filter switches straight to continuous sampling,
+ * which stays on until there has been no deviation for
+ * DETECT_STOPPED_DELAY_MS, as for the end of a flush.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Private Function Prototypes
+ */
+
+static void gate(void);
+
+/*
+ * Private Variables
+ */
+
+static uint8_t s_gatedPeriod;
+static uint8_t s_phase;
+
+static bool s_continuous;
+static bool s_circuitOn;
+static uint16_t s_quietMs;
+
+/*
+ * Public Function Defintions
+ */
+
+void Sampling_Init(uint8_t gatedPeriodTicks)
+{
+	s_gatedPeriod = gatedPeriodTicks;
+	
+	// Start continuous, to settle the filter before gating
+	s_continuous = true;
+	s_circuitOn = true;
+	s_quietMs = 0U;
+}
+
+/*
+ * Called at every idle tick. Returns true if the circuit was powered for the
+ * whole tick just ended, so its pulse count is a sample, and sets whether it
+ * is powered for the next one.
+ */
+bool Sampling_Tick(void)
+{
+	bool sample = s_circuitOn;
+	
+	if (!s_continuous)
+	{
+		if (++s_phase >= s_gatedPeriod) { s_phase = 0U; }
+		
+		// Power up for the last tick of each period
+		s_circuitOn = (s_phase == (s_gatedPeriod - 1U));
+	}
+	
+	return sample;
+}
+
+/*
+ * Called with the filter result for each sample.
+ */
+void Sampling_Result(bool deviation, uint16_t ms)
+{
+	if (deviation)
+	{
+		s_continuous = true;
+		s_circuitOn = true;
+		s_quietMs = 0U;
+	}
+	else if (s_continuous)
+	{
+		s_quietMs += ms;
+		
+		if (s_quietMs >= DETECT_STOPPED_DELAY_MS)
+		{
+			gate();
+		}
+	}
+}
+
+bool Sampling_IsCircuitOn(void)
+{
+	return s_circuitOn;
+}
+
+bool Sampling_IsContinuous(void)
+{
+	return s_continuous;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void gate(void)
+{
+	if (s_gatedPeriod <= 1U) { return; }
+	
+	s_continuous = false;
+	s_circuitOn = false;
+	s_phase = 0U;
+}
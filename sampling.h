@@ -0,0 +1,22 @@
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define SAMPLING_DEFAULT_GATED_PERIOD	(4U)	// Idle ticks per sample while gated
+
+/*
+ * Public Function Prototypes
+ */
+
+void Sampling_Init(uint8_t gatedPeriodTicks);
+
+bool Sampling_Tick(void);
+void Sampling_Result(bool deviation, uint16_t ms);
+
+bool Sampling_IsCircuitOn(void);
+bool Sampling_IsContinuous(void);
+
+#endif
@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Generic Library Includes
+ */
+
+#include "statemachine.h"
+#include "statemachinemanager.h"
+
+/*
+ * Local Application Includes
+ */
+
+#include "latrinesensor_sm.h"
+
+/*
+ * Compares the cost of dispatching the application's events through the
+ * generic statemachine runtime and through the switch dispatcher generated
+ * by sm_dispatch.h. Both are built from the same latrinesensor_sm.h tables,
+ * with actions that only count how often they run.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define REPORT_CYCLES	(200000UL)
+#define IDLE_TICKS		(20)	// Timer ticks between reports
+
+/*
+ * Private Function Prototypes
+ */
+
+static void onIdleState(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void onStateChange(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void wakeMaster(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void startWakeTimer(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void retryWake(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void abandonReport(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void sendData(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void testAndResetCount(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void testLevel(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+
+static void genericEvent(uint8_t e);
+static void generatedEvent(uint8_t e);
+static double runBenchmark(void (*raise)(uint8_t), unsigned long * pEvents);
+
+/*
+ * Generated dispatcher
+ */
+
+#define SM_DISPATCH_STATES			LATRINESENSOR_STATES
+#define SM_DISPATCH_TRANSITIONS		LATRINESENSOR_TRANSITIONS
+#define SM_DISPATCH_INITIAL_STATE	LATRINESENSOR_INITIAL_STATE
+#define SM_DISPATCH_NUMBER_OF_STATES	MAX_STATES
+#define SM_DISPATCH_NUMBER_OF_EVENTS	MAX_EVENTS
+#define SM_DISPATCH_MAX_QUEUED		LATRINESENSOR_MAX_QUEUED_EVENTS
+#include "sm_dispatch.h"
+
+/*
+ * Generic runtime table
+ */
+
+#define GENERIC_STATE(s, fn) [s] = {s, NULL, fn},
+#define GENERIC_ENTRY(s, e, fn, n) {&smStates[s], e, fn, &smStates[n]},
+
+static const SM_STATE smStates[] = {
+	LATRINESENSOR_STATES(GENERIC_STATE)
+};
+
+static const SM_ENTRY sm[] = {
+	LATRINESENSOR_TRANSITIONS(GENERIC_ENTRY)
+	{NULL,				(STATES)0,		NULL,			NULL}
+};
+
+/*
+ * Private Variables
+ */
+
+static int8_t smIndex;
+
+static volatile unsigned long s_actions;
+
+int main(int argc, char * argv[])
+{
+	(void)argc; (void)argv;
+
+	unsigned long genericEvents;
+	unsigned long generatedEvents;
+	unsigned long genericActions;
+	unsigned long generatedActions;
+
+	SMM_Config(1, 5);
+	smIndex = SM_Init(&smStates[IDLE], MAX_EVENTS, MAX_STATES, sm);
+	SM_SetActive(smIndex, true);
+
+	SMD_Init();
+
+	s_actions = 0;
+	double genericNs = runBenchmark(genericEvent, &genericEvents);
+	genericActions = s_actions;
+
+	s_actions = 0;
+	double generatedNs = runBenchmark(generatedEvent, &generatedEvents);
+	generatedActions = s_actions;
+
+	// Action counts can differ if the generic runtime also runs entry actions on self transitions
+	printf("generic:   %lu events, %lu actions, %.1f ns/event\n", genericEvents, genericActions, genericNs);
+	printf("generated: %lu events, %lu actions, %.1f ns/event\n", generatedEvents, generatedActions, generatedNs);
+	printf("Speedup: %.1fx\n", genericNs / generatedNs);
+
+	if (SM_GetState(smIndex) != SMD_GetState())
+	{
+		printf("FAILED: dispatchers finished in different states\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void genericEvent(uint8_t e)
+{
+	SM_Event(smIndex, e);
+}
+
+static void generatedEvent(uint8_t e)
+{
+	SMD_Event(e);
+}
+
+static double runBenchmark(void (*raise)(uint8_t), unsigned long * pEvents)
+{
+	struct timespec start;
+	struct timespec end;
+	unsigned long events = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long cycle = 0; cycle < REPORT_CYCLES; ++cycle)
+	{
+		// Idle ticks with no flush, including an event the idle state ignores
+		for (uint8_t tick = 0; tick < IDLE_TICKS; ++tick)
+		{
+			raise(TIMER);
+			raise(NO_DETECT);
+			events += 2;
+		}
+
+		// A flush report, with one unanswered WAKE on every other cycle
+		raise(DETECT);
+		raise(SEND_COMPLETE);
+		if (cycle & 1)
+		{
+			raise(TIMER);
+			events++;
+		}
+		raise(MASTER_READY);
+		raise(TIMER);
+		raise(SEND_COMPLETE);
+		events += 5;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	*pEvents = events;
+
+	double ns = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+	return ns / events;
+}
+
+static void onIdleState(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void onStateChange(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void wakeMaster(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void startWakeTimer(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void retryWake(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void abandonReport(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void sendData(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void testAndResetCount(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
+static void testLevel(SM_STATEID old, SM_STATEID new, SM_EVENT e) { (void)old; (void)new; (void)e; s_actions++; }
@@ -0,0 +1,20 @@
+NAME = sm_bench
+CC = gcc 
+FLAGS = -Wall -Wextra -O2 -DMEMORY_POOL_BYTES=4096 -std=c99
+
+LIBS_DIR = ../Libs
+
+INCLUDE_DIRS = \
+	-I$(LIBS_DIR)/Common \
+	-I$(LIBS_DIR)/Generics \
+	-I$(LIBS_DIR)/Utility
+
+CFILES = \
+	sm_bench.c \
+	$(LIBS_DIR)/Generics/memorypool.c \
+	$(LIBS_DIR)/Generics/statemachinemanager.c \
+	$(LIBS_DIR)/Generics/statemachine.c \
+	
+all:
+	$(CC) $(FLAGS) $(INCLUDE_DIRS) $(OPTS) $(CFILES) -o $(NAME).exe
+	$(NAME).exe
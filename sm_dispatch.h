@@ -0,0 +1,194 @@
+#ifndef _SM_DISPATCH_H_
+#define _SM_DISPATCH_H_
+
+/*
+ * Generates a state machine dispatcher at compile time from X-macro tables.
+ * Each event is a single switch on (state, event), which the compiler turns
+ * into a jump table or compare tree, with no table scan, no memory pool and
+ * no function pointers. Actions keep the statemachine.h signature, so the
+ * same functions work with either dispatcher.
+ *
+ * Before including this file, define:
+ *	SM_DISPATCH_STATES(X)		X(state, entryAction) for every state
+ *	SM_DISPATCH_TRANSITIONS(X)	X(state, event, action, nextState)
+ *	SM_DISPATCH_INITIAL_STATE
+ *	SM_DISPATCH_NUMBER_OF_STATES
+ *	SM_DISPATCH_NUMBER_OF_EVENTS
+ *	SM_DISPATCH_MAX_QUEUED		the most events raised by actions and not yet
+ *								handled at any one time, worked out from the
+ *								actions' longest chain of raised events
+ *	SM_DISPATCH_QUEUE_LENGTH	(optional, power of two, default the smallest
+ *								that holds SM_DISPATCH_MAX_QUEUED)
+ *
+ * Use SM_NO_ACTION for a transition or state with nothing to do.
+ *
+ * The tables are checked when compiling:
+ *	- a (state, event) pair listed twice is a duplicate case label
+ *	- every state must be listed exactly once in SM_DISPATCH_STATES
+ *	- every state and event must be in range
+ *	- every state that a transition enters must have a transition out of it
+ *	- every state with transitions out must be entered by one, or be initial
+ *	- the queue must hold SM_DISPATCH_MAX_QUEUED events
+ *
+ * Events raised from inside an action are queued and handled once the current
+ * transition (including the entry action) is complete. An event with no
+ * transition from the current state is ignored. An event raised with the
+ * queue full is dropped and counted, and stops a TEST_HARNESS build, since
+ * it means SM_DISPATCH_MAX_QUEUED is wrong and the machine may be left
+ * waiting for it.
+ *
+ * Defines the static functions SMD_Init, SMD_Event, SMD_GetState and
+ * SMD_GetDroppedEvents.
+ */
+
+#ifndef SM_DISPATCH_MAX_QUEUED
+#error "Define SM_DISPATCH_MAX_QUEUED before including sm_dispatch.h"
+#endif
+
+#ifndef SM_DISPATCH_QUEUE_LENGTH
+#define SM_DISPATCH_QUEUE_LENGTH	((SM_DISPATCH_MAX_QUEUED <= 2) ? 2 : ((SM_DISPATCH_MAX_QUEUED <= 4) ? 4 : ((SM_DISPATCH_MAX_QUEUED <= 8) ? 8 : 16)))
+#endif
+
+#ifdef TEST_HARNESS
+#include <assert.h>
+#endif
+
+#define SM_NO_ACTION	smdNoAction
+
+#define SMD_KEY(state, event)	((uint16_t)((uint16_t)(state) * SM_DISPATCH_NUMBER_OF_EVENTS) + (uint16_t)(event))
+
+/*
+ * Build time checks
+ */
+
+#define SMD_SOURCE_BIT(s, e, fn, n)		| (1U << (s))
+#define SMD_DEST_BIT(s, e, fn, n)		| (1U << (n))
+#define SMD_IN_RANGE(s, e, fn, n)		&& ((s) < SM_DISPATCH_NUMBER_OF_STATES) && ((n) < SM_DISPATCH_NUMBER_OF_STATES) && ((e) < SM_DISPATCH_NUMBER_OF_EVENTS)
+#define SMD_COUNT_STATE(s, fn)			+ 1
+
+enum smd_checks
+{
+	SMD_SOURCES = 0 SM_DISPATCH_TRANSITIONS(SMD_SOURCE_BIT),
+	SMD_DESTINATIONS = 0 SM_DISPATCH_TRANSITIONS(SMD_DEST_BIT),
+	SMD_STATE_COUNT = 0 SM_DISPATCH_STATES(SMD_COUNT_STATE)
+};
+
+typedef char SMD_CheckStateBitsFit[(SM_DISPATCH_NUMBER_OF_STATES <= 16) ? 1 : -1];
+typedef char SMD_CheckAllStatesListed[((int)SMD_STATE_COUNT == (int)SM_DISPATCH_NUMBER_OF_STATES) ? 1 : -1];
+typedef char SMD_CheckTransitionsInRange[(1 SM_DISPATCH_TRANSITIONS(SMD_IN_RANGE)) ? 1 : -1];
+typedef char SMD_CheckNoDeadEndStates[((SMD_DESTINATIONS & ~SMD_SOURCES) == 0) ? 1 : -1];
+typedef char SMD_CheckNoUnreachableStates[((SMD_SOURCES & ~(SMD_DESTINATIONS | (1U << SM_DISPATCH_INITIAL_STATE))) == 0) ? 1 : -1];
+typedef char SMD_CheckQueueLength[((SM_DISPATCH_QUEUE_LENGTH & (SM_DISPATCH_QUEUE_LENGTH - 1)) == 0) ? 1 : -1];
+typedef char SMD_CheckQueueHoldsRaisedEvents[(SM_DISPATCH_QUEUE_LENGTH >= SM_DISPATCH_MAX_QUEUED) ? 1 : -1];
+
+/*
+ * Private Function Prototypes
+ */
+
+static void smdNoAction(SM_STATEID old, SM_STATEID new, SM_EVENT e);
+static void smdDispatch(uint8_t e);
+
+/*
+ * Private Variables
+ */
+
+static uint8_t s_smdState;
+static uint8_t s_smdQueue[SM_DISPATCH_QUEUE_LENGTH];
+static uint8_t s_smdHead;
+static uint8_t s_smdTail;
+static bool s_smdBusy;
+static uint8_t s_smdDropped;
+
+/*
+ * Public Function Defintions
+ */
+
+static void SMD_Init(void)
+{
+	s_smdState = SM_DISPATCH_INITIAL_STATE;
+	s_smdHead = 0;
+	s_smdTail = 0;
+	s_smdBusy = false;
+	s_smdDropped = 0;
+}
+
+static SM_STATEID SMD_GetState(void)
+{
+	return (SM_STATEID)s_smdState;
+}
+
+/* Events dropped with the queue full since SMD_Init, saturating at 255 */
+static inline uint8_t SMD_GetDroppedEvents(void)
+{
+	return s_smdDropped;
+}
+
+static void SMD_Event(uint8_t e)
+{
+	if ((uint8_t)(s_smdHead - s_smdTail) == SM_DISPATCH_QUEUE_LENGTH)
+	{
+		if (s_smdDropped < UINT8_MAX) { s_smdDropped++; }
+#ifdef TEST_HARNESS
+		assert(!"sm_dispatch queue full: SM_DISPATCH_MAX_QUEUED is too small");
+#endif
+		return;
+	}
+
+	s_smdQueue[s_smdHead++ & (SM_DISPATCH_QUEUE_LENGTH - 1)] = e;
+
+	if (s_smdBusy) { return; } // Handled by the outer call once this transition completes
+
+	s_smdBusy = true;
+	while (s_smdTail != s_smdHead)
+	{
+		smdDispatch(s_smdQueue[s_smdTail++ & (SM_DISPATCH_QUEUE_LENGTH - 1)]);
+	}
+	s_smdBusy = false;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void smdNoAction(SM_STATEID old, SM_STATEID new, SM_EVENT e)
+{
+	(void)old; (void)new; (void)e;
+}
+
+#define SMD_TRANSITION_CASE(s, e, fn, n) \
+	case SMD_KEY(s, e): \
+		fn((s), (n), (e)); \
+		next = (n); \
+		break;
+
+#define SMD_ENTRY_CASE(s, fn) \
+	case (s): \
+		fn(old, (s), e); \
+		break;
+
+static void smdDispatch(uint8_t e)
+{
+	uint8_t old = s_smdState;
+	uint8_t next;
+
+	switch (SMD_KEY(old, e))
+	{
+	SM_DISPATCH_TRANSITIONS(SMD_TRANSITION_CASE)
+	default:
+		return;
+	}
+
+	s_smdState = next;
+
+	if (next != old)
+	{
+		switch (next)
+		{
+		SM_DISPATCH_STATES(SMD_ENTRY_CASE)
+		default:
+			break;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+ 
+#include <avr/eeprom.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "summary.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define DEFAULT_PERIOD_MINUTES		(0U) // Send every flush separately
+#define ERASED_EEPROM_WORD			(0xFFFFU)
+
+#define BUCKETS_PER_FRAME			(2)
+#define MAX_COUNT					(0xFFFU) // Three hex digits per bucket
+
+#define DURATION_FRAMES				(SUMMARY_DURATION_BUCKETS / BUCKETS_PER_FRAME)
+#define TIME_FRAMES					(SUMMARY_TIME_BUCKETS / BUCKETS_PER_FRAME)
+
+#define MS_PER_MINUTE				(60000UL)
+#define MINUTES_PER_DAY				(1440U)
+#define MINUTES_PER_TIME_BUCKET		(MINUTES_PER_DAY / SUMMARY_TIME_BUCKETS)
+
+/*
+ * Private Function Prototypes
+ */
+
+static uint8_t durationBucket(uint32_t durationMs);
+static void increment(uint16_t * count);
+static void writeHex3(char * msg, uint16_t value);
+
+/* 
+ * Private Variables
+ */
+ 
+static uint16_t s_periodMinutes;
+uint16_t EEMEM s_periodMinutesEEPROM = DEFAULT_PERIOD_MINUTES;
+
+static uint16_t s_durationCounts[SUMMARY_DURATION_BUCKETS];
+static uint16_t s_timeCounts[SUMMARY_TIME_BUCKETS];
+
+static uint16_t s_msInMinute;
+static uint16_t s_minutesToReport;
+
+static uint8_t s_frameIndex;
+
+/*
+ * Public Function Defintions
+ */
+
+void Summary_Init(void)
+{
+	s_periodMinutes = eeprom_read_word(&s_periodMinutesEEPROM);
+	
+	if (s_periodMinutes == ERASED_EEPROM_WORD)
+	{
+		s_periodMinutes = DEFAULT_PERIOD_MINUTES;
+	}
+	
+	s_minutesToReport = s_periodMinutes;
+	s_frameIndex = 0;
+}
+
+void Summary_SetPeriod(uint16_t minutes)
+{
+	s_periodMinutes = minutes;
+	s_minutesToReport = minutes;
+	eeprom_update_word(&s_periodMinutesEEPROM, s_periodMinutes);
+}
+
+bool Summary_IsEnabled(void)
+{
+	return s_periodMinutes > 0;
+}
+
+void Summary_AddFlush(uint32_t durationMs, uint16_t minuteOfDay)
+{
+	increment(&s_durationCounts[durationBucket(durationMs)]);
+	increment(&s_timeCounts[minuteOfDay / MINUTES_PER_TIME_BUCKET]);
+}
+
+/*
+ * Advances the report countdown. Returns true when a summary
+ * report is due.
+ */
+bool Summary_Tick(uint16_t ms)
+{
+	bool reportDue = false;
+	
+	s_msInMinute += ms;
+	
+	while (s_msInMinute >= MS_PER_MINUTE)
+	{
+		s_msInMinute -= MS_PER_MINUTE;
+		
+		if (Summary_IsEnabled() && (--s_minutesToReport == 0))
+		{
+			s_minutesToReport = s_periodMinutes;
+			reportDue = true;
+		}
+	}
+	
+	return reportDue;
+}
+
+/*
+ * Writes the next 9 character report body into msg: "HDn" or "HTn" followed
+ * by two buckets as three hex digits each, for duration frames n = 0 to 3
+ * and time of day frames n = 0 to 2. Returns false, and clears the
+ * histograms ready for the next period, once every frame has been written.
+ */
+bool Summary_WriteNextFrame(char * msg)
+{
+	uint16_t * counts;
+	uint8_t frame;
+	
+	if (s_frameIndex < DURATION_FRAMES)
+	{
+		frame = s_frameIndex;
+		counts = s_durationCounts;
+		msg[1] = 'D';
+	}
+	else if (s_frameIndex < (DURATION_FRAMES + TIME_FRAMES))
+	{
+		frame = s_frameIndex - DURATION_FRAMES;
+		counts = s_timeCounts;
+		msg[1] = 'T';
+	}
+	else
+	{
+		uint8_t i;
+		for (i = 0; i < SUMMARY_DURATION_BUCKETS; ++i) { s_durationCounts[i] = 0; }
+		for (i = 0; i < SUMMARY_TIME_BUCKETS; ++i) { s_timeCounts[i] = 0; }
+		s_frameIndex = 0;
+		return false;
+	}
+	
+	msg[0] = 'H';
+	msg[2] = '0' + frame;
+	writeHex3(&msg[3], counts[frame * BUCKETS_PER_FRAME]);
+	writeHex3(&msg[6], counts[(frame * BUCKETS_PER_FRAME) + 1]);
+	
+	s_frameIndex++;
+	
+	return true;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static uint8_t durationBucket(uint32_t durationMs)
+{
+	uint16_t secs = (durationMs > 65535000UL) ? 0xFFFFU : (uint16_t)((durationMs + 500U) / 1000U);
+	uint8_t bucket = 0;
+	
+	secs >>= 1;
+	while (secs && (bucket < (SUMMARY_DURATION_BUCKETS - 1)))
+	{
+		secs >>= 1;
+		bucket++;
+	}
+	
+	return bucket;
+}
+
+static void increment(uint16_t * count)
+{
+	if (*count < MAX_COUNT)
+	{
+		(*count)++;
+	}
+}
+
+static void writeHex3(char * msg, uint16_t value)
+{
+	for (int8_t i = 2; i >= 0; --i)
+	{
+		uint8_t nibble = value & 0x0F;
+		msg[i] = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
+		value >>= 4;
+	}
+}
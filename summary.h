@@ -0,0 +1,25 @@
+#ifndef _SUMMARY_H_
+#define _SUMMARY_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define SUMMARY_DURATION_BUCKETS	(8)	// Log2 of seconds: <2, <4, <8, ... , 128+
+#define SUMMARY_TIME_BUCKETS		(6)	// Four hour blocks
+
+/*
+ * Public Function Prototypes
+ */
+
+void Summary_Init(void);
+
+void Summary_SetPeriod(uint16_t minutes);
+bool Summary_IsEnabled(void);
+
+void Summary_AddFlush(uint32_t durationMs, uint16_t minuteOfDay);
+bool Summary_Tick(uint16_t ms);
+
+bool Summary_WriteNextFrame(char * msg);
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+
+#include <avr/eeprom.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tempsense.h"
+#include "tempcomp.h"
+
+/*
+ * Temperature compensation for the pulse count. The oscillator frequency is
+ * modelled as
+ *
+ *	count = bias + (kOutflow * dOutflow + kAmbient * dAmbient) / 256
+ *
+ * where dX is the temperature change in tenths of a degree since the first
+ * call to TComp_Apply. TComp_Apply removes the temperature terms so the flush
+ * filter sees a flat baseline. It latches its reference temperatures on that
+ * first call, so callers must not call it until both sensors have a real
+ * reading (TS_HasReadings); the power up value of 0 would be taken as 0 C.
+ * TComp_Learn updates the bias and coefficients by sign-sign LMS, which needs
+ * only integer adds and is not thrown off by the size of the count noise. It
+ * must only be called for samples known to be idle, and does nothing until
+ * TComp_Apply has been called.
+ *
+ * The coefficients belong to the unit, so they are kept in EEPROM. The bias
+ * depends on the reference temperatures and is relearned every boot.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define MU_BIAS				(1)		// Q4 counts per sample
+#define MU_COEFF			(4)		// Q8 counts per tenth of a degree per sample
+#define MIN_LEARN_DELTA		(5)		// Smaller temperature changes are too noisy to learn from
+#define MAX_DELTA			(1000)	// Limit on temperature change used, in tenths
+
+#define SAVE_PERIOD_SAMPLES	(3600U)	// Idle samples between EEPROM updates
+
+#define ERASED_WORD			(0xFFFFU)
+
+#define NUMBER_OF_SENSORS	(2)
+
+/*
+ * Private Function Prototypes
+ */
+
+static int16_t signOf(int32_t value);
+
+/*
+ * Private Variables
+ */
+
+static int16_t s_coeff[NUMBER_OF_SENSORS];
+uint16_t EEMEM s_coeffEEPROM[NUMBER_OF_SENSORS] = {0U, 0U};
+
+static TENTHSDEGC s_reference[NUMBER_OF_SENSORS];
+static bool s_referenceValid;
+
+static int32_t s_biasQ4;
+static bool s_biasValid;
+
+static int16_t s_lastDelta[NUMBER_OF_SENSORS];
+static int32_t s_lastCorrection;
+static uint16_t s_lastCount;
+
+static uint16_t s_samplesToSave;
+
+/*
+ * Public Function Defintions
+ */
+
+void TComp_Init(void)
+{
+	for (uint8_t i = 0; i < NUMBER_OF_SENSORS; ++i)
+	{
+		uint16_t saved = eeprom_read_word(&s_coeffEEPROM[i]);
+		s_coeff[i] = (saved == ERASED_WORD) ? 0 : (int16_t)saved;
+	}
+
+	s_referenceValid = false;
+	s_biasValid = false;
+	s_samplesToSave = SAVE_PERIOD_SAMPLES;
+}
+
+uint16_t TComp_Apply(uint16_t count, TENTHSDEGC outflow, TENTHSDEGC ambient)
+{
+	TENTHSDEGC temperatures[NUMBER_OF_SENSORS] = {outflow, ambient};
+
+	if (!s_referenceValid)
+	{
+		s_reference[SENSOR_OUTFLOW] = outflow;
+		s_reference[SENSOR_AMBIENT] = ambient;
+		s_referenceValid = true;
+	}
+
+	int32_t correction = 0;
+
+	for (uint8_t i = 0; i < NUMBER_OF_SENSORS; ++i)
+	{
+		int16_t delta = temperatures[i] - s_reference[i];
+		if (delta > MAX_DELTA) { delta = MAX_DELTA; }
+		if (delta < -MAX_DELTA) { delta = -MAX_DELTA; }
+
+		s_lastDelta[i] = delta;
+		correction += (int32_t)s_coeff[i] * delta;
+	}
+
+	correction /= 256;
+
+	s_lastCorrection = correction;
+	s_lastCount = count;
+
+	int32_t compensated = (int32_t)count - correction;
+	if (compensated < 0) { compensated = 0; }
+	if (compensated > UINT16_MAX) { compensated = UINT16_MAX; }
+
+	return (uint16_t)compensated;
+}
+
+void TComp_Learn(void)
+{
+	if (!s_referenceValid)
+	{
+		// Nothing compensated yet, so there is no sample to learn from
+		return;
+	}
+
+	if (!s_biasValid)
+	{
+		s_biasQ4 = ((int32_t)s_lastCount - s_lastCorrection) * 16;
+		s_biasValid = true;
+		return;
+	}
+
+	int32_t prediction = (s_biasQ4 / 16) + s_lastCorrection;
+	int16_t errorSign = signOf((int32_t)s_lastCount - prediction);
+
+	s_biasQ4 += errorSign * MU_BIAS;
+
+	for (uint8_t i = 0; i < NUMBER_OF_SENSORS; ++i)
+	{
+		if (abs(s_lastDelta[i]) >= MIN_LEARN_DELTA)
+		{
+			int16_t coeff = s_coeff[i] + (errorSign * signOf(s_lastDelta[i]) * MU_COEFF);
+			if (coeff > TCOMP_COEFF_LIMIT) { coeff = TCOMP_COEFF_LIMIT; }
+			if (coeff < -TCOMP_COEFF_LIMIT) { coeff = -TCOMP_COEFF_LIMIT; }
+			s_coeff[i] = coeff;
+		}
+	}
+
+	if (--s_samplesToSave == 0U)
+	{
+		s_samplesToSave = SAVE_PERIOD_SAMPLES;
+		for (uint8_t i = 0; i < NUMBER_OF_SENSORS; ++i)
+		{
+			eeprom_update_word(&s_coeffEEPROM[i], (uint16_t)s_coeff[i]);
+		}
+	}
+}
+
+int16_t TComp_GetCoefficient(TEMPERATURE_SENSOR eSensor)
+{
+	return s_coeff[eSensor];
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static int16_t signOf(int32_t value)
+{
+	return (value > 0) ? 1 : ((value < 0) ? -1 : 0);
+}
@@ -0,0 +1,25 @@
+#ifndef _TEMPCOMP_H_
+#define _TEMPCOMP_H_
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Coefficients are the change in pulse count per tenth of a degree, in Q8.
+ * Values this size are about 16 counts per tenth of a degree.
+ */
+#define TCOMP_COEFF_LIMIT		(4096)
+
+/*
+ * Public Function Prototypes
+ */
+
+void TComp_Init(void);
+
+uint16_t TComp_Apply(uint16_t count, TENTHSDEGC outflow, TENTHSDEGC ambient);
+void TComp_Learn(void);
+
+int16_t TComp_GetCoefficient(TEMPERATURE_SENSOR eSensor);
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "detect_core.h"
+#include "tempsense.h"
+#include "tempcomp.h"
+#include "host_test.h"
+
+/*
+ * Replays a simulated day of pulse counts with temperature driven drift
+ * through the flush detector, with and without temperature compensation.
+ *
+ * The pipe temperature falls whenever cold water passes and recovers slowly
+ * afterwards, and also has transients with no flow. The ambient temperature
+ * follows a daily cycle. Both shift the oscillator baseline, and the slow
+ * recovery after a flush looks like continued flow to an uncompensated filter.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define SIM_SECONDS				(86400L)
+#define WARMUP_SECONDS			(7200L)		// Learning time before scoring starts
+
+#define OUTFLOW_COUNTS_PER_TENTH	(6.0)
+#define AMBIENT_COUNTS_PER_TENTH	(2.0)
+
+#define WATER_TENTHS			(100.0)
+
+#define PI						(3.14159265358979)
+
+#define FLUSH_PERIOD_S			(1200L)
+#define TRANSIENT_PERIOD_S		(2900L)
+
+#define TIGHT_THRESHOLD			(250U)
+#define TIGHT_IDLE_SAMPLES		(4U)
+
+#define MAX_FLUSHES				((SIM_SECONDS / FLUSH_PERIOD_S) + 1)
+
+struct pipeline
+{
+	const char * name;
+	DETECT_FILTER filter;
+	DETECT_FLUSH flush;
+	uint16_t threshold;
+	bool compensated;
+	long episodeStart;
+	bool inEpisode;
+	SIM_SCORE score;
+	uint8_t matched[MAX_FLUSHES];
+};
+typedef struct pipeline PIPELINE;
+
+/*
+ * Private Function Prototypes
+ */
+
+static void pipelineInit(PIPELINE * p, const char * name, uint16_t threshold, uint8_t idleSamples, bool compensated);
+static void pipelineSample(PIPELINE * p, long t, uint16_t count, TENTHSDEGC outflow, TENTHSDEGC ambient);
+
+/*
+ * Private Variables
+ */
+
+static SIM_FLUSH s_flushes[MAX_FLUSHES];
+static long s_numberOfFlushes;
+
+int main(int argc, char * argv[])
+{
+	(void)argc; (void)argv;
+
+	int failures = 0;
+
+	PIPELINE pipelines[3];
+	pipelineInit(&pipelines[0], "default", DETECT_DEFAULT_THRESHOLD, DETECT_IDLE_SAMPLES, false);
+	pipelineInit(&pipelines[1], "tight", TIGHT_THRESHOLD, TIGHT_IDLE_SAMPLES, false);
+	pipelineInit(&pipelines[2], "tight+comp", TIGHT_THRESHOLD, TIGHT_IDLE_SAMPLES, true);
+
+	// EEPROM is the host stand-in in Host/avr/eeprom.h, so the coefficients start from their defaults
+	TComp_Init();
+
+	srand(1);
+
+	double outflow = 200.0;
+	double ambient = 200.0;
+	TENTHSDEGC ambientReading = 200;
+	double flow = 0.0;
+
+	for (long t = 0; t < SIM_SECONDS; ++t)
+	{
+		long sinceFlush = t % FLUSH_PERIOD_S;
+		long flushLength = 6 + ((t / FLUSH_PERIOD_S) % 5) * 4;
+		bool flowing = (t > 600) && (sinceFlush < flushLength);
+		bool transient = (t % TRANSIENT_PERIOD_S) < 40;
+
+		if ((t > 600) && (sinceFlush == 0))
+		{
+			s_flushes[s_numberOfFlushes].start = t;
+			s_flushes[s_numberOfFlushes].end = t + flushLength;
+			s_numberOfFlushes++;
+		}
+
+		ambient = 200.0 + 80.0 * sin(2.0 * PI * t / 86400.0);
+
+		if (flowing || transient)
+		{
+			outflow += (WATER_TENTHS - outflow) / 10.0;
+		}
+		else
+		{
+			outflow += (ambient - outflow) / 300.0;
+		}
+
+		flow += ((flowing ? SIM_FLOW_DROP_COUNTS : 0.0) - flow) / 2.0;
+
+		double count = SIM_BASE_COUNT
+			+ OUTFLOW_COUNTS_PER_TENTH * (outflow - 200.0)
+			+ AMBIENT_COUNTS_PER_TENTH * (ambient - 200.0)
+			- flow
+			+ Sim_Noise();
+
+		// The firmware reads the outflow sensor every second and ambient every five
+		if ((t % 5) == 0) { ambientReading = (TENTHSDEGC)lround(ambient); }
+
+		for (int i = 0; i < 3; ++i)
+		{
+			pipelineSample(&pipelines[i], t, (uint16_t)lround(count), (TENTHSDEGC)lround(outflow), ambientReading);
+		}
+	}
+
+	uint32_t scoredFlushes = 0;
+	for (long i = 0; i < s_numberOfFlushes; ++i)
+	{
+		if (s_flushes[i].start >= WARMUP_SECONDS) { scoredFlushes++; }
+	}
+
+	printf("%u flushes after warm up\n", scoredFlushes);
+	printf("Learned coefficients (Q8): outflow %d, ambient %d\n",
+		TComp_GetCoefficient(SENSOR_OUTFLOW), TComp_GetCoefficient(SENSOR_AMBIENT));
+
+	for (int i = 0; i < 3; ++i)
+	{
+		PIPELINE * p = &pipelines[i];
+		printf("%-11s threshold %3u, idle window %2u: %3u detected, %3u false, %3u split, mean duration error %.1fs\n",
+			p->name, p->threshold, p->filter.idle.length, p->score.detected, p->score.falseFlushes, p->score.splits,
+			p->score.detected ? (double)p->score.durationError / p->score.detected : 0.0);
+	}
+
+	// Without compensation the cooled pipe looks like flow and stretches every flush,
+	// most of all with tight settings. With it every flush is found to within a few seconds.
+	CHECK(pipelines[2].score.falseFlushes == 0);
+	CHECK(pipelines[2].score.detected == scoredFlushes);
+	CHECK(pipelines[2].score.durationError <= (long)(2 * scoredFlushes));
+	CHECK(pipelines[1].score.durationError > 10 * pipelines[2].score.durationError);
+	CHECK(pipelines[0].score.durationError > 10 * pipelines[2].score.durationError);
+
+	// The outflow coefficient is well determined, ambient is partly collinear with it
+	CHECK(abs(TComp_GetCoefficient(SENSOR_OUTFLOW) - (int)(OUTFLOW_COUNTS_PER_TENTH * 256)) < 256);
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static void pipelineInit(PIPELINE * p, const char * name, uint16_t threshold, uint8_t idleSamples, bool compensated)
+{
+	p->name = name;
+	p->threshold = threshold;
+	p->compensated = compensated;
+	p->inEpisode = false;
+	memset(&p->score, 0, sizeof(p->score));
+	memset(p->matched, 0, sizeof(p->matched));
+	Detect_FilterInit(&p->filter, idleSamples);
+	Detect_FlushReset(&p->flush);
+}
+
+static void pipelineSample(PIPELINE * p, long t, uint16_t count, TENTHSDEGC outflow, TENTHSDEGC ambient)
+{
+	if (p->compensated)
+	{
+		count = TComp_Apply(count, outflow, ambient);
+	}
+
+	bool flushing = Detect_FilterNewValue(&p->filter, count, p->threshold);
+	bool stopped = Detect_FlushUpdate(&p->flush, DETECT_SAMPLE_MS, flushing);
+
+	if (flushing && !p->inEpisode)
+	{
+		p->inEpisode = true;
+		p->episodeStart = t;
+	}
+
+	if (stopped)
+	{
+		if (Detect_FlushTriggered(&p->flush) && (p->episodeStart >= WARMUP_SECONDS))
+		{
+			long end = t - (DETECT_STOPPED_DELAY_MS / DETECT_SAMPLE_MS);
+			Sim_Score(&p->score, s_flushes, p->matched, s_numberOfFlushes, p->episodeStart, end, Detect_FlushDurationMs(&p->flush));
+		}
+
+		Detect_FlushReset(&p->flush);
+		p->inEpisode = false;
+
+		if (p->compensated)
+		{
+			// Only learn from samples well away from any flush
+			TComp_Learn();
+		}
+	}
+}
@@ -17,6 +17,10 @@
 
 #include "tempsense.h"
 
+#ifdef AVR_BENCH
+#include "avr_bench.h"
+#endif
+
 /*
  * AVR Library Includes
  */
@@ -34,7 +38,7 @@
  * Defines and typedefs
  */
  
-#define AMBIENT_ADC_TICK_SECS		(5)
+#define AMBIENT_ADC_TICK_MS			(5000)
 #define OUTFLOW_ADC_TICK_MS			(1000)
 
 #define RTHERM						(10000UL)
@@ -61,9 +65,11 @@ static LIB_ADC_CHANNEL_ENUM channels[2] = {
 };
 
 static TENTHSDEGC readings[2] = {0, 0};
+static uint16_t rawReadings[2] = {0, 0};
+static uint8_t s_converted = 0U;	// A bit per sensor, set by its first conversion
 
-// Ambient countdown is in seconds, the other in milliseconds
-static int16_t countdowns[] = {OUTFLOW_ADC_TICK_MS, 0};
+static const int16_t s_periods[] = {OUTFLOW_ADC_TICK_MS, AMBIENT_ADC_TICK_MS};
+static int16_t countdowns[] = {0, 0};
 
 static THERMISTOR thermistor;
 static POT_DIVIDER divider;
@@ -90,14 +96,10 @@ void TS_Setup(void)
 	(void)POTDIVIDER_Init(&divider, 1023, RPULLUP, PULLUP);
 }
 
-void TS_AmbientTimerTick(uint8_t seconds)
-{
-	countdowns[SENSOR_AMBIENT] -= seconds;
-}
-
-void TS_OutflowTimerTick(uint8_t milliseconds)
+void TS_TimerTick(uint16_t milliseconds)
 {
 	countdowns[SENSOR_OUTFLOW] -= milliseconds;
+	countdowns[SENSOR_AMBIENT] -= milliseconds;
 }
 
 bool TS_IsTimeForAmbientRead(void)
@@ -112,14 +114,30 @@ bool TS_IsTimeForOutflowRead(void)
 
 void TS_Check(void)
 {
-	if (ADC_TestAndClear(&adc))
+	if (TS_TakeConversion())
 	{
-		countdowns[SENSOR_OUTFLOW] = OUTFLOW_ADC_TICK_MS;
-		countdowns[SENSOR_AMBIENT] = AMBIENT_ADC_TICK_SECS;
-		readings[currentSensor] = convertToTenthsOfDegrees(adc.reading);
+		TS_HandleConversion();
 	}
 }
 
+/*
+ * Returns true once when a conversion has completed. Cheap enough to call
+ * with interrupts disabled; the reading is converted by TS_HandleConversion,
+ * which must be called before the next TS_StartConversion.
+ */
+bool TS_TakeConversion(void)
+{
+	return ADC_TestAndClear(&adc);
+}
+
+void TS_HandleConversion(void)
+{
+	countdowns[currentSensor] = s_periods[currentSensor];
+	rawReadings[currentSensor] = adc.reading;
+	readings[currentSensor] = convertToTenthsOfDegrees(adc.reading);
+	s_converted |= (1U << currentSensor);
+}
+
 void TS_StartConversion(TEMPERATURE_SENSOR eSensor)
 {
 	if (!adc.busy)
@@ -135,11 +153,32 @@ TENTHSDEGC TS_GetTemperature(TEMPERATURE_SENSOR eSensor)
 	return readings[eSensor];
 }
 
+/*
+ * Returns true once both sensors have been converted. Until then
+ * TS_GetTemperature returns 0 for a sensor not yet read.
+ */
+bool TS_HasReadings(void)
+{
+	return (s_converted == ((1U << SENSOR_OUTFLOW) | (1U << SENSOR_AMBIENT)));
+}
+
+uint16_t TS_GetRawReading(TEMPERATURE_SENSOR eSensor)
+{
+	return rawReadings[eSensor];
+}
+
 bool TS_ConversionStarted(void)
 {
 	return adc.busy;
 }
 
+#ifdef AVR_BENCH
+TENTHSDEGC TS_BenchConvert(uint16_t reading)
+{
+	return convertToTenthsOfDegrees(reading);
+}
+#endif
+
 /*
  * Private Function Definitions
  */
@@ -20,9 +20,10 @@ typedef enum temperature_sensor TEMPERATURE_SENSOR;
  
 void TS_Setup(void);
 void TS_Check(void);
+bool TS_TakeConversion(void);
+void TS_HandleConversion(void);
 
-void TS_AmbientTimerTick(uint8_t seconds);
-void TS_OutflowTimerTick(uint8_t milliseconds);
+void TS_TimerTick(uint16_t milliseconds);
 
 bool TS_IsTimeForAmbientRead(void);
 bool TS_IsTimeForOutflowRead(void);
@@ -31,5 +32,7 @@ bool TS_ConversionStarted(void);
 
 void TS_StartConversion(TEMPERATURE_SENSOR eSensor);
 TENTHSDEGC TS_GetTemperature(TEMPERATURE_SENSOR eSensor);
+bool TS_HasReadings(void);
+uint16_t TS_GetRawReading(TEMPERATURE_SENSOR eSensor);
 
 #endif
@@ -12,7 +12,8 @@ INCLUDE_DIRS = \
 	-I$(LIBS_DIR)/Generics \
 	-I$(LIBS_DIR)/Protocols \
 	-I$(LIBS_DIR)/Utility \
-	-I$(LIBS_DIR)/Utility/libfixmath/libfixmath
+	-I$(LIBS_DIR)/Utility/libfixmath/libfixmath \
+	-IArduino/libraries/LatrineSensor/src
 
 CFILES = \
 	app_test_harness.c \
@@ -20,7 +21,18 @@ CFILES = \
 	comms.c \
 	tempsense.c \
 	flush_counter.c \
+	flush_chain.c \
 	filter.c \
+	memcheck.c \
+	capture.c \
+	summary.c \
+	tempcomp.c \
+	pitlevel.c \
+	txsched.c \
+	rtc.c \
+	sampling.c \
+	evqueue.c \
+	baseline.c \
 	$(LIBS_DIR)/AVR/lib_io.c \
 	$(LIBS_DIR)/AVR/lib_fuses.c \
 	$(LIBS_DIR)/AVR/lib_sleep.c \
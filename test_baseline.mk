@@ -0,0 +1,18 @@
+NAME = baseline_test
+CC = gcc 
+FLAGS = -Wall -Wextra -DTEST_HARNESS -std=c99
+
+LIBS_DIR = ../Libs
+
+INCLUDE_DIRS = \
+	-I$(LIBS_DIR)/AVR/Harness \
+	-I$(LIBS_DIR)/Utility \
+	-IArduino/libraries/LatrineSensor/src
+
+CFILES = \
+	baseline_test.c \
+	baseline.c \
+	
+all:
+	$(CC) $(FLAGS) $(INCLUDE_DIRS) $(OPTS) $(CFILES) -lm -o $(NAME).exe
+	$(NAME).exe
@@ -0,0 +1,11 @@
+NAME = evqueue_test
+CC = gcc 
+FLAGS = -Wall -Wextra -O2 -pthread -DTEST_HARNESS -std=c99
+
+CFILES = \
+	evqueue_test.c \
+	evqueue.c \
+	
+all:
+	$(CC) $(FLAGS) $(OPTS) $(CFILES) -o $(NAME).exe
+	$(NAME).exe
@@ -5,6 +5,7 @@ FLAGS = -Wall -Wextra -DTEST_HARNESS -DMEMORY_POOL_BYTES=4096 -std=c99
 LIBS_DIR = ../Libs
 
 INCLUDE_DIRS = \
+	-IHost \
 	-I$(LIBS_DIR)/AVR \
 	-I$(LIBS_DIR)/AVR/Harness \
 	-I$(LIBS_DIR)/Common \
@@ -12,15 +13,22 @@ INCLUDE_DIRS = \
 	-I$(LIBS_DIR)/Generics \
 	-I$(LIBS_DIR)/Protocols \
 	-I$(LIBS_DIR)/Utility \
-	-I$(LIBS_DIR)/Utility/libfixmath/libfixmath
+	-I$(LIBS_DIR)/Utility/libfixmath/libfixmath \
+	-IArduino/libraries/LatrineSensor/src
 
 CFILES = \
 	filter_test.c \
 	filter.c \
-	$(LIBS_DIR)/Generics/averager.c \
+	threshold.c \
 	$(LIBS_DIR)/Generics/memorypool.c \
 	$(LIBS_DIR)/Utility/util_sequence_generator.c \
 	
-all:
-	$(CC) $(FLAGS) $(INCLUDE_DIRS) $(OPTS) $(CFILES) -o $(NAME).exe
+all: build
 	$(NAME).exe
+
+# Scores the detector with and without the median pre-filter on noisy input
+compare: build
+	$(NAME).exe compare
+
+build:
+	$(CC) $(FLAGS) -O2 $(INCLUDE_DIRS) $(OPTS) $(CFILES) -o $(NAME).exe
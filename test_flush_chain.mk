@@ -0,0 +1,29 @@
+NAME = flush_chain_test
+CC = gcc
+FLAGS = -Wall -Wextra -DTEST_HARNESS -std=c99
+
+LIBS_DIR = ../Libs
+
+INCLUDE_DIRS = \
+	-IHost \
+	-I$(LIBS_DIR)/AVR/Harness \
+	-I$(LIBS_DIR)/Utility \
+	-IArduino/libraries/LatrineSensor/src
+
+CFILES = \
+	flush_chain_test.c \
+	flush_chain.c \
+	threshold.c \
+	tempcomp.c \
+	filter.c \
+	flush_counter.c \
+	summary.c \
+	pitlevel.c \
+	txsched.c \
+	rtc.c \
+	sampling.c \
+	baseline.c \
+
+all:
+	$(CC) $(FLAGS) $(INCLUDE_DIRS) $(OPTS) $(CFILES) -lm -o $(NAME).exe
+	$(NAME).exe
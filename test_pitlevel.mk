@@ -0,0 +1,19 @@
+NAME = pitlevel_test
+CC = gcc 
+FLAGS = -Wall -Wextra -DTEST_HARNESS -std=c99
+
+LIBS_DIR = ../Libs
+
+INCLUDE_DIRS = \
+	-IHost \
+	-I$(LIBS_DIR)/AVR/Harness \
+	-I$(LIBS_DIR)/Utility \
+	-IArduino/libraries/LatrineSensor/src
+
+CFILES = \
+	pitlevel_test.c \
+	pitlevel.c \
+	
+all:
+	$(CC) $(FLAGS) $(INCLUDE_DIRS) $(OPTS) $(CFILES) -lm -o $(NAME).exe
+	$(NAME).exe
@@ -0,0 +1,19 @@
+NAME = rtc_test
+CC = gcc 
+FLAGS = -Wall -Wextra -DTEST_HARNESS -std=c99
+
+LIBS_DIR = ../Libs
+
+INCLUDE_DIRS = \
+	-IHost \
+	-I$(LIBS_DIR)/AVR/Harness \
+	-I$(LIBS_DIR)/Utility \
+	-IArduino/libraries/LatrineSensor/src
+
+CFILES = \
+	rtc_test.c \
+	rtc.c \
+	
+all:
+	$(CC) $(FLAGS) $(INCLUDE_DIRS) $(OPTS) $(CFILES) -lm -o $(NAME).exe
+	$(NAME).exe
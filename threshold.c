@@ -21,7 +21,8 @@
  * Defines and typedefs
  */
 
-#define DEFAULT_THRESHOLD 500U;
+// Tighter than the uncompensated DETECT_DEFAULT_THRESHOLD
+#define DEFAULT_THRESHOLD (250U)
 
 /* 
  * Private Variables
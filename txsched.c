@@ -0,0 +1,223 @@
+/*
+ * Standard Library Includes
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * AVR Includes (Defines and Primitives)
+ */
+
+#include <avr/eeprom.h>
+
+/*
+ * Local Application Includes
+ */
+
+#include "tempsense.h"
+#include "txsched.h"
+
+/*
+ * Transmit scheduler for flush reports. Completed flushes are queued, and a
+ * batch is sent once it has been held for long enough, or the queue fills.
+ *
+ * The hold time adapts to a running average of the time between flushes.
+ * When flushes are sparse (under two expected within the latency budget) a
+ * report is sent at once. When they are dense the batch is held for long
+ * enough to fill at the current rate, but never longer than the budget.
+ */
+
+/*
+ * Defines and typedefs
+ */
+
+#define ERASED_EEPROM_WORD			(0xFFFFU)
+
+#define INTERVAL_EWMA_SHIFT			(2)			// New interval has a weight of 1/4
+#define SPARSE_INTERVAL_S			(0xFFFFU)	// Assumed until two flushes have been seen
+
+#define MIN_RETRY_S					(60U)
+
+#define MS_PER_SECOND				(1000U)
+
+/*
+ * Private Function Prototypes
+ */
+
+static uint16_t holdSeconds(void);
+static uint16_t ageOf(const TXSCHED_RECORD * pRecord);
+
+/*
+ * Private Variables
+ */
+
+static TXSCHED_RECORD s_records[TXSCHED_MAX_RECORDS];
+static uint8_t s_head;
+static uint8_t s_count;
+
+static uint16_t s_budget;
+uint16_t EEMEM s_budgetEEPROM = TXSCHED_DEFAULT_BUDGET_S;
+
+static uint16_t s_msInSecond;
+static uint32_t s_nowSecs;	// Does not wrap in the life of the batteries
+
+static uint32_t s_batchStartSecs;
+static uint16_t s_holdSecs;
+
+static bool s_seenFlush;
+static uint32_t s_lastFlushSecs;
+static uint16_t s_meanIntervalSecs;
+
+/*
+ * Public Function Defintions
+ */
+
+void TxSched_Init(void)
+{
+	s_budget = eeprom_read_word(&s_budgetEEPROM);
+
+	if (s_budget == ERASED_EEPROM_WORD)
+	{
+		s_budget = TXSCHED_DEFAULT_BUDGET_S;
+	}
+
+	s_head = 0;
+	s_count = 0;
+	s_seenFlush = false;
+	s_meanIntervalSecs = SPARSE_INTERVAL_S;
+}
+
+void TxSched_SetBudget(uint16_t seconds)
+{
+	s_budget = seconds;
+	eeprom_update_word(&s_budgetEEPROM, s_budget);
+}
+
+uint16_t TxSched_GetBudget(void)
+{
+	return s_budget;
+}
+
+void TxSched_AddFlush(uint16_t durationSecs, TENTHSDEGC outflow)
+{
+	if (s_seenFlush)
+	{
+		uint32_t sinceLast = s_nowSecs - s_lastFlushSecs;
+		int32_t interval = (sinceLast > SPARSE_INTERVAL_S) ? (int32_t)SPARSE_INTERVAL_S : (int32_t)sinceLast;
+		int32_t mean = s_meanIntervalSecs;
+		mean += (interval - mean) >> INTERVAL_EWMA_SHIFT;
+		s_meanIntervalSecs = (uint16_t)mean;
+	}
+
+	s_seenFlush = true;
+	s_lastFlushSecs = s_nowSecs;
+
+	if (s_count == TXSCHED_MAX_RECORDS)
+	{
+		// Only happens while the master is unreachable: drop the oldest
+		s_head = (s_head + 1U) % TXSCHED_MAX_RECORDS;
+		s_count--;
+	}
+
+	if (s_count == 0U)
+	{
+		s_batchStartSecs = s_nowSecs;
+		s_holdSecs = holdSeconds();
+	}
+
+	TXSCHED_RECORD * pRecord = &s_records[(s_head + s_count) % TXSCHED_MAX_RECORDS];
+	pRecord->durationSecs = durationSecs;
+	pRecord->completedSecs = s_nowSecs;
+	pRecord->outflow = outflow;
+	s_count++;
+}
+
+void TxSched_Tick(uint16_t ms)
+{
+	s_msInSecond += ms;
+
+	while (s_msInSecond >= MS_PER_SECOND)
+	{
+		s_msInSecond -= MS_PER_SECOND;
+		s_nowSecs++;
+	}
+}
+
+bool TxSched_IsDue(void)
+{
+	if (s_count == 0U) { return false; }
+
+	if (s_count == TXSCHED_MAX_RECORDS) { return true; }
+
+	return (s_nowSecs - s_batchStartSecs) >= s_holdSecs;
+}
+
+uint8_t TxSched_Pending(void)
+{
+	return s_count;
+}
+
+/*
+ * Seconds since the oldest queued flush finished, or 0 when the queue is empty.
+ */
+uint16_t TxSched_GetOldestAgeSecs(void)
+{
+	return (s_count == 0U) ? 0U : ageOf(&s_records[s_head]);
+}
+
+/*
+ * Removes the oldest queued record, once it is being sent. Returns false when
+ * the queue is empty.
+ */
+bool TxSched_TakeRecord(TXSCHED_RECORD * pRecord, uint16_t * pAgeSecs)
+{
+	if (s_count == 0U) { return false; }
+
+	*pRecord = s_records[s_head];
+	*pAgeSecs = ageOf(pRecord);
+
+	s_head = (s_head + 1U) % TXSCHED_MAX_RECORDS;
+	s_count--;
+
+	return true;
+}
+
+/*
+ * The master could not be reached: keep the queue and try again after the
+ * latency budget, so an absent master does not cause a WAKE every tick.
+ */
+void TxSched_Retry(void)
+{
+	s_batchStartSecs = s_nowSecs;
+	s_holdSecs = (s_budget > MIN_RETRY_S) ? s_budget : MIN_RETRY_S;
+}
+
+uint16_t TxSched_GetMeanIntervalSecs(void)
+{
+	return s_meanIntervalSecs;
+}
+
+/*
+ * Private Function Definitions
+ */
+
+static uint16_t holdSeconds(void)
+{
+	// Sparse: another flush is unlikely within the budget, so do not wait for one
+	if (((uint32_t)s_meanIntervalSecs * 2U) >= s_budget)
+	{
+		return 0U;
+	}
+
+	// Dense: wait long enough to fill a batch at the current rate
+	uint32_t fill = (uint32_t)s_meanIntervalSecs * (TXSCHED_MAX_RECORDS - 1U);
+
+	return (fill < s_budget) ? (uint16_t)fill : s_budget;
+}
+
+static uint16_t ageOf(const TXSCHED_RECORD * pRecord)
+{
+	uint32_t age = s_nowSecs - pRecord->completedSecs;
+	return (age > UINT16_MAX) ? UINT16_MAX : (uint16_t)age;
+}
@@ -0,0 +1,39 @@
+#ifndef _TXSCHED_H_
+#define _TXSCHED_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define TXSCHED_MAX_RECORDS			(8U)
+#define TXSCHED_DEFAULT_BUDGET_S	(300U)
+
+struct txsched_record
+{
+	uint16_t durationSecs;
+	uint32_t completedSecs;	// Scheduler clock when the flush finished
+	TENTHSDEGC outflow;
+};
+typedef struct txsched_record TXSCHED_RECORD;
+
+/*
+ * Public Function Prototypes
+ */
+
+void TxSched_Init(void);
+
+void TxSched_SetBudget(uint16_t seconds);
+uint16_t TxSched_GetBudget(void);
+
+void TxSched_AddFlush(uint16_t durationSecs, TENTHSDEGC outflow);
+void TxSched_Tick(uint16_t ms);
+
+bool TxSched_IsDue(void);
+uint8_t TxSched_Pending(void);
+uint16_t TxSched_GetOldestAgeSecs(void);
+bool TxSched_TakeRecord(TXSCHED_RECORD * pRecord, uint16_t * pAgeSecs);
+void TxSched_Retry(void);
+
+uint16_t TxSched_GetMeanIntervalSecs(void);
+
+#endif